@@ -17,9 +17,9 @@ public:
 	bird_movement(): timer(0) {};
 	bird_movement * clone() { return new bird_movement(); };
 	
-	void update(double &current_x, double &current_y, const unsigned int delta_time, const unsigned int movement_time, const double resize_movement = 1, const bool horizontal_flip = false, const bool vertical_flip = false)
+	void update(double &current_x, double &current_y, const double delta_time, const double movement_time, const double resize_movement = 1, const bool horizontal_flip = false, const bool vertical_flip = false)
 	{
-		add_impulse_velocity(((double)delta_time / 10.0) * resize_movement, resize_movement * (double)delta_time * 0.3 * sin(((double)movement_time / 10.0) * ((2.0 * 3.1416) / 180.0)), 1);
+		add_impulse_velocity((delta_time / 10.0) * resize_movement, resize_movement * delta_time * 0.3 * sin((movement_time / 10.0) * ((2.0 * 3.1416) / 180.0)), 1);
 		default_update(current_x, current_y, delta_time, movement_time, resize_movement);
 	}
 };
@@ -49,6 +49,7 @@ int main( int argc, char* args[] )
 	
 	// Initialize display etc:
 	engine->initialize("plf test", 1024, 768, 1024, 768, plf::WINDOWED, plf::VSYNC_OFF);
+	engine->atlas_manager->set_packing(plf::ATLAS_MAXRECTS);
 	
 	// Blank the screen:
 	engine->renderer->clear_screen();
@@ -79,15 +80,16 @@ int main( int argc, char* args[] )
 	engine->music->add_music("dissipate", "../matt_bentley_-_dissipate.ogg");
 	engine->music->play("dissipate", 64);
 
-	// Create sprites:
+	// Create sprites - images are decoded in parallel, then added in this order by load_batch:
 	plf::sprite *bird_sprite = engine->sprites->new_sprite("bird", plf::LOOP, plf::ALIGN_LEFT, plf::ALIGN_TOP);
-	bird_sprite->add_frames_from_tile("../bird_tile.png", 10, 156, 90);
+	engine->sprites->batch_add_frames_from_tile(bird_sprite, "../bird_tile.png", 10, 156, 90);
 
 	plf::sprite *explosion_sprite = engine->sprites->new_sprite("explosion", plf::NO_LOOP, plf::ALIGN_LEFT, plf::ALIGN_TOP);
-	explosion_sprite->add_frames("../explosion", 15, 45);
+	engine->sprites->batch_add_frames(explosion_sprite, "../explosion", 15, 45);
 
 	plf::sprite *backing_sprite = engine->sprites->new_sprite("backing", plf::NO_LOOP, plf::ALIGN_LEFT, plf::ALIGN_TOP);
-	backing_sprite->add_frame("../background.jpg", 0);
+	engine->sprites->batch_add_frame(backing_sprite, "../background.jpg", 0);
+	engine->sprites->load_batch();
 
 	// Create entity and set parameters:
 	plf::entity *bird_entity = engine->entities->new_entity("eagle");
@@ -110,8 +112,10 @@ int main( int argc, char* args[] )
 	backing_layer->add_background(backing_sprite, 0, 0, 1);
 	backing_layer->spawn_entity("eagle1", bird_entity, 400, 250, 0, 0, .4f, 0);
 	backing_layer->spawn_entity("eagle2", bird_entity, 200, 200, 500, 250, .25f, 0);
+	backing_layer->set_caching(true, false); // The multi-textured background is rendered once, then drawn as a single texture each frame
+	backing_layer->set_update_divisor(2); // Slowest parallax layer - updating every second frame is indistinguishable
 
-	unsigned int delta = 0;
+	double delta = 0;
 	double display_x = 0;
 	unsigned int num_loops = 0, doloop = 0;
 
@@ -123,6 +127,11 @@ int main( int argc, char* args[] )
 	// Set up time:
 	Uint32 sdl_time = SDL_GetTicks(), time_for_more_spawn;
 	
+	// Record draws and replay them at display_frame, so that they can be sorted and batched:
+	engine->renderer->set_render_mode(plf::RENDER_RECORDED);
+	
+	// Everything's loaded - start timing frames from here, so that the first delta doesn't include the loading time:
+	engine->pacer->reset();
 
 	do
 	{
@@ -187,28 +196,30 @@ int main( int argc, char* args[] )
 				return 0;
 			}
 
-			// Here is one method for making sure we're not trying to display more than 60 frames per second:
-			// Simply burn off any remaining time by repeatedly checking against the clock until at least 14ms has passed.
-			// (16ms is approx 1/60 second), allowing 2ms leeway
-			// Not a great method if the next frame takes way longer than expected to render.
-			
-			do
-			{
-				delta = static_cast<unsigned int>(SDL_GetTicks() - sdl_time);
-			} while (delta < 14); 
+			// Hold the frame rate to the display's refresh rate: the engine's frame pacer sleeps for most of the remaining frame time,
+			// then spins for the final fraction of a millisecond, so frame times stay accurate without burning a whole core.
+			// The returned delta is in fractional milliseconds, measured with the high-resolution performance counter.
+			delta = engine->pacer->wait_for_next_frame();
 			
-			sdl_time = SDL_GetTicks(); // reset sdl_time for next frame.
+			sdl_time = SDL_GetTicks(); // Millisecond precision is fine for the spawn timer.
 
 		} while (sdl_time < time_for_more_spawn);
 
+		// Report how well the draw lists grouped sprites by atlas, with the bird count at this point:
+		const plf::render_statistics statistics = engine->renderer->get_frame_statistics();
+		std::clog << "Draw commands: " << statistics.commands << ", draw calls: " << statistics.draw_calls << ", texture binds: " << statistics.texture_binds << ", texture mod changes: " << statistics.mod_changes << std::endl;
+
 	} while (++doloop != 4);
 
 	
 	
-	// 2 - same situation, different approach to timing, music fade-between:
+	// 2 - same situation, lower frame rate, music fade-between:
 	
 	// Fade into BoC music:
 	engine->music->fadebetween("waterfall", 5000, 64);
+	
+	// Drop to 30fps - the pacer will spend most of each frame asleep, saving a lot of CPU:
+	engine->pacer->set_target_frame_rate(30);
 
 
 	do
@@ -227,22 +238,8 @@ int main( int argc, char* args[] )
 
 		engine->sound->set_sound_center((const unsigned int)display_x + 300, 200);
 		
-		// A (often bad) method of making sure we don't display more than 60 fps:
-		// Why? because the OS is only guaranteed to use AT LEAST this much time before giving the program control again.
-		// So we try and mitigate it by only delaying if the delta is under a certain amount, but that may not work.
-		// This method is generally fine if you're not worried about achieving 60fps frame rates, 
-		// if you're going for 30fps or lower it's perfectly fine and saves tons of CPU.
-		
-		delta = static_cast<unsigned int>(SDL_GetTicks() - sdl_time);
-		
-		if (delta < 10)
-		{
-			SDL_Delay(14 - delta);
-			delta = static_cast<unsigned int>(SDL_GetTicks() - sdl_time);
-		}
-
-		sdl_time = SDL_GetTicks();
-		display_x += (double)delta / 10.0;
+		delta = engine->pacer->wait_for_next_frame();
+		display_x += delta / 10.0;
 		++num_loops;
 
 	} while (display_x < 3000);
@@ -399,7 +396,11 @@ int main( int argc, char* args[] )
 
 
 // 4 - show texture atlas - use up and down arrow keys to flick between different texture atlases:
+	engine->atlas_manager->log_occupancy();
 	SDL_Rect source = {0, 0, 0, 0};
+	
+	// Drawing directly via SDL_RenderCopy below, rather than through the engine, so switch back to immediate rendering:
+	engine->renderer->set_render_mode(plf::RENDER_IMMEDIATE);
 
 	unsigned int atlas_number = 1;
 	const unsigned int num_atlases = engine->atlas_manager->get_number_of_atlases();
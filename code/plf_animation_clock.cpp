@@ -0,0 +1,119 @@
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <cmath> // floor
+#include <cassert>
+
+#include <SDL2/SDL.h>
+
+#include "plf_animation_clock.h"
+#include "plf_sprite.h"
+#include "plf_math.h"
+
+
+namespace plf
+{
+
+	animation_clock::animation_clock():
+		clock_time(0),
+		phase_quantum(1)
+	{}
+
+
+
+	void animation_clock::find_frame(animation_group &group)
+	{
+		group.timings_version = group.sprite->get_timings_version();
+
+		if (group.sprite->find_frame(clock_time + group.phase, group.current_frame, group.remainder) != 0) // Sprite has no frames or no duration left - show its first frame (if any) and retry next tick
+		{
+			group.current_frame = 0;
+			group.remainder = 0;
+		}
+	}
+
+
+
+	animation_group * animation_clock::join(plf::sprite *sprite, const double sprite_time)
+	{
+		assert(sprite != NULL);
+
+		const double total_time = static_cast<double>(sprite->get_total_time());
+		assert(total_time > 0);
+
+		double exact_phase = fast_mod(sprite_time, total_time) - fast_mod(clock_time, total_time);
+
+		if (exact_phase < 0)
+		{
+			exact_phase += total_time;
+		}
+
+		// Round to the nearest multiple of the quantum - rounding up can reach the total time, which is phase 0:
+		const unsigned int phase = fast_mod(static_cast<unsigned int>(std::floor((exact_phase / static_cast<double>(phase_quantum)) + 0.5)) * phase_quantum, sprite->get_total_time());
+
+		const group_key key(sprite, phase);
+		std::map<group_key, animation_group>::iterator group_iterator = groups.find(key);
+
+		if (group_iterator == groups.end())
+		{
+			animation_group new_group;
+			new_group.sprite = sprite;
+			new_group.phase = phase;
+			new_group.users = 0;
+			find_frame(new_group);
+
+			group_iterator = groups.insert(std::pair<group_key, animation_group>(key, new_group)).first;
+		}
+		else if (group_iterator->second.timings_version != sprite->get_timings_version())
+		{
+			find_frame(group_iterator->second);
+		}
+
+		++(group_iterator->second.users);
+		return &(group_iterator->second);
+	}
+
+
+
+	void animation_clock::leave(animation_group *group)
+	{
+		assert(group != NULL);
+		assert(group->users != 0);
+
+		if (--(group->users) == 0)
+		{
+			groups.erase(group_key(group->sprite, group->phase));
+		}
+	}
+
+
+
+	double animation_clock::get_sprite_time(const animation_group *group)
+	{
+		assert(group != NULL);
+		const unsigned int total_time = group->sprite->get_total_time();
+		return (total_time == 0) ? 0 : fast_mod(clock_time + group->phase, static_cast<double>(total_time));
+	}
+
+
+
+	void animation_clock::tick(const double delta_time)
+	{
+		clock_time += delta_time;
+
+		for (std::map<group_key, animation_group>::iterator group_iterator = groups.begin(); group_iterator != groups.end(); ++group_iterator)
+		{
+			animation_group &group = group_iterator->second;
+			group.remainder -= delta_time;
+
+			if (group.remainder > 0 && group.timings_version == group.sprite->get_timings_version()) // Still within the same frame, and the sprite's timings haven't changed since it was looked up - no lookup necessary
+			{
+				continue;
+			}
+
+			find_frame(group);
+		}
+	}
+
+}
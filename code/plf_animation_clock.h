@@ -0,0 +1,53 @@
+#ifndef PLF_ANIMATION_CLOCK_H
+#define PLF_ANIMATION_CLOCK_H
+
+#include <map>
+#include <utility>
+#include <cassert>
+
+
+namespace plf
+{
+
+	class sprite; // Forward declaration - avoids circular dependency with plf_sprite.h
+
+
+
+	// Entities which run the same looping sprite at the same phase (sprite time offset modulo the sprite's total time) share a group, so the group's frame is computed once per tick and its entities only read it:
+	struct animation_group
+	{
+		plf::sprite *sprite;
+		unsigned int phase;				// Group's sprite time minus the clock's time, modulo the sprite's total time, in whole milliseconds
+		double remainder;				// Time left within current frame
+		unsigned int current_frame;
+		unsigned int users;				// Number of entities in this group - the group is removed when this reaches 0
+		unsigned int timings_version;	// Sprite's timings version when current_frame and remainder were computed - the lookup is redone when the sprite's frames or timings change
+	};
+
+
+
+	class animation_clock
+	{
+	private:
+		typedef std::pair<plf::sprite *, unsigned int> group_key; // Integer phase, so that phases which differ only by floating-point error share a group
+
+		std::map<group_key, animation_group> groups; // std::map nodes don't move, so entities can hold pointers to their group
+		double clock_time;
+		unsigned int phase_quantum; // Phases are rounded to a multiple of this many milliseconds (1 by default), which bounds the number of groups per sprite
+
+		void find_frame(animation_group &group); // Look up the group's frame at the current clock time, against the sprite's current timings
+
+	public:
+		animation_clock();
+
+		animation_group * join(plf::sprite *sprite, const double sprite_time); // Returns the group for a looping, animated sprite at this sprite time, creating it if necessary
+		void leave(animation_group *group);
+		double get_sprite_time(const animation_group *group); // Current sprite time of the group - used when an entity leaves, so that it can carry on by itself
+		void tick(const double delta_time); // Advance every group - delta_time is in (fractional) milliseconds
+		inline void set_phase_quantum(const unsigned int milliseconds) { assert(milliseconds != 0); phase_quantum = milliseconds; }; // Only affects groups joined afterwards
+		inline unsigned int get_number_of_groups() { return static_cast<unsigned int>(groups.size()); };
+	};
+
+}
+
+#endif // PLF_ANIMATION_CLOCK_H
@@ -1,4 +1,8 @@
 #include <vector>
+#include <algorithm> // std::min, std::max, std::find, std::sort
+#include <climits> // INT_MAX
+#include <cstring> // std::memcmp
+#include <iostream>
 #include <cassert>
 
 #include <SDL2/SDL.h>
@@ -8,6 +12,7 @@
 #include "plf_utility.h"
 #include "plf_renderer.h"
 #include "plf_atlas.h"
+#include "plf_texture.h"
 
 
 namespace plf
@@ -21,7 +26,11 @@ namespace plf
 		x(node_x),
 		y(node_y),
 		width(node_width),
-		height(node_height)
+		height(node_height),
+		references(1),
+		content_hash(0),
+		opaque(false),
+		cached(false)
 	{
 	}
 	
@@ -124,6 +133,54 @@ namespace plf
 	
 	
 	
+	void atlas_node::get_largest_empty_node(unsigned int &largest_width, unsigned int &largest_height)
+	{
+		if (split_a != NULL)
+		{
+			split_a->get_largest_empty_node(largest_width, largest_height);
+			split_b->get_largest_empty_node(largest_width, largest_height);
+		}
+		else if (image_rect == NULL && width * height > largest_width * largest_height)
+		{
+			largest_width = width;
+			largest_height = height;
+		}
+	}
+	
+	
+	
+	void atlas_node::get_images(std::vector<atlas_node *> &images)
+	{
+		if (image_rect != NULL)
+		{
+			images.push_back(this);
+		}
+	
+		if (split_a != NULL)
+		{
+			split_a->get_images(images);
+			split_b->get_images(images);
+		}
+	}
+	
+	
+	
+	void atlas_node::add_user(plf::texture *user)
+	{
+		users.push_back(user);
+	}
+	
+	
+	
+	void atlas_node::remove_user(plf::texture *user)
+	{
+		std::vector<plf::texture *>::iterator user_iterator = std::find(users.begin(), users.end(), user);
+		assert(user_iterator != users.end()); // Texture was never added as a user
+		users.erase(user_iterator);
+	}
+	
+	
+	
 	bool atlas_node::node_and_child_nodes_are_empty()
 	{
 		if (image_rect != NULL)
@@ -143,85 +200,189 @@ namespace plf
 	
 	
 	
-	atlas::atlas(plf::renderer *p_renderer, const unsigned int atlas_width, const unsigned int atlas_height):
-		renderer(p_renderer)
+	atlas::atlas(plf::renderer *p_renderer, const unsigned int atlas_width, const unsigned int atlas_height, const ATLAS_PACKING packing_method):
+		renderer(p_renderer),
+		packing(packing_method),
+		packer(atlas_width, atlas_height),
+		width(atlas_width),
+		height(atlas_height),
+		number_of_images(0),
+		used_pixels(0)
 	{
 		assert(renderer != NULL);
 		assert(atlas_width != 0);
 		assert(atlas_height != 0);
 	
-		atlas_texture = SDL_CreateTexture(renderer->get(), renderer->get_texture_pixel_format(), SDL_TEXTUREACCESS_STATIC, atlas_width, atlas_height);
-		plf_fail_if (atlas_texture == NULL, "plf::atlas initialisation Error: Unable to create texture of size " << atlas_width << "/" << atlas_height << ". ");
+		has_dirty_area = false;
 	
-		SDL_SetTextureBlendMode(atlas_texture, SDL_BLENDMODE_BLEND);
+		create_texture();
 		prime_node = new atlas_node(0, 0, atlas_width, atlas_height, NULL);
 	}
 	
 	
 	
+	atlas::atlas(plf::renderer *p_renderer, const unsigned int atlas_width, const unsigned int atlas_height, const void *pixels, const int pitch, const Uint32 pixel_format):
+		renderer(p_renderer),
+		packing(ATLAS_MAXRECTS),
+		packer(atlas_width, atlas_height),
+		width(atlas_width),
+		height(atlas_height),
+		number_of_images(0),
+		used_pixels(0)
+	{
+		assert(renderer != NULL);
+		assert(pixels != NULL);
+	
+		has_dirty_area = false;
+		create_texture();
+		prime_node = new atlas_node(0, 0, atlas_width, atlas_height, NULL);
+	
+		// Convert to texture format while copying to the staging surface, then upload the whole page:
+		plf_fail_if (SDL_ConvertPixels(atlas_width, atlas_height, pixel_format, pixels, pitch, staging_surface->format->format, staging_surface->pixels, staging_surface->pitch) < 0, "plf::atlas initialisation Error: Unable to convert page of size " << atlas_width << "/" << atlas_height << " to texture format. ");
+	
+		const SDL_Rect page_area = {0, 0, static_cast<int>(atlas_width), static_cast<int>(atlas_height)};
+		add_dirty_area(page_area);
+		commit();
+	}
+	
+	
+	
+	void atlas::create_texture()
+	{
+		renderer->lock();
+		atlas_texture = SDL_CreateTexture(renderer->get(), renderer->get_texture_pixel_format(), SDL_TEXTUREACCESS_STATIC, width, height);
+		plf_fail_if (atlas_texture == NULL, "plf::atlas initialisation Error: Unable to create texture of size " << width << "/" << height << ". ");
+	
+		SDL_SetTextureBlendMode(atlas_texture, SDL_BLENDMODE_BLEND);
+		renderer->unlock();
+	
+		// Starts fully transparent, same as the texture:
+		staging_surface = SDL_CreateRGBSurfaceWithFormat(0, width, height, SDL_BITSPERPIXEL(renderer->get_surface_pixel_format()), renderer->get_surface_pixel_format());
+		plf_fail_if (staging_surface == NULL, "plf::atlas initialisation Error: Unable to create staging surface of size " << width << "/" << height << ". ");
+	}
+	
+	
+	
 	atlas::~atlas()
 	{
 		delete prime_node;
+	
+		for (std::vector<atlas_node *>::iterator node_iterator = placed_nodes.begin(); node_iterator != placed_nodes.end(); ++node_iterator)
+		{
+			delete *node_iterator;
+		}
+	
+		renderer->lock();
 		SDL_DestroyTexture(atlas_texture);
+		renderer->unlock();
+	
+		SDL_FreeSurface(staging_surface);
 	}
 	
 	
 	
 	
-	atlas_node * atlas::add_surface(SDL_Surface *new_surface)
+	atlas_node * atlas::add_surface(SDL_Surface *new_surface, const SDL_Rect *source_area)
 	{
 		assert(new_surface != NULL);
 	
-		const int width = new_surface->w;
-		const int height = new_surface->h;
+		SDL_Rect area = {0, 0, new_surface->w, new_surface->h};
+	
+		if (source_area != NULL)
+		{
+			assert(source_area->x >= 0 && source_area->y >= 0 && source_area->x + source_area->w <= new_surface->w && source_area->y + source_area->h <= new_surface->h); // Area must lie within the surface
+			area = *source_area;
+		}
+	
+		const int width = area.w;
+		const int height = area.h;
 		
 		atlas_node *located_position = NULL;
-		located_position = prime_node->add(width, height);
+		SDL_Rect placed;
+	
+		if (packing == ATLAS_MAXRECTS)
+		{
+			if (packer.insert(width, height, placed))
+			{
+				located_position = add_placed_node(placed);
+			}
+		}
+		else
+		{
+			located_position = prime_node->add(width, height);
+		}
 		
 		if (located_position == NULL) // Location with enough space not found within surface
 		{
 			return NULL; // Totally valid behaviour (except for a newly-created atlas with no images in it - no supplied images should be larger than can fit in an atlas by the texture manager) - manager will create/select another atlas texture
 		}
 		
-		SDL_Rect *image_coordinates_within_atlas = located_position->get_image_coordinates();
-		SDL_SetSurfaceBlendMode(new_surface, SDL_BLENDMODE_NONE);
-		SDL_Surface *surface = new_surface;
+		++number_of_images;
+		used_pixels += static_cast<unsigned int>(width * height);
 		
-		if (new_surface->format->format != renderer->get_surface_pixel_format())
-		{
-			// Convert surface format to texture format:
-			surface = create_surface(width, height);
+		SDL_Rect *image_coordinates_within_atlas = located_position->get_image_coordinates();
+		Uint8 *staging_pixels = static_cast<Uint8 *>(staging_surface->pixels) + (image_coordinates_within_atlas->y * staging_surface->pitch) + (image_coordinates_within_atlas->x * staging_surface->format->BytesPerPixel);
 	
-			plf_fail_if (surface == NULL, "plf::atlas add_surface Error: Unable to create surface of size " << width << "/" << height << ". ");
+		// SDL_ConvertPixels can't read palettized pixels - atlas_manager converts them beforehand:
+		assert(!SDL_ISPIXELFORMAT_INDEXED(new_surface->format->format));
 	
-			// Convert new_surface to texture pixel format:
-			plf_fail_if (SDL_ConvertPixels(width, height, new_surface->format->format, new_surface->pixels, new_surface->pitch, renderer->get_surface_pixel_format(), surface->pixels, surface->pitch) < 0, "plf::atlas add_surface Error: Unable to convert surface of size " << width << "/" << height << ". ");
+		if (SDL_MUSTLOCK(new_surface))
+		{
+			SDL_LockSurface(new_surface);
+		}
 	
-			SDL_SetSurfaceBlendMode(surface, SDL_BLENDMODE_NONE);
+		// Convert to texture format (or just copy, if it's already in it) straight from the source area into the image's place on the staging surface:
+		const Uint8 *source_pixels = static_cast<const Uint8 *>(new_surface->pixels) + (area.y * new_surface->pitch) + (area.x * new_surface->format->BytesPerPixel);
+		const int return_value = SDL_ConvertPixels(width, height, new_surface->format->format, source_pixels, new_surface->pitch, staging_surface->format->format, staging_pixels, staging_surface->pitch);
+	
+		if (SDL_MUSTLOCK(new_surface))
+		{
+			SDL_UnlockSurface(new_surface);
 		}
 	
-		int return_value;
+		plf_fail_if (return_value < 0, "plf::atlas add_surface Error: Unable to convert surface of size " << width << "/" << height << " to texture format. ");
 	
-		if (SDL_MUSTLOCK(surface))
+		// Scan the converted pixels, so that the result reflects what is actually in the atlas:
+		located_position->opaque = pixels_are_opaque(staging_pixels, width, height, staging_surface->pitch, staging_surface->format);
+		add_dirty_area(*image_coordinates_within_atlas);
+	
+		return located_position;
+	}
+	
+	
+	
+	void atlas::add_dirty_area(const SDL_Rect &area)
+	{
+		if (has_dirty_area)
 		{
-			SDL_LockSurface(surface);
-			return_value = SDL_UpdateTexture(atlas_texture, image_coordinates_within_atlas, surface->pixels, surface->pitch);
-			SDL_UnlockSurface(surface);
+			SDL_UnionRect(&dirty_area, &area, &dirty_area);
 		}
 		else
 		{
-			return_value = SDL_UpdateTexture(atlas_texture, image_coordinates_within_atlas, surface->pixels, surface->pitch);
+			dirty_area = area;
+			has_dirty_area = true;
 		}
+	}
+	
+	
 	
-		// If surface had to be converted to texture format, delete temp intermediate surface:
-		if (surface != new_surface)
+	void atlas::commit()
+	{
+		if (!has_dirty_area)
 		{
-			SDL_FreeSurface(surface);
+			return;
 		}
 	
-		plf_fail_if (return_value < 0, "plf::atlas add_surface Error: Unable to copy surface of size " << width << "/" << height << " to atlas texture. ");
+		// The bounding area of all staged images is uploaded in one go - anything between them is unchanged, so re-uploading it is harmless:
+		const Uint8 *staging_pixels = static_cast<const Uint8 *>(staging_surface->pixels) + (dirty_area.y * staging_surface->pitch) + (dirty_area.x * staging_surface->format->BytesPerPixel);
 	
-		return located_position;
+		renderer->lock();
+		const int return_value = SDL_UpdateTexture(atlas_texture, &dirty_area, staging_pixels, staging_surface->pitch);
+		renderer->unlock();
+	
+		plf_fail_if (return_value < 0, "plf::atlas commit Error: Unable to copy area of size " << dirty_area.w << "/" << dirty_area.h << " to atlas texture. ");
+	
+		has_dirty_area = false;
 	}
 	
 	
@@ -230,7 +391,32 @@ namespace plf
 	{
 		assert(node != NULL);
 		assert(node->image_rect != NULL); // attempt to delete image in node where image doesn't exist - shouldn't happen
+		assert(node->references != 0);
+	
+		if (--node->references != 0)
+		{
+			return; // Still in use by other textures
+		}
+	
+		if (node->cached)
+		{
+			image_cache.erase(node->content_hash);
+			node->cached = false;
+		}
 		
+		--number_of_images;
+		used_pixels -= static_cast<unsigned int>(node->image_rect->w * node->image_rect->h);
+	
+		if (packing == ATLAS_MAXRECTS)
+		{
+			std::vector<atlas_node *>::iterator node_iterator = std::find(placed_nodes.begin(), placed_nodes.end(), node);
+			assert(node_iterator != placed_nodes.end()); // Node doesn't belong to this atlas
+			placed_nodes.erase(node_iterator);
+			packer.release(*(node->image_rect));
+			delete node;
+			return;
+		}
+	
 		delete node->image_rect;
 		node->image_rect = NULL;
 		atlas_node *parent = node->parent_node;
@@ -263,6 +449,156 @@ namespace plf
 	
 	
 	
+	atlas_node * atlas::find_image(const Uint64 content_hash, SDL_Surface *source_surface, const SDL_Rect &area)
+	{
+		std::map<Uint64, atlas_node *>::iterator cache_iterator = image_cache.find(content_hash);
+	
+		if (cache_iterator == image_cache.end() || cache_iterator->second->image_rect->w != area.w || cache_iterator->second->image_rect->h != area.h)
+		{
+			return NULL;
+		}
+	
+		// Hashes can collide - only share the image if the source, converted to texture format, is identical to it:
+		assert(!SDL_ISPIXELFORMAT_INDEXED(source_surface->format->format));
+		const SDL_Rect *image_rect = cache_iterator->second->image_rect;
+		const int row_bytes = area.w * staging_surface->format->BytesPerPixel;
+		std::vector<Uint8> converted_row(static_cast<unsigned int>(row_bytes));
+		const Uint8 *staging_row = static_cast<const Uint8 *>(staging_surface->pixels) + (image_rect->y * staging_surface->pitch) + (image_rect->x * staging_surface->format->BytesPerPixel);
+		bool identical = true;
+	
+		if (SDL_MUSTLOCK(source_surface))
+		{
+			SDL_LockSurface(source_surface);
+		}
+	
+		const Uint8 *source_row = static_cast<const Uint8 *>(source_surface->pixels) + (area.y * source_surface->pitch) + (area.x * source_surface->format->BytesPerPixel);
+	
+		for (int row = 0; row != area.h; ++row, source_row += source_surface->pitch, staging_row += staging_surface->pitch)
+		{
+			if (SDL_ConvertPixels(area.w, 1, source_surface->format->format, source_row, source_surface->pitch, staging_surface->format->format, &converted_row[0], row_bytes) < 0 || std::memcmp(&converted_row[0], staging_row, static_cast<size_t>(row_bytes)) != 0)
+			{
+				identical = false;
+				break;
+			}
+		}
+	
+		if (SDL_MUSTLOCK(source_surface))
+		{
+			SDL_UnlockSurface(source_surface);
+		}
+	
+		if (!identical)
+		{
+			return NULL;
+		}
+	
+		++(cache_iterator->second->references);
+		return cache_iterator->second;
+	}
+	
+	
+	
+	void atlas::cache_image(atlas_node *node, const Uint64 content_hash)
+	{
+		assert(node != NULL && !node->cached);
+	
+		if (image_cache.insert(std::pair<Uint64, atlas_node *>(content_hash, node)).second) // If there's already an image with this hash (ie. a collision with differing sizes) this one isn't shared
+		{
+			node->content_hash = content_hash;
+			node->cached = true;
+		}
+	}
+	
+	
+	
+	atlas_node * atlas::move_image(atlas &source_atlas, atlas_node *source_node)
+	{
+		assert(source_node != NULL && source_node->image_rect != NULL);
+	
+		atlas_node *new_node = add_surface(source_atlas.staging_surface, source_node->image_rect);
+	
+		if (new_node == NULL)
+		{
+			return NULL;
+		}
+	
+		new_node->references = source_node->references;
+	
+		if (source_node->cached)
+		{
+			cache_image(new_node, source_node->content_hash);
+		}
+	
+		new_node->users.swap(source_node->users);
+	
+		for (std::vector<plf::texture *>::iterator user_iterator = new_node->users.begin(); user_iterator != new_node->users.end(); ++user_iterator)
+		{
+			(*user_iterator)->relocate(source_node, this, new_node);
+		}
+	
+		return new_node;
+	}
+	
+	
+	
+	void atlas::get_images(std::vector<atlas_node *> &images)
+	{
+		prime_node->get_images(images);
+		images.insert(images.end(), placed_nodes.begin(), placed_nodes.end());
+	}
+	
+	
+	
+	atlas_node * atlas::add_placed_node(const SDL_Rect &placed)
+	{
+		atlas_node *placed_node = new atlas_node(placed.x, placed.y, placed.w, placed.h, NULL);
+		placed_node->image_rect = new SDL_Rect(placed);
+		placed_nodes.push_back(placed_node);
+		return placed_node;
+	}
+	
+	
+	
+	atlas_node * atlas::add_region(const SDL_Rect &region, const bool opaque)
+	{
+		assert(packing == ATLAS_MAXRECTS);
+		assert(region.x >= 0 && region.y >= 0 && region.x + region.w <= static_cast<int>(width) && region.y + region.h <= static_cast<int>(height));
+	
+		packer.reserve(region);
+		atlas_node *region_node = add_placed_node(region);
+		region_node->opaque = opaque;
+		++number_of_images;
+		used_pixels += static_cast<unsigned int>(region.w * region.h);
+		return region_node;
+	}
+	
+	
+	
+	void atlas::get_occupancy(atlas_occupancy &occupancy)
+	{
+		occupancy.width = width;
+		occupancy.height = height;
+		occupancy.number_of_images = number_of_images;
+		occupancy.used_pixels = used_pixels;
+		occupancy.free_pixels = (width * height) - used_pixels;
+		occupancy.largest_free_width = 0;
+		occupancy.largest_free_height = 0;
+	
+		if (packing == ATLAS_MAXRECTS)
+		{
+			packer.get_largest_free_rectangle(occupancy.largest_free_width, occupancy.largest_free_height);
+		}
+		else
+		{
+			prime_node->get_largest_empty_node(occupancy.largest_free_width, occupancy.largest_free_height);
+		}
+	
+		occupancy.occupancy = static_cast<double>(used_pixels) / static_cast<double>(width * height);
+		occupancy.fragmentation = (occupancy.free_pixels == 0) ? 0 : 1.0 - (static_cast<double>(occupancy.largest_free_width * occupancy.largest_free_height) / static_cast<double>(occupancy.free_pixels));
+	}
+	
+	
+	
 	SDL_Texture * atlas::get_texture()
 	{
 		return atlas_texture;
@@ -271,7 +607,14 @@ namespace plf
 	
 	
 	atlas_manager::atlas_manager(plf::renderer *_renderer):
-		renderer(_renderer)
+		renderer(_renderer),
+		packing(ATLAS_GUILLOTINE),
+		upload_deferral_depth(0),
+		memory_budget(0),
+		frame_number(0),
+		evictions(0),
+		reloads(0),
+		compactions(0)
 	{
 		assert(renderer != NULL);
 	
@@ -306,8 +649,7 @@ namespace plf
 			maximum_height = round_down_to_power_of_two(static_cast<unsigned int>(maximum_height));
 		}
 	
-		atlas *first_atlas = new atlas(renderer, maximum_width, maximum_height);
-		atlases.push_back(first_atlas);
+		// The first page is created when the first image is added, so that set_page_size/set_packing can still be applied
 	}
 		
 		
@@ -324,21 +666,68 @@ namespace plf
 	
 	
 	
-	std::pair<atlas *, atlas_node *> atlas_manager::add_surface(SDL_Surface *new_surface)
+	std::pair<atlas *, atlas_node *> atlas_manager::add_surface(SDL_Surface *new_surface, const SDL_Rect *source_area)
 	{
-		assert(new_surface->w <= maximum_width && new_surface->h <= maximum_height); // surface is not larger than maximum atlas width or height
+		const int width = (source_area == NULL) ? new_surface->w : source_area->w;
+		const int height = (source_area == NULL) ? new_surface->h : source_area->h;
+		assert(width <= maximum_width && height <= maximum_height); // image is not larger than maximum atlas width or height
 	
 		atlas_node *selected_node = NULL;
 		atlas *selected_atlas = NULL;
+		SDL_Surface *source_surface = new_surface;
+	
+		if (SDL_ISPIXELFORMAT_INDEXED(new_surface->format->format))
+		{
+			// SDL_ConvertPixels can't read palettized pixels - convert the whole surface first (anything slicing many areas from a palettized surface should convert it once beforehand):
+			source_surface = SDL_ConvertSurfaceFormat(new_surface, renderer->get_surface_pixel_format(), 0);
+			plf_fail_if (source_surface == NULL, "plf::atlas_manager add_surface Error: Unable to convert palettized surface of size " << new_surface->w << "/" << new_surface->h << ". ");
+		}
+	
+		// Hash the source pixels - identical images in the same format convert identically, so the hash needn't wait for conversion:
+		SDL_Rect area = {0, 0, width, height};
+	
+		if (source_area != NULL)
+		{
+			area = *source_area;
+		}
+
+		const int bytes_per_pixel = source_surface->format->BytesPerPixel;
+	
+		if (SDL_MUSTLOCK(source_surface))
+		{
+			SDL_LockSurface(source_surface);
+		}
+	
+		const Uint64 content_hash = hash_pixels(static_cast<const Uint8 *>(source_surface->pixels) + (area.y * source_surface->pitch) + (area.x * bytes_per_pixel), width * bytes_per_pixel, height, source_surface->pitch, source_surface->format->format);
+	
+		if (SDL_MUSTLOCK(source_surface))
+		{
+			SDL_UnlockSurface(source_surface);
+		}
+	
+		for (std::vector<atlas *>::iterator current_atlas = atlases.begin(); current_atlas != atlases.end(); ++current_atlas)
+		{
+			selected_node = (*current_atlas)->find_image(content_hash, source_surface, area);
+	
+			if (selected_node != NULL)
+			{
+				if (source_surface != new_surface)
+				{
+					SDL_FreeSurface(source_surface);
+				}
+	
+				return std::pair<atlas *, atlas_node *> (*current_atlas, selected_node);
+			}
+		}
 			
 	
 		// Rule out Special-case (surface is exact size of a new atlas) - if special-case, new atlas will be create in code after:
-		if (new_surface->w != maximum_width || new_surface->h != maximum_height)
+		if (width != maximum_width || height != maximum_height)
 		{
 			for (std::vector<atlas *>::iterator current_atlas = atlases.begin(); current_atlas != atlases.end(); ++current_atlas)
 			{
 				// brackets needed to denote that the dereference applies only to the iterator and not to some pointer returned by a function that the iterator is accessing.
-				selected_node = (*current_atlas)->add_surface(new_surface);
+				selected_node = (*current_atlas)->add_surface(source_surface, source_area);
 	
 				if (selected_node != NULL)
 				{
@@ -353,8 +742,8 @@ namespace plf
 		if (selected_node == NULL)
 		{
 			// Create a new atlas to house the image:
-			atlas *new_atlas = new atlas(renderer, maximum_width, maximum_height);
-			selected_node = new_atlas->add_surface(new_surface);
+			atlas *new_atlas = new atlas(renderer, maximum_width, maximum_height, packing);
+			selected_node = new_atlas->add_surface(source_surface, source_area);
 	
 			assert(selected_node != NULL); // New atlas could not contain new surface, for some reason - this should not happen unless the system is out of video card memory storage
 	
@@ -362,11 +751,236 @@ namespace plf
 			atlases.push_back(new_atlas);
 		}
 	
+		selected_atlas->cache_image(selected_node, content_hash);
+	
+		if (source_surface != new_surface)
+		{
+			SDL_FreeSurface(source_surface);
+		}
+	
+		if (upload_deferral_depth == 0)
+		{
+			selected_atlas->commit();
+		}
+	
 		return std::pair<atlas *, atlas_node *> (selected_atlas, selected_node);
 	}
 	
 	
 	
+	void atlas_manager::end_uploads()
+	{
+		assert(upload_deferral_depth != 0); // end_uploads without matching begin_uploads
+	
+		if (--upload_deferral_depth == 0)
+		{
+			commit();
+		}
+	}
+	
+	
+	
+	void atlas_manager::commit()
+	{
+		for (std::vector<atlas *>::iterator current_atlas = atlases.begin(); current_atlas != atlases.end(); ++current_atlas)
+		{
+			(*current_atlas)->commit();
+		}
+	}
+	
+	
+	
+	atlas * atlas_manager::add_page(const unsigned int width, const unsigned int height, const void *pixels, const int pitch, const Uint32 pixel_format)
+	{
+		SDL_RendererInfo s_renderer_info = renderer->get_info();
+		plf_fail_if (static_cast<int>(width) > s_renderer_info.max_texture_width || static_cast<int>(height) > s_renderer_info.max_texture_height, "plf::atlas_manager add_page Error: page of size " << width << "/" << height << " is larger than the renderer's maximum texture size. ");
+	
+		atlas *new_atlas = new atlas(renderer, width, height, pixels, pitch, pixel_format);
+		atlases.push_back(new_atlas); // Any free space is used by later add_surface calls
+		return new_atlas;
+	}
+	
+	
+	
+	void atlas_manager::set_page_size(const unsigned int width, const unsigned int height)
+	{
+		assert(width != 0 && height != 0);
+		plf_fail_if(!atlases.empty(), "plf::atlas_manager set_page_size error: page size must be set before any images are added.");
+	
+		SDL_RendererInfo s_renderer_info = renderer->get_info();
+		maximum_width = std::min(static_cast<int>(width), s_renderer_info.max_texture_width);
+		maximum_height = std::min(static_cast<int>(height), s_renderer_info.max_texture_height);
+	
+		if (!is_power_of_two(maximum_width))
+		{
+			maximum_width = round_down_to_power_of_two(static_cast<unsigned int>(maximum_width));
+		}
+		if (!is_power_of_two(maximum_height))
+		{
+			maximum_height = round_down_to_power_of_two(static_cast<unsigned int>(maximum_height));
+		}
+	
+		if (static_cast<unsigned int>(maximum_width) != width || static_cast<unsigned int>(maximum_height) != height)
+		{
+			std::clog << "plf::atlas_manager set_page_size: requested page size " << width << " * " << height << " adjusted to " << maximum_width << " * " << maximum_height << "." << std::endl;
+		}
+	}
+	
+	
+	
+	void atlas_manager::get_occupancy(std::vector<atlas_occupancy> &page_occupancies)
+	{
+		page_occupancies.resize(atlases.size());
+	
+		for (unsigned int page = 0; page != atlases.size(); ++page)
+		{
+			atlases[page]->get_occupancy(page_occupancies[page]);
+		}
+	}
+	
+	
+	
+	void atlas_manager::log_occupancy()
+	{
+		std::vector<atlas_occupancy> page_occupancies;
+		get_occupancy(page_occupancies);
+		unsigned int total_used = 0, total_area = 0;
+	
+		std::clog << "plf::atlas_manager occupancy: " << page_occupancies.size() << " page(s) of " << maximum_width << " * " << maximum_height << ", " << ((packing == ATLAS_MAXRECTS) ? "maxrects" : "guillotine") << " packing for new pages." << std::endl;
+	
+		for (unsigned int page = 0; page != page_occupancies.size(); ++page)
+		{
+			const atlas_occupancy &occupancy = page_occupancies[page];
+			total_used += occupancy.used_pixels;
+			total_area += occupancy.width * occupancy.height;
+	
+			std::clog << "  Page " << page + 1 << ": " << occupancy.number_of_images << " images, " << static_cast<int>(occupancy.occupancy * 100) << "% used, largest free area " << occupancy.largest_free_width << " * " << occupancy.largest_free_height << ", " << static_cast<int>(occupancy.fragmentation * 100) << "% fragmented." << std::endl;
+		}
+	
+		if (total_area != 0)
+		{
+			std::clog << "  Total: " << static_cast<int>((static_cast<double>(total_used) / static_cast<double>(total_area)) * 100) << "% used." << std::endl;
+		}
+	}
+	
+	
+	
+	bool atlas_manager::is_taller(const std::pair<atlas *, atlas_node *> &image_a, const std::pair<atlas *, atlas_node *> &image_b)
+	{
+		const SDL_Rect &rect_a = *(image_a.second->image_rect), &rect_b = *(image_b.second->image_rect);
+		return (rect_a.h != rect_b.h) ? (rect_a.h > rect_b.h) : (rect_a.w > rect_b.w);
+	}
+	
+	
+	
+	int atlas_manager::compact()
+	{
+		std::vector<atlas *> old_atlases, kept_atlases;
+		std::vector<std::pair<atlas *, atlas_node *> > images;
+		std::vector<atlas_node *> page_images;
+	
+		for (std::vector<atlas *>::iterator current_atlas = atlases.begin(); current_atlas != atlases.end(); ++current_atlas)
+		{
+			if ((*current_atlas)->get_width() != static_cast<unsigned int>(maximum_width) || (*current_atlas)->get_height() != static_cast<unsigned int>(maximum_height))
+			{
+				kept_atlases.push_back(*current_atlas);
+				continue;
+			}
+	
+			old_atlases.push_back(*current_atlas);
+			page_images.clear();
+			(*current_atlas)->get_images(page_images);
+	
+			for (std::vector<atlas_node *>::iterator node_iterator = page_images.begin(); node_iterator != page_images.end(); ++node_iterator)
+			{
+				images.push_back(std::pair<atlas *, atlas_node *>(*current_atlas, *node_iterator));
+			}
+		}
+	
+		if (old_atlases.empty())
+		{
+			return 0;
+		}
+	
+		// Tallest first packs best for both packing methods:
+		std::sort(images.begin(), images.end(), is_taller);
+	
+		atlases.swap(kept_atlases);
+		const std::vector<atlas *>::size_type first_new_atlas = atlases.size();
+		atlas_node *new_node;
+		begin_uploads();
+	
+		for (std::vector<std::pair<atlas *, atlas_node *> >::iterator image_iterator = images.begin(); image_iterator != images.end(); ++image_iterator)
+		{
+			new_node = NULL;
+	
+			for (std::vector<atlas *>::iterator current_atlas = atlases.begin() + first_new_atlas; current_atlas != atlases.end() && new_node == NULL; ++current_atlas)
+			{
+				new_node = (*current_atlas)->move_image(*(image_iterator->first), image_iterator->second);
+			}
+	
+			if (new_node == NULL)
+			{
+				atlas *new_atlas = new atlas(renderer, maximum_width, maximum_height, packing);
+				atlases.push_back(new_atlas);
+				new_node = new_atlas->move_image(*(image_iterator->first), image_iterator->second);
+				assert(new_node != NULL); // Image came from a page of the same size, so must fit an empty one
+			}
+		}
+	
+		end_uploads();
+		++compactions; // Cached atlas locations are now stale
+	
+		// All images have moved - the old pages' nodes no longer have users:
+		for (std::vector<atlas *>::iterator current_atlas = old_atlases.begin(); current_atlas != old_atlases.end(); ++current_atlas)
+		{
+			delete *current_atlas;
+		}
+	
+		const int pages_freed = static_cast<int>(old_atlases.size()) - static_cast<int>(atlases.size() - first_new_atlas);
+		std::clog << "plf::atlas_manager compact: " << images.size() << " images repacked from " << old_atlases.size() << " to " << (atlases.size() - first_new_atlas) << " page(s)." << std::endl;
+		return pages_freed;
+	}
+	
+	
+	
+	unsigned int atlas_manager::get_memory_used()
+	{
+		unsigned int used_pixels = 0;
+	
+		for (std::vector<atlas *>::iterator current_atlas = atlases.begin(); current_atlas != atlases.end(); ++current_atlas)
+		{
+			used_pixels += (*current_atlas)->get_used_pixels();
+		}
+	
+		return used_pixels * SDL_BYTESPERPIXEL(renderer->get_texture_pixel_format());
+	}
+	
+	
+	
+	int atlas_manager::release_empty_pages()
+	{
+		int pages_freed = 0;
+	
+		for (std::vector<atlas *>::iterator current_atlas = atlases.begin(); current_atlas != atlases.end();)
+		{
+			if ((*current_atlas)->get_number_of_images() == 0)
+			{
+				delete *current_atlas;
+				current_atlas = atlases.erase(current_atlas);
+				++pages_freed;
+			}
+			else
+			{
+				++current_atlas;
+			}
+		}
+	
+		return pages_freed;
+	}
+	
+	
+	
 	SDL_Texture * atlas_manager::get_atlas_texture(const unsigned int atlas_number)
 	{
 		assert(atlas_number != 0);
@@ -2,10 +2,12 @@
 #define PLF_ATLAS_H
 
 #include <vector>
+#include <map>
 
 #include <SDL2/SDL.h>
 
 #include "plf_renderer.h"
+#include "plf_rectangle_packer.h"
 
 
 // A class detailing a segment of the texture atlas + subsegments - created recursively:
@@ -13,6 +15,31 @@
 namespace plf
 {
 
+	class texture;
+	
+	
+	
+	enum ATLAS_PACKING
+	{
+		ATLAS_GUILLOTINE,	// Binary split of the remaining space along its larger leftover dimension - fast, but fragments with mixed image sizes (default)
+		ATLAS_MAXRECTS		// Tracks every maximal free rectangle and places each image where it leaves the shortest leftover side - denser, but adds are slower
+	};
+	
+	
+	
+	// Space usage of a single atlas page:
+	struct atlas_occupancy
+	{
+		unsigned int width, height;
+		unsigned int number_of_images;
+		unsigned int used_pixels, free_pixels;
+		unsigned int largest_free_width, largest_free_height; // Largest single free rectangle, ie. the largest image that could still be added
+		double occupancy; // used_pixels / page area
+		double fragmentation; // 1 - (largest free rectangle area / free_pixels) - 0 = all free space is in one piece
+	};
+	
+	
+
 
 	class atlas_node
 	{
@@ -20,6 +47,11 @@ namespace plf
 		SDL_Rect *image_rect; // image_rect currently serves as both an indicator as to whether a node has an image in it, and a time-saving measure in terms of storing a permanent SDL_Rect to return. It is kinda redundant though, as it's information is already stored in the x,y etc coordinates below. Could be replaced with a bool
 		atlas_node *parent_node, *split_a, *split_b;
 		unsigned int x, y, width, height;
+		unsigned int references; // Number of textures using the image - identical images share a node
+		Uint64 content_hash;
+		bool opaque; // Image in this node has no transparent or semi-transparent pixels - determined when the image is added, used for occlusion culling
+		bool cached; // In its atlas's image_cache, under content_hash
+		std::vector<plf::texture *> users; // Textures drawing this image - relocated by atlas_manager::compact if the image moves
 	
 		friend class atlas;
 		friend class atlas_manager;
@@ -35,6 +67,10 @@ namespace plf
 		bool is_empty() {return image_rect == NULL;};
 		void consolidate_empty_children();
 		bool node_and_child_nodes_are_empty();
+		void get_largest_empty_node(unsigned int &largest_width, unsigned int &largest_height);
+		void get_images(std::vector<atlas_node *> &images); // All nodes in this subtree holding an image
+		void add_user(plf::texture *user);
+		void remove_user(plf::texture *user);
 		
 	};
 	
@@ -45,13 +81,37 @@ namespace plf
 	{
 	private:
 		SDL_Texture *atlas_texture;
+		SDL_Surface *staging_surface; // CPU copy of the page in texture format - images are converted into it as they're packed, and changed areas are uploaded by commit()
+		SDL_Rect dirty_area; // Bounds of everything staged since the last commit
+		bool has_dirty_area;
 		plf::renderer *renderer;
-		atlas_node *prime_node; // ie. top-level node of entire atlas - contains entire atlas within it
+		atlas_node *prime_node; // ie. top-level node of entire atlas - contains entire atlas within it. Unused by ATLAS_MAXRECTS
+		ATLAS_PACKING packing;
+		plf::rectangle_packer packer; // ATLAS_MAXRECTS only
+		std::vector<atlas_node *> placed_nodes; // ATLAS_MAXRECTS only - standalone nodes, owned by the atlas
+		std::map<Uint64, atlas_node *> image_cache; // Images by content hash, for sharing identical images
+		unsigned int width, height, number_of_images, used_pixels;
+	
+		atlas_node * add_placed_node(const SDL_Rect &placed);
+		void create_texture();
+		void add_dirty_area(const SDL_Rect &area);
 	public:
-		atlas(plf::renderer *p_renderer, const unsigned int atlas_width, const unsigned int atlas_height);
+		atlas(plf::renderer *p_renderer, const unsigned int atlas_width, const unsigned int atlas_height, const ATLAS_PACKING packing_method = ATLAS_GUILLOTINE);
+		atlas(plf::renderer *p_renderer, const unsigned int atlas_width, const unsigned int atlas_height, const void *pixels, const int pitch, const Uint32 pixel_format); // A pre-packed page, eg. from a baked atlas file - always ATLAS_MAXRECTS
 		~atlas();
-		atlas_node * add_surface(SDL_Surface *external_surface);
-		void remove_surface(atlas_node *node);
+		atlas_node * add_surface(SDL_Surface *external_surface, const SDL_Rect *source_area = NULL); // Staged only - not visible until commit(). source_area copies only that part of the surface, eg. one frame of a tile sheet
+		atlas_node * add_region(const SDL_Rect &region, const bool opaque); // Claim an area of a pre-packed page which already holds an image
+		void remove_surface(atlas_node *node); // Removes one reference - the image is removed once no textures use it
+		atlas_node * find_image(const Uint64 content_hash, SDL_Surface *source_surface, const SDL_Rect &area); // An image already in the atlas with identical content to area of source_surface (compared pixel-for-pixel on a hash match), or NULL - adds a reference if found
+		void cache_image(atlas_node *node, const Uint64 content_hash);
+		atlas_node * move_image(atlas &source_atlas, atlas_node *source_node); // Copy an image from another page's staging surface, and relocate its textures to this page - the source node is left for the source atlas to delete. NULL if there's no room
+		void get_images(std::vector<atlas_node *> &images);
+		inline unsigned int get_width() { return width; };
+		inline unsigned int get_height() { return height; };
+		inline unsigned int get_number_of_images() { return number_of_images; };
+		inline unsigned int get_used_pixels() { return used_pixels; };
+		void get_occupancy(atlas_occupancy &occupancy);
+		void commit(); // Upload all staged images with a single texture update
 	
 		SDL_Texture * get_texture();
 	};
@@ -64,13 +124,54 @@ namespace plf
 	private:
 		std::vector<atlas *> atlases;
 		plf::renderer *renderer;
-		int maximum_width, maximum_height;
+		int maximum_width, maximum_height; // Page size
+		ATLAS_PACKING packing;
+		unsigned int upload_deferral_depth;
+		unsigned int memory_budget; // Bytes, 0 = unlimited
+		unsigned int frame_number; // Advanced by sprite_manager::update_residency, for least-recently-drawn tracking
+		unsigned int evictions, reloads;
+		unsigned int compactions; // Number of compact() calls which moved images
 	
+		static bool is_taller(const std::pair<atlas *, atlas_node *> &image_a, const std::pair<atlas *, atlas_node *> &image_b); // Compaction order
 	public:
 		atlas_manager(plf::renderer *_renderer);
 		~atlas_manager();
 		
-		std::pair<atlas *, atlas_node *> add_surface(SDL_Surface *new_surface);
+		std::pair<atlas *, atlas_node *> add_surface(SDL_Surface *new_surface, const SDL_Rect *source_area = NULL); // source_area: as for atlas::add_surface. An image identical to one already in an atlas shares its node
+	
+		// Images added between begin_uploads and end_uploads are staged, then uploaded with one texture update per changed page at end_uploads (or commit) - otherwise each image is uploaded as it's added.
+		// Calls can be nested. Staged images aren't visible until they're uploaded:
+		inline void begin_uploads() { ++upload_deferral_depth; };
+		void end_uploads();
+		void commit();
+		atlas * add_page(const unsigned int width, const unsigned int height, const void *pixels, const int pitch, const Uint32 pixel_format); // Add a pre-packed page - images are then claimed with atlas::add_region
+	
+		// By default pages are the size of the renderer, rounded down to powers of two. set_page_size overrides this with any size up to the renderer's maximum texture size (also rounded down to powers of two) - it must be called before any images are added.
+		// The packing method only applies to pages created afterwards:
+		void set_page_size(const unsigned int width, const unsigned int height);
+		inline void set_packing(const ATLAS_PACKING packing_method) { packing = packing_method; };
+		void get_occupancy(std::vector<atlas_occupancy> &page_occupancies); // One per page, in page order
+		void log_occupancy(); // Writes a per-page occupancy and fragmentation report to the log
+	
+		// Repack every image into as few pages as possible, tallest first, copying from the pages' staging surfaces, then free the old pages. Textures are updated in place, so sprites are unaffected.
+		// Pre-packed pages of a different size to the current page size are left as they are. Must be called between frames, as any draws already recorded for the current frame refer to the old pages.
+		// Tilemaps and particle emitters cache atlas locations - they compare get_number_of_compactions() against the count they were built at, and rebuild them at their next draw. Returns the number of pages freed:
+		int compact();
+		inline unsigned int get_number_of_compactions() { return compactions; };
+	
+		// Texture memory budget - when the atlas memory used by images exceeds it, sprite_manager::update_residency evicts the least-recently-drawn sprites which can be reloaded from their image files. Evicted sprites reload themselves the next time they're drawn.
+		// Page memory is freed once a page is emptied - compact() can reclaim more:
+		inline void set_memory_budget(const unsigned int bytes) { memory_budget = bytes; }; // 0 = unlimited (default)
+		inline unsigned int get_memory_budget() { return memory_budget; };
+		unsigned int get_memory_used(); // Bytes of atlas texture holding images
+		inline bool is_over_memory_budget() { return memory_budget != 0 && get_memory_used() > memory_budget; };
+		int release_empty_pages(); // Free pages holding no images - returns the number freed. Must be called between frames, as for compact()
+		inline unsigned int get_frame_number() { return frame_number; };
+		inline void advance_frame() { ++frame_number; };
+		inline void count_eviction() { ++evictions; };
+		inline void count_reload() { ++reloads; };
+		inline unsigned int get_number_of_evictions() { return evictions; };
+		inline unsigned int get_number_of_reloads() { return reloads; };
 	
 		// utility function in case you want to see what the atlas itself looks like, or whatever:
 		SDL_Texture * get_atlas_texture(const unsigned int atlas_number); // first number is 1, not 0.
@@ -0,0 +1,405 @@
+// plf_atlas_baker - offline atlas baking tool. Packs every frame of the sprites listed in a manifest into atlas pages, and writes them as a single baked atlas file for plf::load_baked_atlas.
+// Build as a separate executable from this file, plf_rectangle_packer.cpp and plf_utility.cpp, linked against SDL2 and SDL2_image.
+//
+// Usage: plf_atlas_baker manifest_file output_file [page_width page_height [pixel_format]]
+// Page size defaults to 1024 * 1024, pixel format to ARGB8888 (the most common renderer texture format - pages in other formats are converted at load).
+//
+// Manifest format, one command per line, '#' for comments. Frame commands apply to the most recent sprite, and match the plf::sprite functions of the same name:
+//  sprite id loop|no_loop left|right|center top|bottom|middle
+//  frame image_filename milliseconds
+//  frames image_filename_fragment number_of_frames milliseconds_per_frame   (loads fragment1.png, fragment2.png...)
+//  tile image_filename number_of_frames frame_width milliseconds
+//  collision frame_number x y w h   (frame numbers are 0-based, as in plf::sprite::add_collision_block_to_frame)
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <algorithm> // std::sort
+#include <cstring> // std::memcpy
+#include <cstdlib> // std::atoi
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+
+#include "plf_utility.h"
+#include "plf_rectangle_packer.h"
+#include "plf_sprite.h"
+#include "plf_baked_atlas.h"
+
+
+namespace
+{
+
+	struct bake_frame
+	{
+		SDL_Surface *surface; // In the output pixel format
+		std::vector<plf::baked_collision_block> collision_blocks;
+		unsigned int milliseconds, page;
+		SDL_Rect location;
+	};
+
+
+	struct bake_sprite
+	{
+		std::string id;
+		std::vector<bake_frame> frames;
+		plf::LOOPING loop;
+		plf::HORIZONTAL_ALIGNMENT horizontal_alignment;
+		plf::VERTICAL_ALIGNMENT vertical_alignment;
+	};
+
+
+
+	SDL_Surface * load_frame(const std::string &filename, const Uint32 pixel_format)
+	{
+		SDL_Surface *loaded_surface = IMG_Load(filename.c_str());
+
+		if (loaded_surface == NULL)
+		{
+			std::cerr << "Unable to load image '" << filename << "': " << IMG_GetError() << std::endl;
+			return NULL;
+		}
+
+		SDL_Surface *converted_surface = SDL_ConvertSurfaceFormat(loaded_surface, pixel_format, 0);
+		SDL_FreeSurface(loaded_surface);
+		return converted_surface;
+	}
+
+
+
+	bool add_frame(bake_sprite *current_sprite, SDL_Surface *surface, const unsigned int milliseconds)
+	{
+		if (current_sprite == NULL || surface == NULL)
+		{
+			return false;
+		}
+
+		current_sprite->frames.push_back(bake_frame());
+		current_sprite->frames.back().surface = surface;
+		current_sprite->frames.back().milliseconds = milliseconds;
+		return true;
+	}
+
+
+
+	// Returns false on any error, which is reported to std::cerr:
+	bool read_manifest(const char *manifest_filename, const Uint32 pixel_format, std::vector<bake_sprite> &sprites)
+	{
+		std::ifstream manifest(manifest_filename);
+
+		if (!manifest)
+		{
+			std::cerr << "Unable to open manifest '" << manifest_filename << "'." << std::endl;
+			return false;
+		}
+
+		std::string line, command, filename;
+		unsigned int line_number = 0, number_of_frames, frame_width, milliseconds;
+
+		while (std::getline(manifest, line))
+		{
+			++line_number;
+			std::istringstream arguments(line);
+
+			if (!(arguments >> command) || command[0] == '#')
+			{
+				continue;
+			}
+
+			bake_sprite *current_sprite = (sprites.empty()) ? NULL : &(sprites.back());
+			bool valid = false;
+
+			if (command == "sprite")
+			{
+				std::string loop, horizontal, vertical;
+				sprites.push_back(bake_sprite());
+				bake_sprite &new_sprite = sprites.back();
+
+				if (arguments >> new_sprite.id >> loop >> horizontal >> vertical)
+				{
+					new_sprite.loop = (loop == "loop") ? plf::LOOP : plf::NO_LOOP;
+					new_sprite.horizontal_alignment = (horizontal == "right") ? plf::ALIGN_RIGHT : (horizontal == "center") ? plf::ALIGN_CENTER : plf::ALIGN_LEFT;
+					new_sprite.vertical_alignment = (vertical == "bottom") ? plf::ALIGN_BOTTOM : (vertical == "middle") ? plf::ALIGN_MIDDLE : plf::ALIGN_TOP;
+					valid = true;
+				}
+			}
+			else if (command == "frame" && arguments >> filename >> milliseconds)
+			{
+				valid = add_frame(current_sprite, load_frame(filename, pixel_format), milliseconds);
+			}
+			else if (command == "frames" && arguments >> filename >> number_of_frames >> milliseconds)
+			{
+				valid = true;
+
+				for (unsigned int frame_number = 1; frame_number <= number_of_frames && valid; ++frame_number)
+				{
+					std::ostringstream frame_filename;
+					frame_filename << filename << frame_number << ".png";
+					valid = add_frame(current_sprite, load_frame(frame_filename.str(), pixel_format), milliseconds);
+				}
+			}
+			else if (command == "tile" && arguments >> filename >> number_of_frames >> frame_width >> milliseconds)
+			{
+				SDL_Surface *tiles_surface = load_frame(filename, pixel_format);
+				valid = (tiles_surface != NULL && tiles_surface->w == static_cast<int>(number_of_frames * frame_width));
+
+				if (tiles_surface != NULL)
+				{
+					SDL_SetSurfaceBlendMode(tiles_surface, SDL_BLENDMODE_NONE);
+					SDL_Rect source_rectangle = {0, 0, static_cast<int>(frame_width), tiles_surface->h};
+
+					for (unsigned int frame_number = 0; frame_number != number_of_frames && valid; ++frame_number, source_rectangle.x += frame_width)
+					{
+						SDL_Surface *frame_surface = SDL_CreateRGBSurfaceWithFormat(0, frame_width, tiles_surface->h, 32, pixel_format);
+						valid = (frame_surface != NULL && SDL_BlitSurface(tiles_surface, &source_rectangle, frame_surface, NULL) == 0 && add_frame(current_sprite, frame_surface, milliseconds));
+					}
+
+					SDL_FreeSurface(tiles_surface);
+				}
+			}
+			else if (command == "collision" && current_sprite != NULL)
+			{
+				unsigned int frame_number;
+				plf::baked_collision_block block;
+
+				if (arguments >> frame_number >> block.x >> block.y >> block.w >> block.h && frame_number < current_sprite->frames.size())
+				{
+					current_sprite->frames[frame_number].collision_blocks.push_back(block);
+					valid = true;
+				}
+			}
+
+			if (!valid)
+			{
+				std::cerr << manifest_filename << " line " << line_number << ": invalid command '" << line << "'." << std::endl;
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+
+
+	bool taller_first(const bake_frame *a, const bake_frame *b)
+	{
+		return (a->surface->h != b->surface->h) ? a->surface->h > b->surface->h : a->surface->w > b->surface->w;
+	}
+
+}
+
+
+
+int main(int argc, char *argv[])
+{
+	if (argc != 3 && argc != 5 && argc != 6)
+	{
+		std::cerr << "Usage: plf_atlas_baker manifest_file output_file [page_width page_height [pixel_format]]" << std::endl;
+		return 1;
+	}
+
+	const unsigned int page_width = (argc >= 5) ? static_cast<unsigned int>(std::atoi(argv[3])) : 1024;
+	const unsigned int page_height = (argc >= 5) ? static_cast<unsigned int>(std::atoi(argv[4])) : 1024;
+	Uint32 pixel_format = SDL_PIXELFORMAT_ARGB8888;
+
+	if (argc == 6)
+	{
+		const Uint32 formats[4] = {SDL_PIXELFORMAT_ARGB8888, SDL_PIXELFORMAT_ABGR8888, SDL_PIXELFORMAT_RGBA8888, SDL_PIXELFORMAT_BGRA8888};
+		pixel_format = SDL_PIXELFORMAT_UNKNOWN;
+
+		for (unsigned int format = 0; format != 4; ++format)
+		{
+			if (std::string("SDL_PIXELFORMAT_") + argv[5] == SDL_GetPixelFormatName(formats[format]))
+			{
+				pixel_format = formats[format];
+			}
+		}
+
+		if (pixel_format == SDL_PIXELFORMAT_UNKNOWN)
+		{
+			std::cerr << "Unsupported pixel format '" << argv[5] << "' - use ARGB8888, ABGR8888, RGBA8888 or BGRA8888." << std::endl;
+			return 1;
+		}
+	}
+
+	if (page_width == 0 || page_height == 0 || SDL_Init(0) != 0 || (IMG_Init(IMG_INIT_PNG | IMG_INIT_JPG) & IMG_INIT_PNG) == 0)
+	{
+		std::cerr << "Invalid page size, or SDL/SDL_image could not be initialised." << std::endl;
+		return 1;
+	}
+
+	std::vector<bake_sprite> sprites;
+
+	if (!read_manifest(argv[1], pixel_format, sprites))
+	{
+		return 1;
+	}
+
+	// Pack all frames, tallest first, filling each page before starting the next:
+	std::vector<bake_frame *> packing_order;
+
+	for (std::vector<bake_sprite>::iterator sprite_iterator = sprites.begin(); sprite_iterator != sprites.end(); ++sprite_iterator)
+	{
+		for (std::vector<bake_frame>::iterator frame_iterator = sprite_iterator->frames.begin(); frame_iterator != sprite_iterator->frames.end(); ++frame_iterator)
+		{
+			if (frame_iterator->surface->w > static_cast<int>(page_width) || frame_iterator->surface->h > static_cast<int>(page_height))
+			{
+				std::cerr << "A frame of sprite '" << sprite_iterator->id << "' (" << frame_iterator->surface->w << " * " << frame_iterator->surface->h << ") is larger than the page size." << std::endl;
+				return 1;
+			}
+
+			packing_order.push_back(&*frame_iterator);
+		}
+	}
+
+	if (packing_order.empty())
+	{
+		std::cerr << "Manifest '" << argv[1] << "' contains no valid frames - nothing to bake." << std::endl;
+		return 1;
+	}
+
+	std::stable_sort(packing_order.begin(), packing_order.end(), taller_first);
+	std::vector<plf::rectangle_packer> packers;
+
+	for (std::vector<bake_frame *>::iterator frame_iterator = packing_order.begin(); frame_iterator != packing_order.end(); ++frame_iterator)
+	{
+		bake_frame &frame = **frame_iterator;
+		frame.page = 0;
+
+		while (frame.page != packers.size() && !packers[frame.page].insert(frame.surface->w, frame.surface->h, frame.location))
+		{
+			++frame.page;
+		}
+
+		if (frame.page == packers.size())
+		{
+			packers.push_back(plf::rectangle_packer(page_width, page_height));
+			packers.back().insert(frame.surface->w, frame.surface->h, frame.location);
+		}
+	}
+
+	// Copy frames into page pixels:
+	const unsigned int pitch = page_width * 4;
+	std::vector< std::vector<Uint8> > page_pixels(packers.size(), std::vector<Uint8>(pitch * page_height, 0));
+
+	for (std::vector<bake_frame *>::iterator frame_iterator = packing_order.begin(); frame_iterator != packing_order.end(); ++frame_iterator)
+	{
+		const bake_frame &frame = **frame_iterator;
+		SDL_LockSurface(frame.surface);
+
+		for (int row = 0; row != frame.location.h; ++row)
+		{
+			std::memcpy(&page_pixels[frame.page][((frame.location.y + row) * pitch) + (frame.location.x * 4)], static_cast<const Uint8 *>(frame.surface->pixels) + (row * frame.surface->pitch), frame.location.w * 4);
+		}
+
+		SDL_UnlockSurface(frame.surface);
+	}
+
+	// Build tables:
+	plf::baked_atlas_header header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, "PLFA", 4);
+	header.version = plf::baked_atlas_version;
+	header.pixel_format = pixel_format;
+	header.number_of_pages = static_cast<Uint32>(packers.size());
+	header.number_of_sprites = static_cast<Uint32>(sprites.size());
+
+	std::vector<plf::baked_sprite> baked_sprites;
+	std::vector<plf::baked_frame> baked_frames;
+	std::vector<plf::baked_collision_block> baked_collision_blocks;
+	std::string strings;
+
+	for (std::vector<bake_sprite>::iterator sprite_iterator = sprites.begin(); sprite_iterator != sprites.end(); ++sprite_iterator)
+	{
+		plf::baked_sprite baked_sprite;
+		std::memset(&baked_sprite, 0, sizeof(baked_sprite));
+		baked_sprite.id_offset = static_cast<Uint32>(strings.size());
+		baked_sprite.id_length = static_cast<Uint32>(sprite_iterator->id.size());
+		baked_sprite.first_frame = static_cast<Uint32>(baked_frames.size());
+		baked_sprite.number_of_frames = static_cast<Uint32>(sprite_iterator->frames.size());
+		baked_sprite.loop = (sprite_iterator->loop == plf::LOOP) ? 1 : 0;
+		baked_sprite.horizontal_alignment = static_cast<Uint8>(sprite_iterator->horizontal_alignment);
+		baked_sprite.vertical_alignment = static_cast<Uint8>(sprite_iterator->vertical_alignment);
+		baked_sprites.push_back(baked_sprite);
+		strings += sprite_iterator->id;
+
+		for (std::vector<bake_frame>::iterator frame_iterator = sprite_iterator->frames.begin(); frame_iterator != sprite_iterator->frames.end(); ++frame_iterator)
+		{
+			plf::baked_frame baked_frame;
+			std::memset(&baked_frame, 0, sizeof(baked_frame));
+			baked_frame.page = frame_iterator->page;
+			baked_frame.x = frame_iterator->location.x;
+			baked_frame.y = frame_iterator->location.y;
+			baked_frame.width = frame_iterator->location.w;
+			baked_frame.height = frame_iterator->location.h;
+			baked_frame.milliseconds = frame_iterator->milliseconds;
+			baked_frame.first_collision_block = static_cast<Uint32>(baked_collision_blocks.size());
+			baked_frame.number_of_collision_blocks = static_cast<Uint32>(frame_iterator->collision_blocks.size());
+			baked_frame.opaque = plf::surface_is_opaque(frame_iterator->surface) ? 1 : 0;
+			baked_frames.push_back(baked_frame);
+			baked_collision_blocks.insert(baked_collision_blocks.end(), frame_iterator->collision_blocks.begin(), frame_iterator->collision_blocks.end());
+			SDL_FreeSurface(frame_iterator->surface);
+		}
+	}
+
+	header.number_of_frames = static_cast<Uint32>(baked_frames.size());
+	header.number_of_collision_blocks = static_cast<Uint32>(baked_collision_blocks.size());
+	header.string_table_offset = static_cast<Uint32>(sizeof(header) + (packers.size() * sizeof(plf::baked_page)) + (baked_sprites.size() * sizeof(plf::baked_sprite)) + (baked_frames.size() * sizeof(plf::baked_frame)) + (baked_collision_blocks.size() * sizeof(plf::baked_collision_block)));
+	header.string_table_size = static_cast<Uint32>(strings.size());
+
+	std::vector<plf::baked_page> baked_pages(packers.size());
+	Uint32 pixel_offset = (header.string_table_offset + header.string_table_size + 15) & ~15u; // 16-byte aligned
+
+	for (std::vector<plf::baked_page>::iterator page_iterator = baked_pages.begin(); page_iterator != baked_pages.end(); ++page_iterator)
+	{
+		page_iterator->width = page_width;
+		page_iterator->height = page_height;
+		page_iterator->pitch = pitch;
+		page_iterator->pixel_offset = pixel_offset;
+		pixel_offset += pitch * page_height; // pitch is a multiple of 4 and page sizes are usually powers of two, but keep alignment regardless:
+		pixel_offset = (pixel_offset + 15) & ~15u;
+	}
+
+	// Write file:
+	std::ofstream output(argv[2], std::ios::out | std::ios::binary | std::ios::trunc);
+	output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	output.write(reinterpret_cast<const char *>(&baked_pages[0]), baked_pages.size() * sizeof(plf::baked_page));
+
+	if (!baked_sprites.empty())
+	{
+		output.write(reinterpret_cast<const char *>(&baked_sprites[0]), baked_sprites.size() * sizeof(plf::baked_sprite));
+	}
+
+	if (!baked_frames.empty())
+	{
+		output.write(reinterpret_cast<const char *>(&baked_frames[0]), baked_frames.size() * sizeof(plf::baked_frame));
+	}
+
+	if (!baked_collision_blocks.empty())
+	{
+		output.write(reinterpret_cast<const char *>(&baked_collision_blocks[0]), baked_collision_blocks.size() * sizeof(plf::baked_collision_block));
+	}
+
+	output.write(strings.data(), strings.size());
+
+	for (unsigned int page = 0; page != baked_pages.size(); ++page)
+	{
+		const std::streamoff padding = static_cast<std::streamoff>(baked_pages[page].pixel_offset) - output.tellp();
+		output.write("\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0", padding);
+		output.write(reinterpret_cast<const char *>(&page_pixels[page][0]), page_pixels[page].size());
+	}
+
+	if (!output)
+	{
+		std::cerr << "Unable to write '" << argv[2] << "'." << std::endl;
+		return 1;
+	}
+
+	std::cout << "Baked " << sprites.size() << " sprites (" << baked_frames.size() << " frames) onto " << packers.size() << " " << page_width << " * " << page_height << " pages in '" << argv[2] << "'." << std::endl;
+
+	IMG_Quit();
+	SDL_Quit();
+	return 0;
+}
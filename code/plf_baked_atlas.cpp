@@ -0,0 +1,279 @@
+#include <string>
+#include <vector>
+#include <set>
+#include <iostream>
+#include <cstring> // std::memcmp
+#include <cassert>
+
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+#include <SDL2/SDL.h>
+
+#include "plf_utility.h"
+#include "plf_renderer.h"
+#include "plf_atlas.h"
+#include "plf_texture.h"
+#include "plf_sprite.h"
+#include "plf_baked_atlas.h"
+
+
+namespace plf
+{
+
+	// A read-only memory mapping of a whole file, unmapped on destruction:
+	class mapped_file
+	{
+	private:
+		const Uint8 *data;
+		size_t size;
+	#ifdef _WIN32
+		HANDLE file, mapping;
+	#else
+		int file;
+	#endif
+	public:
+		mapped_file(const char *filename);
+		~mapped_file();
+		inline const Uint8 * get_data() { return data; };
+		inline size_t get_size() { return size; };
+	};
+
+
+
+	mapped_file::mapped_file(const char *filename):
+		data(NULL),
+		size(0)
+	{
+	#ifdef _WIN32
+		mapping = NULL;
+		file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return;
+		}
+
+		LARGE_INTEGER file_size;
+
+		if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+		{
+			return;
+		}
+
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+		if (mapping == NULL)
+		{
+			return;
+		}
+
+		data = static_cast<const Uint8 *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+
+		if (data != NULL)
+		{
+			size = static_cast<size_t>(file_size.QuadPart);
+		}
+	#else
+		file = open(filename, O_RDONLY);
+
+		if (file == -1)
+		{
+			return;
+		}
+
+		struct stat file_status;
+
+		if (fstat(file, &file_status) != 0 || file_status.st_size == 0)
+		{
+			return;
+		}
+
+		void *mapped = mmap(NULL, static_cast<size_t>(file_status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+
+		if (mapped != MAP_FAILED)
+		{
+			data = static_cast<const Uint8 *>(mapped);
+			size = static_cast<size_t>(file_status.st_size);
+		}
+	#endif
+	}
+
+
+
+	mapped_file::~mapped_file()
+	{
+	#ifdef _WIN32
+		if (data != NULL)
+		{
+			UnmapViewOfFile(data);
+		}
+
+		if (mapping != NULL)
+		{
+			CloseHandle(mapping);
+		}
+
+		if (file != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(file);
+		}
+	#else
+		if (data != NULL)
+		{
+			munmap(const_cast<Uint8 *>(data), size);
+		}
+
+		if (file != -1)
+		{
+			close(file);
+		}
+	#endif
+	}
+
+
+
+	int load_baked_atlas(const char *filename, plf::renderer *renderer, plf::atlas_manager *atlas_manager, plf::sprite_manager *sprite_manager)
+	{
+		assert(filename != NULL);
+		assert(renderer != NULL && atlas_manager != NULL && sprite_manager != NULL);
+
+		mapped_file file(filename);
+
+		if (file.get_data() == NULL)
+		{
+			std::clog << "plf::load_baked_atlas error: unable to map file '" << filename << "'." << std::endl;
+			return -1;
+		}
+
+		const Uint8 *data = file.get_data();
+		const size_t size = file.get_size();
+		const baked_atlas_header *header = reinterpret_cast<const baked_atlas_header *>(data);
+
+		if (size < sizeof(baked_atlas_header) || std::memcmp(header->magic, "PLFA", 4) != 0 || header->version != baked_atlas_version)
+		{
+			std::clog << "plf::load_baked_atlas error: '" << filename << "' is not a version " << baked_atlas_version << " baked atlas file." << std::endl;
+			return -1;
+		}
+
+		// Section sizes, checked against the file size before anything is read from them (64-bit, so that corrupt counts can't wrap):
+		const Uint64 pages_offset = sizeof(baked_atlas_header);
+		const Uint64 sprites_offset = pages_offset + (static_cast<Uint64>(header->number_of_pages) * sizeof(baked_page));
+		const Uint64 frames_offset = sprites_offset + (static_cast<Uint64>(header->number_of_sprites) * sizeof(baked_sprite));
+		const Uint64 collision_blocks_offset = frames_offset + (static_cast<Uint64>(header->number_of_frames) * sizeof(baked_frame));
+		const Uint64 tables_end = collision_blocks_offset + (static_cast<Uint64>(header->number_of_collision_blocks) * sizeof(baked_collision_block));
+
+		if (tables_end > size || static_cast<Uint64>(header->string_table_offset) + header->string_table_size > size)
+		{
+			std::clog << "plf::load_baked_atlas error: '" << filename << "' is truncated." << std::endl;
+			return -1;
+		}
+
+		const baked_page *pages = reinterpret_cast<const baked_page *>(data + pages_offset);
+		const baked_sprite *sprites = reinterpret_cast<const baked_sprite *>(data + sprites_offset);
+		const baked_frame *frames = reinterpret_cast<const baked_frame *>(data + frames_offset);
+		const baked_collision_block *collision_blocks = reinterpret_cast<const baked_collision_block *>(data + collision_blocks_offset);
+		const char *strings = reinterpret_cast<const char *>(data + header->string_table_offset);
+
+		// Validate every entry before anything is registered, so that a malformed file leaves the atlas and sprite managers untouched:
+		const unsigned int bytes_per_pixel = SDL_BYTESPERPIXEL(header->pixel_format);
+		const SDL_RendererInfo renderer_info = renderer->get_info();
+
+		if (bytes_per_pixel == 0)
+		{
+			std::clog << "plf::load_baked_atlas error: '" << filename << "' has an invalid pixel format." << std::endl;
+			return -1;
+		}
+
+		for (const baked_page *page = pages; page != pages + header->number_of_pages; ++page)
+		{
+			if (page->width == 0 || page->height == 0 || static_cast<Uint64>(page->pitch) < static_cast<Uint64>(page->width) * bytes_per_pixel || page->pitch > static_cast<Uint32>(SDL_MAX_SINT32))
+			{
+				std::clog << "plf::load_baked_atlas error: '" << filename << "' has an invalid page entry." << std::endl;
+				return -1;
+			}
+
+			if (static_cast<Uint64>(page->pixel_offset) + (static_cast<Uint64>(page->pitch) * page->height) > size)
+			{
+				std::clog << "plf::load_baked_atlas error: '" << filename << "' is truncated." << std::endl;
+				return -1;
+			}
+
+			if (page->width > static_cast<Uint32>(renderer_info.max_texture_width) || page->height > static_cast<Uint32>(renderer_info.max_texture_height))
+			{
+				std::clog << "plf::load_baked_atlas error: '" << filename << "' has a page of size " << page->width << "/" << page->height << ", which is larger than the renderer's maximum texture size." << std::endl;
+				return -1;
+			}
+		}
+
+		for (const baked_frame *frame = frames; frame != frames + header->number_of_frames; ++frame)
+		{
+			if (frame->page >= header->number_of_pages || static_cast<Uint64>(frame->first_collision_block) + frame->number_of_collision_blocks > header->number_of_collision_blocks ||
+				frame->x < 0 || frame->y < 0 || frame->width <= 0 || frame->height <= 0 ||
+				static_cast<Uint64>(frame->x) + static_cast<Uint64>(frame->width) > pages[frame->page].width || static_cast<Uint64>(frame->y) + static_cast<Uint64>(frame->height) > pages[frame->page].height)
+			{
+				std::clog << "plf::load_baked_atlas error: '" << filename << "' has an invalid frame entry." << std::endl;
+				return -1;
+			}
+		}
+
+		std::set<std::string> ids;
+
+		for (const baked_sprite *current_sprite = sprites; current_sprite != sprites + header->number_of_sprites; ++current_sprite)
+		{
+			if (static_cast<Uint64>(current_sprite->id_offset) + current_sprite->id_length > header->string_table_size || static_cast<Uint64>(current_sprite->first_frame) + current_sprite->number_of_frames > header->number_of_frames ||
+				current_sprite->horizontal_alignment > ALIGN_CENTER || current_sprite->vertical_alignment > ALIGN_MIDDLE)
+			{
+				std::clog << "plf::load_baked_atlas error: '" << filename << "' has an invalid sprite entry." << std::endl;
+				return -1;
+			}
+
+			const std::string id(strings + current_sprite->id_offset, current_sprite->id_length);
+
+			if (!ids.insert(id).second || sprite_manager->get_sprite(id) != NULL)
+			{
+				std::clog << "plf::load_baked_atlas error: '" << filename << "' has a sprite id '" << id << "' which is already in use." << std::endl;
+				return -1;
+			}
+		}
+
+		// Upload each page straight from the mapping:
+		std::vector<plf::atlas *> atlases;
+
+		for (const baked_page *page = pages; page != pages + header->number_of_pages; ++page)
+		{
+			atlases.push_back(atlas_manager->add_page(page->width, page->height, data + page->pixel_offset, static_cast<int>(page->pitch), header->pixel_format));
+		}
+
+		// Create sprites, claiming each frame's region of its page:
+		for (const baked_sprite *current_sprite = sprites; current_sprite != sprites + header->number_of_sprites; ++current_sprite)
+		{
+			const std::string id(strings + current_sprite->id_offset, current_sprite->id_length);
+			plf::sprite *new_sprite = sprite_manager->new_sprite(id, (current_sprite->loop == 1) ? LOOP : NO_LOOP, static_cast<HORIZONTAL_ALIGNMENT>(current_sprite->horizontal_alignment), static_cast<VERTICAL_ALIGNMENT>(current_sprite->vertical_alignment));
+
+			for (const baked_frame *frame = frames + current_sprite->first_frame; frame != frames + current_sprite->first_frame + current_sprite->number_of_frames; ++frame)
+			{
+				const SDL_Rect region = {frame->x, frame->y, frame->width, frame->height};
+				plf::atlas_node *node = atlases[frame->page]->add_region(region, frame->opaque == 1);
+				new_sprite->add_frame(new plf::texture(renderer, atlases[frame->page], node), frame->width, frame->height, frame->milliseconds);
+
+				const unsigned int frame_number = new_sprite->get_number_of_frames() - 1; // Collision block frame numbers are 0-based
+
+				for (const baked_collision_block *block = collision_blocks + frame->first_collision_block; block != collision_blocks + frame->first_collision_block + frame->number_of_collision_blocks; ++block)
+				{
+					new_sprite->add_collision_block_to_frame(frame_number, block->x, block->y, block->w, block->h);
+				}
+			}
+		}
+
+		std::clog << "plf::load_baked_atlas: loaded " << header->number_of_sprites << " sprites (" << header->number_of_frames << " frames) on " << header->number_of_pages << " pages from '" << filename << "'." << std::endl;
+		return 0;
+	}
+
+}
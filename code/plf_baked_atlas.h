@@ -0,0 +1,77 @@
+#ifndef PLF_BAKED_ATLAS_H
+#define PLF_BAKED_ATLAS_H
+
+#include <SDL2/SDL.h>
+
+#include "plf_renderer.h"
+#include "plf_atlas.h"
+#include "plf_sprite.h"
+
+
+namespace plf
+{
+
+	// Baked atlas file layout, written by plf_atlas_baker and read by load_baked_atlas. All values are native-endian, and page pixels are 16-byte aligned:
+	//  header
+	//  baked_page[number_of_pages]
+	//  baked_sprite[number_of_sprites]
+	//  baked_frame[number_of_frames]
+	//  baked_collision_block[number_of_collision_blocks]
+	//  string table (sprite ids, not null-terminated)
+	//  page pixels, pitch * height bytes per page, in pixel_format
+
+	static const Uint32 baked_atlas_version = 1;
+
+	struct baked_atlas_header
+	{
+		char magic[4]; // "PLFA"
+		Uint32 version;
+		Uint32 pixel_format; // SDL_PixelFormatEnum of page pixels - converted at load if it isn't the renderer's texture format
+		Uint32 number_of_pages, number_of_sprites, number_of_frames, number_of_collision_blocks;
+		Uint32 string_table_offset, string_table_size;
+		Uint32 padding[3];
+	};
+
+
+	struct baked_page
+	{
+		Uint32 width, height, pitch;
+		Uint32 pixel_offset; // From the start of the file
+	};
+
+
+	struct baked_sprite
+	{
+		Uint32 id_offset, id_length; // Within the string table
+		Uint32 first_frame, number_of_frames;
+		Uint8 loop; // 1 = LOOP
+		Uint8 horizontal_alignment, vertical_alignment; // HORIZONTAL_ALIGNMENT/VERTICAL_ALIGNMENT values
+		Uint8 padding;
+	};
+
+
+	struct baked_frame
+	{
+		Uint32 page;
+		Sint32 x, y, width, height; // Location within the page
+		Uint32 milliseconds;
+		Uint32 first_collision_block, number_of_collision_blocks;
+		Uint8 opaque; // No transparent or semi-transparent pixels
+		Uint8 padding[3];
+	};
+
+
+	struct baked_collision_block
+	{
+		Sint32 x, y, w, h;
+	};
+
+
+
+	// Memory-map a baked atlas file, and create an atlas page for each of its pages and a sprite for each of its sprites, without decoding or packing any images. Sprite alignment offsets are derived from the frame sizes, as with sprites loaded from images.
+	// Pages are added to the atlas_manager, so later images may use their free space. Returns 0 on success, -1 if the file can't be read or isn't a valid baked atlas, in which case nothing is registered:
+	int load_baked_atlas(const char *filename, plf::renderer *renderer, plf::atlas_manager *atlas_manager, plf::sprite_manager *sprite_manager);
+
+}
+
+#endif // PLF_BAKED_ATLAS_H
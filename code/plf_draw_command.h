@@ -0,0 +1,50 @@
+#ifndef PLF_DRAW_COMMAND_H
+#define PLF_DRAW_COMMAND_H
+
+#include <SDL2/SDL.h>
+
+
+namespace plf
+{
+
+	struct rgb
+	{
+		Uint8 r;
+		Uint8 g;
+		Uint8 b;
+	};
+
+
+
+	enum DRAW_COMMAND_TYPE
+	{
+		DRAW_TEXTURE,
+		DRAW_RECTANGLE, // Rectangle outline only, colour is taken from colormod/alpha - or the renderer's current draw colour if alpha is 0
+		DRAW_CLEAR, // Clear the current target, colour is taken from colormod/alpha
+		DRAW_SET_TARGET, // Direct subsequent commands to the texture, or to the window if texture is NULL
+		DRAW_GEOMETRY // Textured quads from the renderer's per-frame vertex storage - source.x is the first vertex, source.w the number of vertices, destination their bounds. Requires PLF_SPRITE_BATCHING
+	};
+
+
+
+	// A single recorded draw operation. Holds no pointers into sprite/entity/layer data, only into atlas textures,
+	// so a whole frame's list can be replayed by display_frame after the layers have been drawn:
+	struct draw_command
+	{
+		SDL_Texture *texture;		// Atlas or render-target texture, NULL for non-texture commands
+		SDL_Rect source;			// Region within atlas texture
+		SDL_Rect destination;		// Region on renderer
+		SDL_Point center;			// Rotation center, relative to destination. Only used if has_center == true
+		double angle;
+		Uint64 sort_key;			// Stamped by plf::renderer::submit from the current sort key, which is set by the submitting layer
+		SDL_RendererFlip flip;
+		rgb colormod;
+		Uint8 alpha;
+		Uint8 type;					// DRAW_COMMAND_TYPE
+		bool has_center;
+		bool opaque;				// Every destination pixel is completely covered by opaque source pixels (axis-aligned, no transparency) - eligible to occlude commands beneath it
+	};
+
+}
+
+#endif // PLF_DRAW_COMMAND_H
@@ -0,0 +1,203 @@
+#include <vector>
+#include <algorithm> // std::sort, std::binary_search
+#include <cmath> // floor
+#include <cstring> // memset
+
+#include <SDL2/SDL.h>
+
+#include "plf_draw_order.h"
+#include "plf_entity.h"
+
+
+namespace plf
+{
+
+	void draw_order::add(plf::entity *new_entity)
+	{
+		apply_removals(); // Colony may reuse a removed entity's memory for the new one
+
+		entry new_entry;
+		new_entry.key = 0;
+		new_entry.entity = new_entity;
+		entries.push_back(new_entry);
+	}
+
+
+
+	void draw_order::remove(plf::entity *removed_entity)
+	{
+		removed_entities.push_back(removed_entity);
+	}
+
+
+
+	void draw_order::clear()
+	{
+		entries.clear();
+		removed_entities.clear();
+	}
+
+
+
+	void draw_order::apply_removals()
+	{
+		if (removed_entities.empty())
+		{
+			return;
+		}
+
+		std::sort(removed_entities.begin(), removed_entities.end());
+
+		std::vector<entry>::iterator destination = entries.begin();
+
+		for (std::vector<entry>::iterator entry_iterator = entries.begin(); entry_iterator != entries.end(); ++entry_iterator)
+		{
+			if (!std::binary_search(removed_entities.begin(), removed_entities.end(), entry_iterator->entity))
+			{
+				*destination++ = *entry_iterator;
+			}
+		}
+
+		entries.erase(destination, entries.end());
+		removed_entities.clear();
+	}
+
+
+
+	void draw_order::sort(const bool y_sort)
+	{
+		apply_removals();
+
+		double x, y;
+		Uint64 previous_key = 0;
+		unsigned int number_out_of_order = 0;
+
+		for (std::vector<entry>::iterator entry_iterator = entries.begin(); entry_iterator != entries.end(); ++entry_iterator)
+		{
+			// Flipping the sign bit maps signed values onto unsigned values in the same order:
+			entry_iterator->key = static_cast<Uint64>(static_cast<Uint32>(entry_iterator->entity->get_depth()) ^ 0x80000000u) << 32;
+
+			if (y_sort)
+			{
+				entry_iterator->entity->get_location(x, y);
+				y = std::floor(y);
+
+				if (y < -2147483648.0)
+				{
+					y = -2147483648.0;
+				}
+				else if (y > 2147483647.0)
+				{
+					y = 2147483647.0;
+				}
+
+				entry_iterator->key |= static_cast<Uint32>(static_cast<int>(y)) ^ 0x80000000u;
+			}
+
+			if (entry_iterator->key < previous_key)
+			{
+				++number_out_of_order;
+			}
+
+			previous_key = entry_iterator->key;
+		}
+
+		if (number_out_of_order == 0)
+		{
+			return;
+		}
+
+		// Insertion sort is linear when the previous frame's order is nearly right, but quadratic when it isn't:
+		if (number_out_of_order <= (entries.size() >> 5) + 8)
+		{
+			insertion_sort();
+		}
+		else
+		{
+			radix_sort();
+		}
+	}
+
+
+
+	void draw_order::insertion_sort()
+	{
+		const std::vector<entry>::iterator entries_begin = entries.begin();
+
+		for (std::vector<entry>::iterator current = entries_begin + 1; current != entries.end(); ++current)
+		{
+			if (current->key >= (current - 1)->key)
+			{
+				continue;
+			}
+
+			const entry moving_entry = *current;
+			std::vector<entry>::iterator destination = current;
+
+			do
+			{
+				*destination = *(destination - 1);
+				--destination;
+			} while (destination != entries_begin && moving_entry.key < (destination - 1)->key);
+
+			*destination = moving_entry;
+		}
+	}
+
+
+
+	void draw_order::radix_sort()
+	{
+		// Least-significant-digit first, 8 bits per pass. All eight digit histograms are built in a single read of the keys:
+		const unsigned int number_of_entries = static_cast<unsigned int>(entries.size());
+		unsigned int histograms[8][256];
+		std::memset(histograms, 0, sizeof(histograms));
+
+		for (std::vector<entry>::iterator entry_iterator = entries.begin(); entry_iterator != entries.end(); ++entry_iterator)
+		{
+			const Uint64 key = entry_iterator->key;
+
+			for (unsigned int digit = 0; digit != 8; ++digit)
+			{
+				++histograms[digit][(key >> (digit * 8)) & 0xFF];
+			}
+		}
+
+		sort_buffer.resize(number_of_entries);
+		std::vector<entry> *source = &entries, *destination = &sort_buffer;
+
+		for (unsigned int digit = 0; digit != 8; ++digit)
+		{
+			unsigned int *histogram = histograms[digit];
+
+			// Skip passes where every key has the same digit - typically most of the depth bytes, and the upper y bytes:
+			if (histogram[((*source)[0].key >> (digit * 8)) & 0xFF] == number_of_entries)
+			{
+				continue;
+			}
+
+			// Convert counts into starting offsets:
+			unsigned int offset = 0, count;
+
+			for (unsigned int bucket = 0; bucket != 256; ++bucket)
+			{
+				count = histogram[bucket];
+				histogram[bucket] = offset;
+				offset += count;
+			}
+
+			for (std::vector<entry>::iterator entry_iterator = source->begin(); entry_iterator != source->end(); ++entry_iterator)
+			{
+				(*destination)[histogram[(entry_iterator->key >> (digit * 8)) & 0xFF]++] = *entry_iterator;
+			}
+
+			std::swap(source, destination);
+		}
+
+		if (source != &entries)
+		{
+			entries.swap(sort_buffer);
+		}
+	}
+
+}
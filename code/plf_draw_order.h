@@ -0,0 +1,46 @@
+#ifndef PLF_DRAW_ORDER_H
+#define PLF_DRAW_ORDER_H
+
+#include <vector>
+
+#include <SDL2/SDL.h>
+
+
+namespace plf
+{
+
+	class entity; // Forward declaration - avoids circular dependency with plf_entity.h
+
+
+
+	// Maintains the draw order of a layer's entities across frames. Each frame every entity's sort key is recomputed from its depth (and optionally its y coordinate), in the previous frame's order.
+	// If only a few entities have moved out of order since then, the previous order is fixed up with an insertion sort, otherwise the whole list is radix-sorted. Both are stable, so entities with equal keys keep their relative order.
+	class draw_order
+	{
+	private:
+		struct entry
+		{
+			Uint64 key; // Depth in the upper 32 bits, y coordinate (if y-sorting) in the lower 32 bits, both offset so that negative values sort first
+			plf::entity *entity;
+		};
+
+		std::vector<entry> entries, sort_buffer;
+		std::vector<plf::entity *> removed_entities; // Removal is deferred until the next add or sort, so that mass erasure is a single pass
+
+		void apply_removals();
+		void insertion_sort();
+		void radix_sort();
+	public:
+		void add(plf::entity *new_entity);
+		void remove(plf::entity *removed_entity);
+		void clear();
+		void sort(const bool y_sort); // Recompute keys and bring the list into order
+
+		inline unsigned int size() { return static_cast<unsigned int>(entries.size()); };
+		inline plf::entity * get_entity(const unsigned int index) { return entries[index].entity; };
+		inline Uint64 get_key(const unsigned int index) { return entries[index].key; };
+	};
+
+}
+
+#endif // PLF_DRAW_ORDER_H
@@ -15,6 +15,7 @@
 #include "plf_sprite.h"
 #include "plf_entity.h"
 #include "plf_layer.h"
+#include "plf_timer.h"
 #include "plf_engine.h"
 
 
@@ -31,7 +32,8 @@ namespace plf
 		entities(NULL),
 		sprites(NULL),
 		sound(NULL),
-		music(NULL)
+		music(NULL),
+		pacer(NULL)
 	{
 		std::clog << "plf::engine created. Date/time " << get_timedate_string() << ":" << std::endl;
 	
@@ -124,13 +126,19 @@ namespace plf
 		entities = new plf::entity_manager(sound);
 	
 		// Initialise layers:
-		layers = new plf::layer_manager();
+		layers = new plf::layer_manager(renderer);
+	
+		// Initialise frame pacer, targeting the display refresh rate (or 60fps if unknown):
+		const int refresh_rate = get_current_display_mode().refresh_rate;
+		pacer = new plf::frame_pacer((refresh_rate > 0) ? refresh_rate : 60, renderer->is_vsync_enabled(), refresh_rate);
+		std::clog << "plf::frame_pacer initialised with target frame time " << pacer->get_target_frame_time() << "ms." << std::endl;
 	}
 	
 	
 	
 	engine::~engine()
 	{
+		delete pacer;
 		delete sprites;
 		delete entities;
 		delete layers;
@@ -200,5 +208,12 @@ namespace plf
 	
 		return -1;
 	}
+	
+	
+	
+	int engine::load_baked_atlas(const char *filename)
+	{
+		return plf::load_baked_atlas(filename, renderer, atlas_manager, sprites);
+	}
 
 }
@@ -16,6 +16,8 @@
 #include "plf_entity.h"
 #include "plf_layer.h"
 #include "plf_math.h"
+#include "plf_timer.h"
+#include "plf_baked_atlas.h"
 
 
 
@@ -34,6 +36,7 @@ namespace plf
 		plf::sprite_manager *sprites;
 		plf::sound_manager *sound;
 		plf::music_manager *music;
+		plf::frame_pacer *pacer;
 	
 		engine();
 		~engine();
@@ -44,6 +47,7 @@ namespace plf
 		void get_all_display_modes(std::vector<SDL_DisplayMode> &display_modes);
 	
 		int set_scale_quality(const unsigned int quality_level); // Scaling algorithm for resized sprites: 0 = per-pixel, 1 = linear, 2 = anisotropic - linear is default
+		int load_baked_atlas(const char *filename); // Load sprites and atlas pages from a file made by plf_atlas_baker - returns -1 on failure
 	};
 
 
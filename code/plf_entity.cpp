@@ -27,7 +27,10 @@ namespace plf
 	entity::entity(const std::string &entity_id, plf::sound_manager *_sound_manager):
 		id(entity_id),
 		sound_manager(_sound_manager),
+		prototype(NULL),
 		layer_quadtree(NULL),
+		animation_clock(NULL),
+		clock_group(NULL),
 		current_state(NULL),
 		colormod(NULL),
 		allowed_area(NULL),
@@ -35,7 +38,11 @@ namespace plf
 		game_x(0),
 		game_y(0),
 		size(1),
+		animation_lag(0),
+		movement_lag(0),
+		depth(0),
 		global_state_time_offset(0),
+		movement_ticks(0),
 		flip_horizontal(false),
 		flip_vertical(false),
 		transparency(255)
@@ -54,14 +61,21 @@ namespace plf
 		current_quadtree_blocks(source.current_quadtree_blocks),
 		id(source.id),
 		sound_manager(source.sound_manager),
+		prototype((source.prototype != NULL) ? source.prototype : const_cast<entity *>(&source)),
 		layer_quadtree(source.layer_quadtree),
+		animation_clock(source.animation_clock),
+		clock_group(NULL),
 		current_state(NULL),
 		allowed_area(source.allowed_area),
 		angle(source.angle),
 		game_x(source.game_x),
 		game_y(source.game_y),
 		size(source.size),
+		animation_lag(source.animation_lag),
+		movement_lag(source.movement_lag),
+		depth(source.depth),
 		global_state_time_offset(source.global_state_time_offset),
+		movement_ticks(source.movement_ticks),
 		flip_horizontal(source.flip_horizontal),
 		flip_vertical(source.flip_vertical),
 		transparency(source.transparency)
@@ -71,6 +85,11 @@ namespace plf
 		current_area.w = source.current_area.w;
 		current_area.h = source.current_area.h;
 	
+		if (source.clock_group != NULL) // Source's own sprite time isn't updated while it's grouped - take the group's
+		{
+			states[source.current_state_id].current_sprite_time = source.animation_clock->get_sprite_time(source.clock_group);
+		}
+	
 		set_current_state(source.current_state_id);
 	
 		if (source.colormod == NULL)
@@ -107,8 +126,11 @@ namespace plf
 	{
 		destination.id = id;
 		destination.sound_manager = sound_manager;
+		destination.prototype = prototype;
 		destination.current_quadtree_blocks = current_quadtree_blocks;
 		destination.layer_quadtree = layer_quadtree;
+		destination.leave_animation_group();
+		destination.animation_clock = animation_clock;
 		destination.game_x = game_x;
 		destination.game_y = game_y;
 		destination.angle = angle;
@@ -116,6 +138,10 @@ namespace plf
 		destination.flip_vertical = flip_vertical;
 		destination.global_state_time_offset = global_state_time_offset;
 		destination.size = size;
+		destination.animation_lag = animation_lag;
+		destination.movement_lag = movement_lag;
+		destination.movement_ticks = movement_ticks;
+		destination.depth = depth;
 		destination.allowed_area = allowed_area;
 		destination.current_area.x = current_area.x;
 		destination.current_area.y = current_area.y;
@@ -144,6 +170,8 @@ namespace plf
 	
 	entity::~entity()
 	{
+		leave_animation_group();
+
 		// Destroy any state solid area Rect's:
 		delete allowed_area;
 		delete colormod;
@@ -218,6 +246,8 @@ namespace plf
 		std::map<std::string, state>::iterator state_iterator = states.find(state_id);
 		assert(state_iterator != states.end()); // No such state exists
 		
+		leave_animation_group();
+
 		if (current_state != NULL) // Usually when a copy of an entity is made
 		{
 			// Reset current state before changing to new state:
@@ -225,6 +255,9 @@ namespace plf
 			current_state->current_movement_time = 0; 								// Reset current state's movement time
 			current_state->current_frame_number = 0;								// Reset frame
 			current_state->remainder = current_state->sprite->get_frame_timing(0);	// Reset remainder
+			animation_lag = 0;
+			movement_lag = 0;
+			movement_ticks = 0;
 			
 			if (!(current_state->sound_references.empty()))
 			{
@@ -246,6 +279,7 @@ namespace plf
 		current_state = &(state_iterator->second);
 		current_state_id = state_id;
 		current_state->sprite->get_base_dimensions(current_area.w, current_area.h);
+		join_animation_group();
 	
 		
 		if (layer_quadtree != NULL) // If this instantiation isn't part of a cloning operation
@@ -306,8 +340,31 @@ namespace plf
 	{
 		assert(current_state != NULL);
 	
+		leave_animation_group();
+		animation_lag = 0;
 		current_state->current_sprite_time = time_offset;
 		current_state->sprite->find_frame(current_state->current_sprite_time, current_state->current_frame_number, current_state->remainder);
+		join_animation_group();
+	}
+	
+	
+	double entity::get_sprite_time()
+	{
+		assert(current_state != NULL);
+	
+		if (clock_group != NULL)
+		{
+			return animation_clock->get_sprite_time(clock_group);
+		}
+	
+		return current_state->current_sprite_time + animation_lag;
+	}
+	
+	
+	double entity::get_movement_time()
+	{
+		assert(current_state != NULL);
+		return current_state->current_movement_time + movement_lag;
 	}
 	
 	
@@ -316,6 +373,8 @@ namespace plf
 		assert(current_state != NULL);
 	
 		current_state->current_movement_time = time_offset;
+		movement_lag = 0;
+		movement_ticks = 0;
 	}
 	
 	
@@ -358,6 +417,41 @@ namespace plf
 	}
 	
 	
+	void entity::set_animation_clock(plf::animation_clock *clock)
+	{
+		leave_animation_group();
+		animation_clock = clock;
+		join_animation_group();
+	}
+	
+	
+	void entity::join_animation_group()
+	{
+		if (animation_clock == NULL || current_state == NULL || clock_group != NULL || !(current_state->sprite->is_looping() && current_state->sprite->is_animated()) || current_state->sprite->get_total_time() == 0)
+		{
+			return;
+		}
+	
+		clock_group = animation_clock->join(current_state->sprite, current_state->current_sprite_time);
+		current_state->current_frame_number = clock_group->current_frame;
+	}
+	
+	
+	void entity::leave_animation_group()
+	{
+		if (clock_group == NULL)
+		{
+			return;
+		}
+	
+		// Carry on from the group's sprite time, in case this entity's sprite is updated by itself from now on:
+		current_state->current_sprite_time = animation_clock->get_sprite_time(clock_group);
+		current_state->sprite->find_frame(current_state->current_sprite_time, current_state->current_frame_number, current_state->remainder);
+		animation_clock->leave(clock_group);
+		clock_group = NULL;
+	}
+	
+	
 	void entity::set_horizontal_flip(const bool new_flip)
 	{
 		flip_horizontal = new_flip;
@@ -503,7 +597,7 @@ namespace plf
 	
 	
 	
-	int entity::update(unsigned int delta_time)
+	int entity::update(const double delta_time)
 	{
 		if (current_state == NULL) // No states defined
 		{
@@ -512,47 +606,25 @@ namespace plf
 	
 		if (current_state->movement != NULL)
 		{
-			move(delta_time);
-			
-			if (layer_quadtree != NULL)
-			{
-				plf::colony<quadtree *> used_nodes;
-				quadtree *parent_node;
-				bool detected;
-	
-				for (plf::colony<entity_block *>::iterator block_iterator = current_quadtree_blocks.begin(); block_iterator != current_quadtree_blocks.end(); ++block_iterator)
-				{
-					(*block_iterator)->entity_reference = this; // current solution for account for pointer invalidation by layer's entity vector resizing when entities added/removed - better solution might be to use unique numbers for each entity per layer
-					parent_node = (*block_iterator)->parent_node;
-					detected = false;
-					
-					// If we haven't already deleted blocks for this entity from this particular node:
-					// (bear in mind the parent nodes may've changed since adding the blocks due to quad subdivision and moving of block references)
-					for (plf::colony<quadtree *>::iterator used_nodes_iterator = used_nodes.begin(); used_nodes_iterator != used_nodes.end(); ++used_nodes_iterator)
-					{
-						if (*used_nodes_iterator == parent_node)
-						{
-							detected = true;
-							break;
-						}
-					}
-					
-					if (!detected)
-					{
-						used_nodes.insert(parent_node);
-						parent_node->delete_entity(this);
-						// possible future todo HERE: add quadtree node to parent layer iterator of nodes to be potentially consolidated after updates - but would need update/move and new placement of entity in two separate functions - involves iterating over the entire entity vector twice - probably not worth it
-						// for moment, consolidating every time (temp):
-						parent_node->consolidate_node();
-					}
-				}
-				
-				current_quadtree_blocks.clear();
-				layer_quadtree->add_entity(this);
-			}
+			// Apply any movement deferred by update_offscreen():
+			move(delta_time + movement_lag);
+			movement_lag = 0;
+			movement_ticks = 0;
+			update_quadtree_blocks();
 		}
 		
-		const int return_state = current_state->sprite->update_frame(current_state->current_frame_number, current_state->current_sprite_time, static_cast<int>(delta_time), current_state->remainder);
+		int return_state = 0;
+	
+		if (clock_group != NULL) // Frame has already been computed for the whole group by the layer manager's animation clock
+		{
+			current_state->current_frame_number = clock_group->current_frame;
+		}
+		else
+		{
+			// Catch up on any animation deferred by update_offscreen() - update_frame finds the frame directly, regardless of the size of delta:
+			return_state = current_state->sprite->update_frame(current_state->current_frame_number, current_state->current_sprite_time, delta_time + animation_lag, current_state->remainder);
+			animation_lag = 0;
+		}
 	
 		// TODO: code for optimising when return code has been 21 ie single-frame sprite
 	
@@ -561,19 +633,115 @@ namespace plf
 			return 20; // Return self-destruct code.
 		}
 		
+		update_sounds(delta_time);
+		return 0;
+	}
+	
+	
+	
+	int entity::update_offscreen(const double delta_time, const unsigned int movement_interval)
+	{
+		if (current_state == NULL) // No states defined
+		{
+			return -1;
+		}
+	
+		if (current_state->movement != NULL)
+		{
+			movement_lag += delta_time;
+	
+			if (++movement_ticks >= movement_interval)
+			{
+				move(movement_lag);
+				movement_lag = 0;
+				movement_ticks = 0;
+				update_quadtree_blocks();
+			}
+		}
+	
+		if (current_state->self_destruct_on_sprite_end) // The end of the sprite has a side effect, so can't be deferred
+		{
+			if (current_state->sprite->update_frame(current_state->current_frame_number, current_state->current_sprite_time, delta_time + animation_lag, current_state->remainder) == 20)
+			{
+				return 20;
+			}
+	
+			animation_lag = 0;
+		}
+		else if (clock_group == NULL)
+		{
+			animation_lag += delta_time;
+		}
+	
+		update_sounds(delta_time);
+		return 0;
+	}
+	
+	
+	
+	void entity::update_quadtree_blocks()
+	{
+		if (layer_quadtree == NULL)
+		{
+			return;
+		}
+	
+		remove_from_quadtree();
+		layer_quadtree->add_entity(this);
+	}
+	
+	
+	
+	void entity::remove_from_quadtree()
+	{
+		plf::colony<quadtree *> used_nodes;
+		quadtree *parent_node;
+		bool detected;
+	
+		for (plf::colony<entity_block *>::iterator block_iterator = current_quadtree_blocks.begin(); block_iterator != current_quadtree_blocks.end(); ++block_iterator)
+		{
+			(*block_iterator)->entity_reference = this; // current solution for account for pointer invalidation by layer's entity vector resizing when entities added/removed - better solution might be to use unique numbers for each entity per layer
+			parent_node = (*block_iterator)->parent_node;
+			detected = false;
+			
+			// If we haven't already deleted blocks for this entity from this particular node:
+			// (bear in mind the parent nodes may've changed since adding the blocks due to quad subdivision and moving of block references)
+			for (plf::colony<quadtree *>::iterator used_nodes_iterator = used_nodes.begin(); used_nodes_iterator != used_nodes.end(); ++used_nodes_iterator)
+			{
+				if (*used_nodes_iterator == parent_node)
+				{
+					detected = true;
+					break;
+				}
+			}
+			
+			if (!detected)
+			{
+				used_nodes.insert(parent_node);
+				parent_node->delete_entity(this);
+				// possible future todo HERE: add quadtree node to parent layer iterator of nodes to be potentially consolidated after updates - but would need update/move and new placement of entity in two separate functions - involves iterating over the entire entity vector twice - probably not worth it
+				// for moment, consolidating every time (temp):
+				parent_node->consolidate_node();
+			}
+		}
+		
+		current_quadtree_blocks.clear();
+	}
+	
+	
 	
-		// Update sound references:
+	void entity::update_sounds(const double delta_time)
+	{
+		// Update sound references - those beyond the sound manager's audibility radius park themselves:
 		for (plf::colony<sound_reference>::iterator reference_iterator = current_state->sound_references.begin(); reference_iterator != current_state->sound_references.end(); ++reference_iterator)
 		{
 			reference_iterator->update(delta_time, static_cast<int>(game_x), static_cast<int>(game_y));
 		}
-		
-		return 0;
 	}
 	
 	
 	
-	int entity::move(const unsigned int delta_time)
+	int entity::move(const double delta_time)
 	{
 		assert(current_state->movement != NULL);
 		current_state->current_movement_time += delta_time;
@@ -11,6 +11,7 @@
 #include "plf_colony.h"
 #include "plf_movement.h"
 #include "plf_utility.h"
+#include "plf_animation_clock.h"
 
 
 namespace plf
@@ -30,10 +31,10 @@ namespace plf
 			plf::colony<sound_reference> sound_references;	 		// Any sounds associated with that state
 			plf::sprite *sprite; 									// No sprite if == NULL
 			plf::movement *movement;								// No movement if == NULL
-			unsigned int remainder;									// Remainder of time left within current frame
-			unsigned int current_sprite_time;						// Tracks time-placement within the sprite animation.
+			double remainder;										// Remainder of time left within current frame
+			double current_sprite_time;								// Tracks time-placement within the sprite animation.
 			unsigned int current_frame_number;						// Current sprite frame
-			unsigned int current_movement_time;						// Tracks time-placement within the movement function. Starts at 0, loops at 2 thousand million
+			double current_movement_time;							// Tracks time-placement within the movement function. Starts at 0
 			bool self_destruct_on_sprite_end; 						// Indicates that at the end of this state's sprite, this entity should self-destruct (return 20)
 		};
 	
@@ -42,21 +43,31 @@ namespace plf
 		std::string id, type, current_state_id;
 		SDL_Rect current_area; // Height and width match the base dimensions of the current state's sprite. Used with allowed_area below.
 		plf::sound_manager * sound_manager; // Must be non-const in order for swap() to work
+		entity *prototype; // The entity_manager entity this one was ultimately copied from, NULL if this is a prototype. Used to recreate streamed entities
 		quadtree *layer_quadtree;	// Pointer to the root node of the quadtree of the layer this entity has been spawned on... for use with adding back into quadtree upon move
+		plf::animation_clock *animation_clock; // Clock of the layer this entity has been spawned on, NULL for prototypes
+		animation_group *clock_group; // If not NULL, the current state's frame is read from this group rather than updated per-entity
 		state *current_state;
 		rgb *colormod;
 		SDL_Rect *allowed_area; // If not NULL, outside of this area the entity will be destroyed automatically by the engine.
 		double angle;
 		double game_x, game_y; // Location of entity in game's greater x, y coordinates. Initially strict integers), as the game begins and the entity begins to move, the coordinates become non-integer.
 		double size;
+		double animation_lag, movement_lag; // Time accumulated by update_offscreen() which hasn't yet been applied to the sprite animation/movement
+		int depth; // Draw order within layer - higher depths are drawn over lower depths
 		unsigned int global_state_time_offset;
+		unsigned int movement_ticks; // Number of update_offscreen() calls since movement was last run
 		bool flip_horizontal, flip_vertical;
 		Uint8 transparency;
 	
+		void join_animation_group(); // Only looping, animated sprites are grouped
+		void leave_animation_group();
+		void update_quadtree_blocks(); // Re-add collision blocks to the layer's quadtree after a move
+		void update_sounds(const double delta_time);
 	public:
 		entity(const std::string &entity_id, plf::sound_manager *_sound_manager);
 		entity(const entity &source);
-		entity(): colormod(NULL), allowed_area(NULL) { }; // For classes which inherit from entity - stops destructor on child entity from going mental
+		entity(): prototype(NULL), animation_clock(NULL), clock_group(NULL), colormod(NULL), allowed_area(NULL), animation_lag(0), movement_lag(0), depth(0), movement_ticks(0) { }; // For classes which inherit from entity - stops destructor on child entity from going mental
 		virtual ~entity(); // Virtual only necessary because otherwise compiler complains, due to virtual update() below.
 		void add_state(const std::string &id, sprite *sprite, const bool destruct_on_sprite_end = false);
 		void add_sound_to_state(const std::string &state_id, const std::string &sound_id, const SOUND_REFERENCE_TYPE sound_type, const unsigned int delay_before_playing = 0, const unsigned int tween_delay = 0, const unsigned int tween_delay_random = 0);
@@ -73,8 +84,12 @@ namespace plf
 		void set_horizontal_flip(const bool new_flip);
 		void set_vertical_flip(const bool new_flip);
 		void set_angle(const double angle);
+		inline void set_depth(const int new_depth) { depth = new_depth; };
+		inline int get_depth() { return depth; };
+		inline void get_dimensions(int &width, int &height) { width = static_cast<int>(current_area.w * size); height = static_cast<int>(current_area.h * size); }; // Current state's base dimensions, resized
 		void set_transparency(const Uint8 transparency);
 		void set_quadtree(quadtree *quadtree_top_node);
+		void set_animation_clock(plf::animation_clock *clock);
 		void set_color_modulation(const Uint8 r, const Uint8 g, const Uint8 b);
 		void set_id(const std::string &new_id);
 		void set_type(const std::string &new_id);
@@ -84,11 +99,24 @@ namespace plf
 		std::string get_type();
 		std::string get_current_state_id();
 	
-		virtual int update(const unsigned int delta_time); //Updates movement/location etc. Always returns 20 if the entity needs to be destroyed.
-		virtual int move(const unsigned int delta_time); //Updates movement/location etc. Always returns 20 if the entity needs to be destroyed.
+		virtual int update(const double delta_time); //Updates movement/location etc. Always returns 20 if the entity needs to be destroyed. delta_time is in (fractional) milliseconds.
+		virtual int update_offscreen(const double delta_time, const unsigned int movement_interval); // Reduced update for entities outside the view: animation is deferred until the next update(), which catches up in one step, and movement runs every movement_interval calls with the accumulated delta. Returns 20 if the entity needs to be destroyed.
+		virtual int move(const double delta_time); //Updates movement/location etc. Always returns 20 if the entity needs to be destroyed.
 		int draw(const double display_x, const double display_y, const Uint8 transparency = 255, rgb *colormod = NULL);
 		
 		inline void add_quadtree_block(entity_block *block_to_add) { current_quadtree_blocks.insert(block_to_add); };
+		inline void clear_quadtree_blocks() { current_quadtree_blocks.clear(); }; // For when the quadtree itself has been destroyed
+		void remove_from_quadtree();
+	
+		// For saving an entity's state, eg. when streaming:
+		inline entity * get_prototype() { return prototype; };
+		inline double get_size() { return size; };
+		inline double get_angle() { return angle; };
+		inline bool get_horizontal_flip() { return flip_horizontal; };
+		inline bool get_vertical_flip() { return flip_vertical; };
+		inline Uint8 get_transparency() { return transparency; };
+		double get_sprite_time();
+		double get_movement_time();
 		
 		void swap(entity &destination);
 	
@@ -0,0 +1,237 @@
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <iostream>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+
+#include "plf_image_decoder.h"
+
+
+namespace plf
+{
+
+	image_decoder::image_decoder(const unsigned int thread_count):
+		number_of_threads(thread_count),
+		next_ticket(0),
+		quit_threads(false)
+	{
+		if (number_of_threads == 0)
+		{
+			const int cpu_count = SDL_GetCPUCount();
+			number_of_threads = (cpu_count > 2) ? static_cast<unsigned int>(cpu_count - 1) : 1; // Leave a core for the main thread
+		}
+
+		mutex = SDL_CreateMutex();
+		job_condition = SDL_CreateCond();
+		decoded_condition = SDL_CreateCond();
+	}
+
+
+
+	image_decoder::~image_decoder()
+	{
+		SDL_LockMutex(mutex);
+		quit_threads = true;
+		pending_jobs.clear();
+		SDL_CondBroadcast(job_condition);
+		SDL_UnlockMutex(mutex);
+
+		for (std::vector<SDL_Thread *>::iterator thread_iterator = threads.begin(); thread_iterator != threads.end(); ++thread_iterator)
+		{
+			SDL_WaitThread(*thread_iterator, NULL);
+		}
+
+		for (std::map<unsigned int, SDL_Surface *>::iterator surface_iterator = decoded_surfaces.begin(); surface_iterator != decoded_surfaces.end(); ++surface_iterator)
+		{
+			SDL_FreeSurface(surface_iterator->second); // Safe with NULL
+		}
+
+		SDL_DestroyCond(decoded_condition);
+		SDL_DestroyCond(job_condition);
+		SDL_DestroyMutex(mutex);
+	}
+
+
+
+	void image_decoder::start_threads()
+	{
+		SDL_Thread *new_thread;
+
+		for (unsigned int thread_number = 0; thread_number != number_of_threads; ++thread_number)
+		{
+			new_thread = SDL_CreateThread(decode_thread_function, "plf decode thread", this);
+
+			if (new_thread == NULL)
+			{
+				std::clog << "plf::image_decoder start_threads: could not create decode thread. SDL Error: " << SDL_GetError() << std::endl;
+				break;
+			}
+
+			threads.push_back(new_thread);
+		}
+
+		if (threads.empty())
+		{
+			std::clog << "plf::image_decoder start_threads: decoding on the main thread instead." << std::endl;
+		}
+	}
+
+
+
+	unsigned int image_decoder::decode(const std::string &filename)
+	{
+		const unsigned int ticket = next_ticket++;
+
+		if (threads.empty() && number_of_threads != 0)
+		{
+			start_threads();
+			number_of_threads = static_cast<unsigned int>(threads.size()); // Don't retry if they couldn't be created
+		}
+
+		if (threads.empty())
+		{
+			SDL_Surface *surface = IMG_Load(filename.c_str());
+			decoded_surfaces[ticket] = surface;
+			return ticket;
+		}
+
+		decode_job new_job;
+		new_job.filename = filename;
+		new_job.ticket = ticket;
+
+		SDL_LockMutex(mutex);
+		pending_jobs.push_back(new_job);
+		SDL_CondSignal(job_condition);
+		SDL_UnlockMutex(mutex);
+
+		return ticket;
+	}
+
+
+
+	SDL_Surface * image_decoder::wait(const unsigned int ticket)
+	{
+		SDL_LockMutex(mutex);
+		std::map<unsigned int, SDL_Surface *>::iterator surface_iterator;
+
+		while ((surface_iterator = decoded_surfaces.find(ticket)) == decoded_surfaces.end())
+		{
+			SDL_CondWait(decoded_condition, mutex);
+		}
+
+		SDL_Surface *surface = surface_iterator->second;
+		decoded_surfaces.erase(surface_iterator);
+		SDL_UnlockMutex(mutex);
+
+		return surface;
+	}
+
+
+
+	bool image_decoder::poll(const unsigned int ticket, SDL_Surface *&surface)
+	{
+		SDL_LockMutex(mutex);
+		std::map<unsigned int, SDL_Surface *>::iterator surface_iterator = decoded_surfaces.find(ticket);
+		const bool decoded = (surface_iterator != decoded_surfaces.end());
+
+		if (decoded)
+		{
+			surface = surface_iterator->second;
+			decoded_surfaces.erase(surface_iterator);
+		}
+
+		SDL_UnlockMutex(mutex);
+		return decoded;
+	}
+
+
+
+	void image_decoder::cancel(const unsigned int ticket)
+	{
+		SDL_LockMutex(mutex);
+
+		// Not started yet:
+		for (std::deque<decode_job>::iterator job_iterator = pending_jobs.begin(); job_iterator != pending_jobs.end(); ++job_iterator)
+		{
+			if (job_iterator->ticket == ticket)
+			{
+				pending_jobs.erase(job_iterator);
+				SDL_UnlockMutex(mutex);
+				return;
+			}
+		}
+
+		// Already decoded:
+		std::map<unsigned int, SDL_Surface *>::iterator surface_iterator = decoded_surfaces.find(ticket);
+
+		if (surface_iterator != decoded_surfaces.end())
+		{
+			SDL_FreeSurface(surface_iterator->second);
+			decoded_surfaces.erase(surface_iterator);
+		}
+		else // Being decoded
+		{
+			cancelled_tickets.insert(ticket);
+		}
+
+		SDL_UnlockMutex(mutex);
+	}
+
+
+
+	int image_decoder::decode_thread_function(void *this_decoder)
+	{
+		static_cast<image_decoder *>(this_decoder)->decode_loop();
+		return 0;
+	}
+
+
+
+	void image_decoder::decode_loop()
+	{
+		SDL_LockMutex(mutex);
+
+		while (true)
+		{
+			while (pending_jobs.empty() && !quit_threads)
+			{
+				SDL_CondWait(job_condition, mutex);
+			}
+
+			if (quit_threads)
+			{
+				break;
+			}
+
+			const decode_job current_job = pending_jobs.front();
+			pending_jobs.pop_front();
+			SDL_UnlockMutex(mutex);
+
+			SDL_Surface *surface = IMG_Load(current_job.filename.c_str());
+
+			if (surface == NULL)
+			{
+				std::clog << "plf::image_decoder: unable to decode image file '" << current_job.filename << "'. SDL_image Error: " << IMG_GetError() << std::endl;
+			}
+
+			SDL_LockMutex(mutex);
+
+			if (cancelled_tickets.erase(current_job.ticket) != 0)
+			{
+				SDL_FreeSurface(surface);
+			}
+			else
+			{
+				decoded_surfaces[current_job.ticket] = surface;
+				SDL_CondBroadcast(decoded_condition);
+			}
+		}
+
+		SDL_UnlockMutex(mutex);
+	}
+
+}
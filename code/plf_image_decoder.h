@@ -0,0 +1,51 @@
+#ifndef PLF_IMAGE_DECODER_H
+#define PLF_IMAGE_DECODER_H
+
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+
+#include <SDL2/SDL.h>
+
+
+namespace plf
+{
+
+	// A pool of worker threads which decode image files (anything IMG_Load supports) into surfaces. Each file is decoded independently, so results are identical to calling IMG_Load serially.
+	// Threads are started on the first decode. IMG_Init must have been called on the main thread beforehand:
+	class image_decoder
+	{
+	private:
+		struct decode_job
+		{
+			std::string filename;
+			unsigned int ticket;
+		};
+
+		std::deque<decode_job> pending_jobs;
+		std::map<unsigned int, SDL_Surface *> decoded_surfaces; // By ticket - NULL if the file couldn't be decoded
+		std::set<unsigned int> cancelled_tickets; // Being decoded, but no longer wanted
+		std::vector<SDL_Thread *> threads;
+		SDL_mutex *mutex; // Protects everything but threads and number_of_threads
+		SDL_cond *job_condition, *decoded_condition;
+		unsigned int number_of_threads, next_ticket;
+		bool quit_threads;
+
+		void start_threads();
+		void decode_loop();
+		static int decode_thread_function(void *this_decoder);
+	public:
+		image_decoder(const unsigned int thread_count = 0); // 0 = one less than the number of CPU cores, at least one
+		~image_decoder(); // Frees any surfaces which haven't been collected
+
+		unsigned int decode(const std::string &filename); // Queue a file for decoding, returns a ticket for collecting the surface
+		SDL_Surface * wait(const unsigned int ticket); // Block until the ticket's file is decoded. The caller takes ownership of the surface - NULL if the file couldn't be decoded
+		bool poll(const unsigned int ticket, SDL_Surface *&surface); // As wait(), but returns false immediately if the file isn't decoded yet
+		void cancel(const unsigned int ticket); // The surface is freed once decoded, rather than collected
+	};
+
+}
+
+#endif // PLF_IMAGE_DECODER_H
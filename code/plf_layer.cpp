@@ -1,4 +1,11 @@
 #include <vector>
+#include <string>
+#include <set>
+#include <map>
+#include <sstream>
+#include <algorithm> // std::max
+#include <cmath> // std::floor
+#include <cstdlib> // std::abs
 #include <cassert>
 
 #include <SDL2/SDL.h>
@@ -14,23 +21,55 @@ namespace plf
 {
 
 
-	layer::layer(const std::string &layer_id, const double relative_movement_rate, const int x, const int y, const unsigned int width, const unsigned int height):
+	layer::layer(plf::renderer *_renderer, const std::string &layer_id, const double relative_movement_rate, const int x, const int y, const unsigned int width, const unsigned int height):
+		renderer(_renderer),
 		id(layer_id),
+		tilemap(NULL),
+		animation_clock(NULL),
+		background_cache(NULL),
+		composite_target(NULL),
+		cache_backgrounds(false),
+		background_cache_valid(false),
 		layer_colormod(NULL),
 		move_relative_xy(relative_movement_rate),
 		total_number_of_entities(0),
-		layer_transparency(255)
+		update_mode(LAYER_ACTIVE),
+		update_divisor(1),
+		frames_since_update(0),
+		accumulated_delta(0),
+		lod_visible_margin(64),
+		lod_far_distance(1024),
+		lod_near_movement_interval(2),
+		lod_far_movement_interval(8),
+		lod_enabled(false),
+		lod_view_valid(false),
+		streamer(NULL),
+		stream_chunk_width(1024),
+		stream_chunk_height(1024),
+		view_chunk_column(0),
+		view_chunk_row(0),
+		stream_load_distance(1),
+		stream_evict_distance(2),
+		streaming(false),
+		view_chunk_valid(false),
+		layer_transparency(255),
+		y_sort(false)
 	{
+		assert(renderer != NULL);
 		assert(id != "");
 		boundaries.x = x;
 		boundaries.y = y;
 		boundaries.w = static_cast<int>(width);
 		boundaries.h = static_cast<int>(height);
+		lod_view = boundaries;
 		
 		unsigned int largest_dimension = width; // want square nodes
 		if (width < height) largest_dimension = height;
 		
 		quadtree = new plf::quadtree(NULL, x, x + largest_dimension, y, y + largest_dimension, 50, 50);
+		quadtree_area.x = x;
+		quadtree_area.y = y;
+		quadtree_area.w = quadtree_area.h = static_cast<int>(largest_dimension);
 	}
 	
 	
@@ -38,8 +77,16 @@ namespace plf
 	layer::~layer()
 	{
 		// Sprites are cleaned up separately, so no deallocation necessary. Backgrounds and entities are statically allocated, no dynamic garbage collection required.
+		if (streamer != NULL)
+		{
+			streamer->cancel_loads(this); // Evicted chunks stay on disk
+		}
+	
 		delete layer_colormod;
 		delete quadtree;
+		delete tilemap;
+		renderer->destroy_target_texture(background_cache);
+		renderer->destroy_target_texture(composite_target);
 	}
 	
 	
@@ -59,31 +106,350 @@ namespace plf
 		background_pointer->x = x;
 		background_pointer->y = y;
 		background_pointer->resize = size;
+		background_pointer->sprite_time = 0;
+		background_cache_valid = false;
 	}
 	
 	
 	
-	entity * layer::spawn_entity(const std::string &new_id, entity *entity, const int entity_x, const int entity_y, const unsigned int sprite_time_offset, const unsigned int movement_time_offset, const double size, const unsigned int z_index)
+	entity * layer::spawn_entity(const std::string &new_id, entity *entity, const int entity_x, const int entity_y, const unsigned int sprite_time_offset, const unsigned int movement_time_offset, const double size, const int depth)
 	{
 		assert(entity != NULL);
-		assert(z_index < 30); // Z-index is 0-29
 		assert(size > 0 && size <= 1000); // sanity-check
 	
-		plf::entity *copied_entity = &*(entities[z_index].insert(*entity));
+		plf::entity *copied_entity = &*(entities.insert(*entity));
+		copied_entity->set_depth(depth);
 		copied_entity->set_size(size);
 		copied_entity->set_location(static_cast<double>(entity_x), static_cast<double>(entity_y));
 		copied_entity->set_id(new_id);
 		copied_entity->set_sprite_time_offset(sprite_time_offset);
 		copied_entity->set_movement_time_offset(movement_time_offset);
 		copied_entity->set_quadtree(quadtree);
+		copied_entity->set_animation_clock(get_entity_animation_clock());
 	
 		quadtree->add_entity(copied_entity);
+		entity_draw_order.add(copied_entity);
 		
 		return copied_entity;
 	}
 	
 	
 	
+	void layer::set_update_divisor(const unsigned int divisor)
+	{
+		assert(divisor != 0);
+		update_divisor = divisor;
+	
+		if (frames_since_update >= update_divisor)
+		{
+			frames_since_update = update_divisor - 1; // Update on the next frame
+		}
+	}
+	
+	
+	
+	void layer::set_lod(const bool enabled, const unsigned int visible_margin, const unsigned int far_distance, const unsigned int near_movement_interval, const unsigned int far_movement_interval)
+	{
+		assert(near_movement_interval != 0 && far_movement_interval != 0);
+	
+		lod_enabled = enabled;
+		lod_view_valid = false; // Wait for the next draw
+		lod_visible_margin = visible_margin;
+		lod_far_distance = far_distance;
+		lod_near_movement_interval = near_movement_interval;
+		lod_far_movement_interval = far_movement_interval;
+	}
+	
+	
+	
+	void layer::set_animation_clock(plf::animation_clock *clock)
+	{
+		animation_clock = clock;
+		plf::animation_clock *entity_clock = get_entity_animation_clock();
+	
+		for (plf::colony<entity>::iterator entity_iterator = entities.begin(); entity_iterator != entities.end(); ++entity_iterator)
+		{
+			entity_iterator->set_animation_clock(entity_clock);
+		}
+	}
+	
+	
+	
+	void layer::set_update_mode(const LAYER_UPDATE_MODE mode)
+	{
+		const bool freezing_changed = ((mode == LAYER_FROZEN) != (update_mode == LAYER_FROZEN));
+		update_mode = mode;
+	
+		if (freezing_changed) // Entities leave their clock groups when frozen, keeping their sprite time, and rejoin at that time when resumed
+		{
+			set_animation_clock(animation_clock);
+		}
+	}
+	
+	
+	
+	void layer::enable_streaming(const std::string &directory, const unsigned int chunk_width, const unsigned int chunk_height, const unsigned int load_distance, const unsigned int evict_distance)
+	{
+		assert(chunk_width != 0 && chunk_height != 0);
+		plf_fail_if(load_distance >= evict_distance, "plf::layer enable_streaming error: load_distance (" << load_distance << ") must be less than evict_distance (" << evict_distance << ") on layer '" << id << "'.");
+		plf_fail_if(!evicted_chunks.empty() || !loading_chunks.empty(), "plf::layer enable_streaming error: layer '" << id << "' already has evicted chunks.");
+	
+		stream_directory = directory;
+		stream_chunk_width = static_cast<int>(chunk_width);
+		stream_chunk_height = static_cast<int>(chunk_height);
+		stream_load_distance = load_distance;
+		stream_evict_distance = evict_distance;
+		streaming = true;
+		view_chunk_valid = false; // Evict on the next stream()
+	}
+	
+	
+	
+	void layer::stream(const int display_x, const int display_y)
+	{
+		if (!streaming || streamer == NULL)
+		{
+			return;
+		}
+	
+		// Respawn the entities of any chunks that have finished loading:
+		std::vector<chunk_load> loads;
+		streamer->collect_loads(this, loads);
+	
+		for (std::vector<chunk_load>::iterator load_iterator = loads.begin(); load_iterator != loads.end(); ++load_iterator)
+		{
+			respawn_chunk(*load_iterator);
+			loading_chunks.erase(std::make_pair(load_iterator->column, load_iterator->row));
+		}
+	
+		// Find the chunk containing the center of the view:
+		int screen_width, screen_height;
+		renderer->get_dimensions(screen_width, screen_height);
+		const double center_x = (static_cast<double>(display_x) * move_relative_xy) + static_cast<double>(screen_width / 2);
+		const double center_y = (static_cast<double>(display_y) * move_relative_xy) + static_cast<double>(screen_height / 2);
+		const int column = static_cast<int>(std::floor(center_x / static_cast<double>(stream_chunk_width)));
+		const int row = static_cast<int>(std::floor(center_y / static_cast<double>(stream_chunk_height)));
+	
+		// Respawned chunks may already be out of range again if the view's moving quickly, so re-check those too:
+		if (view_chunk_valid && column == view_chunk_column && row == view_chunk_row && loads.empty())
+		{
+			return;
+		}
+	
+		view_chunk_column = column;
+		view_chunk_row = row;
+		view_chunk_valid = true;
+	
+		evict_chunks();
+		recenter_quadtree();
+	
+		// Queue evicted chunks that are now within range for loading:
+		const int distance = static_cast<int>(stream_load_distance);
+		std::pair<int, int> chunk;
+	
+		for (chunk.second = row - distance; chunk.second <= row + distance; ++chunk.second)
+		{
+			for (chunk.first = column - distance; chunk.first <= column + distance; ++chunk.first)
+			{
+				if (evicted_chunks.erase(chunk) != 0)
+				{
+					loading_chunks.insert(chunk);
+					streamer->read_chunk(this, get_chunk_filename(chunk.first, chunk.second), chunk.first, chunk.second);
+				}
+			}
+		}
+	}
+	
+	
+	
+	void layer::evict_chunks()
+	{
+		std::map< std::pair<int, int>, std::vector<entity_record> > evicted_records;
+		std::pair<int, int> chunk;
+		entity *prototype;
+		double x, y;
+		const int distance = static_cast<int>(stream_evict_distance);
+	
+		for (plf::colony<entity>::iterator entity_iterator = entities.begin(); entity_iterator != entities.end();)
+		{
+			entity_iterator->get_location(x, y);
+			chunk.first = static_cast<int>(std::floor(x / static_cast<double>(stream_chunk_width)));
+			chunk.second = static_cast<int>(std::floor(y / static_cast<double>(stream_chunk_height)));
+			prototype = entity_iterator->get_prototype();
+	
+			// Entities which weren't copied from a prototype can't be respawned, so are never evicted:
+			if ((std::abs(chunk.first - view_chunk_column) <= distance && std::abs(chunk.second - view_chunk_row) <= distance) || prototype == NULL)
+			{
+				++entity_iterator;
+				continue;
+			}
+	
+			stream_prototypes[prototype->get_id()] = prototype;
+	
+			std::vector<entity_record> &records = evicted_records[chunk];
+			records.push_back(entity_record());
+			entity_record &record = records.back();
+			record.prototype_id = prototype->get_id();
+			record.id = entity_iterator->get_id();
+			record.type = entity_iterator->get_type();
+			record.state = entity_iterator->get_current_state_id();
+			record.x = x;
+			record.y = y;
+			record.size = entity_iterator->get_size();
+			record.angle = entity_iterator->get_angle();
+			record.sprite_time = entity_iterator->get_sprite_time();
+			record.movement_time = entity_iterator->get_movement_time();
+			record.depth = entity_iterator->get_depth();
+			record.transparency = entity_iterator->get_transparency();
+			record.flip_horizontal = entity_iterator->get_horizontal_flip();
+			record.flip_vertical = entity_iterator->get_vertical_flip();
+	
+			entity_iterator->remove_from_quadtree();
+			entity_draw_order.remove(&*entity_iterator);
+			entity_iterator = entities.erase(entity_iterator);
+		}
+	
+		for (std::map< std::pair<int, int>, std::vector<entity_record> >::iterator eviction_iterator = evicted_records.begin(); eviction_iterator != evicted_records.end(); ++eviction_iterator)
+		{
+			// If the chunk's already on disk, add to it - otherwise there's either no file, a stale one, or one that a queued load will delete first:
+			const bool append = evicted_chunks.count(eviction_iterator->first) != 0;
+			streamer->write_chunk(this, get_chunk_filename(eviction_iterator->first.first, eviction_iterator->first.second), eviction_iterator->second, append);
+			evicted_chunks.insert(eviction_iterator->first);
+		}
+	}
+	
+	
+	
+	void layer::respawn_chunk(const chunk_load &load)
+	{
+		for (std::vector<entity_record>::const_iterator record = load.records.begin(); record != load.records.end(); ++record)
+		{
+			std::map<std::string, entity *>::iterator prototype_iterator = stream_prototypes.find(record->prototype_id);
+	
+			if (prototype_iterator == stream_prototypes.end())
+			{
+				std::clog << "plf::layer respawn_chunk error: no prototype '" << record->prototype_id << "' for streamed entity '" << record->id << "' on layer '" << id << "'." << std::endl;
+				continue;
+			}
+	
+			entity *respawned_entity = spawn_entity(record->id, prototype_iterator->second, static_cast<int>(record->x), static_cast<int>(record->y), 0, 0, record->size, record->depth);
+			respawned_entity->set_location(record->x, record->y);
+			respawned_entity->set_current_state(record->state); // Also moves the entity's quadtree blocks to the exact location
+			respawned_entity->set_sprite_time_offset(static_cast<unsigned int>(record->sprite_time));
+			respawned_entity->set_movement_time_offset(static_cast<unsigned int>(record->movement_time));
+			respawned_entity->set_type(record->type);
+			respawned_entity->set_angle(record->angle);
+			respawned_entity->set_horizontal_flip(record->flip_horizontal);
+			respawned_entity->set_vertical_flip(record->flip_vertical);
+			respawned_entity->set_transparency(record->transparency);
+		}
+	}
+	
+	
+	
+	void layer::recenter_quadtree()
+	{
+		// The resident area - every chunk within stream_evict_distance of the view's chunk:
+		const int distance = static_cast<int>(stream_evict_distance);
+		const int resident_x = (view_chunk_column - distance) * stream_chunk_width;
+		const int resident_y = (view_chunk_row - distance) * stream_chunk_height;
+		const int resident_width = ((distance * 2) + 1) * stream_chunk_width;
+		const int resident_height = ((distance * 2) + 1) * stream_chunk_height;
+	
+		if (resident_x >= quadtree_area.x && resident_y >= quadtree_area.y && resident_x + resident_width <= quadtree_area.x + quadtree_area.w && resident_y + resident_height <= quadtree_area.y + quadtree_area.h)
+		{
+			return;
+		}
+	
+		// Center a new root node on the resident area, with a chunk's margin on each side so that the view can move a chunk in any direction before it's rebuilt again:
+		const int largest_dimension = std::max(resident_width + (stream_chunk_width * 2), resident_height + (stream_chunk_height * 2)); // want square nodes
+		quadtree_area.x = resident_x + (resident_width / 2) - (largest_dimension / 2);
+		quadtree_area.y = resident_y + (resident_height / 2) - (largest_dimension / 2);
+		quadtree_area.w = quadtree_area.h = largest_dimension;
+	
+		delete quadtree;
+		quadtree = new plf::quadtree(NULL, quadtree_area.x, quadtree_area.x + largest_dimension, quadtree_area.y, quadtree_area.y + largest_dimension, 50, 50);
+	
+		for (plf::colony<entity>::iterator entity_iterator = entities.begin(); entity_iterator != entities.end(); ++entity_iterator)
+		{
+			entity_iterator->clear_quadtree_blocks(); // Already deleted with the old quadtree
+			entity_iterator->set_quadtree(quadtree);
+			quadtree->add_entity(&*entity_iterator);
+		}
+	}
+	
+	
+	
+	std::string layer::get_chunk_filename(const int column, const int row)
+	{
+		std::ostringstream filename;
+		filename << stream_directory << "/" << id << "_" << column << "_" << row << ".chunk";
+		return filename.str();
+	}
+	
+	
+	
+	plf::tilemap * layer::create_tilemap(sprite *tileset, const unsigned int tile_width, const unsigned int tile_height, const unsigned int columns, const unsigned int rows, const int x, const int y)
+	{
+		delete tilemap;
+		tilemap = new plf::tilemap(renderer, tileset, tile_width, tile_height, columns, rows, x, y);
+		return tilemap;
+	}
+	
+	
+	
+	void layer::get_tile_collisions(std::vector<entity *> &colliding_entities)
+	{
+		if (tilemap == NULL)
+		{
+			return;
+		}
+	
+		std::vector<SDL_Rect> collision_blocks;
+	
+		for (plf::colony<entity>::iterator entity_iterator = entities.begin(); entity_iterator != entities.end(); ++entity_iterator)
+		{
+			collision_blocks.clear();
+			entity_iterator->get_current_collision_blocks(collision_blocks);
+	
+			for (std::vector<SDL_Rect>::iterator block_iterator = collision_blocks.begin(); block_iterator != collision_blocks.end(); ++block_iterator)
+			{
+				if (tilemap->collides(*block_iterator))
+				{
+					colliding_entities.push_back(&*entity_iterator);
+					break;
+				}
+			}
+		}
+	}
+	
+	
+	
+	particle_emitter * layer::add_particle_emitter(sprite *sprite, const double x, const double y)
+	{
+		assert(sprite != NULL);
+		return &*(particle_emitters.insert(particle_emitter(renderer, sprite, x, y)));
+	}
+	
+	
+	
+	int layer::remove_particle_emitter(particle_emitter *emitter)
+	{
+		for (plf::colony<particle_emitter>::iterator emitter_iterator = particle_emitters.begin(); emitter_iterator != particle_emitters.end(); ++emitter_iterator)
+		{
+			if (&*emitter_iterator == emitter)
+			{
+				particle_emitters.erase(emitter_iterator);
+				return 0;
+			}
+		}
+	
+		std::clog << "plf::layer remove_particle_emitter error: emitter not found on layer '" << id << "'." << std::endl;
+		return -1;
+	}
+	
+	
+	
 	void layer::set_transparency(const Uint8 new_transparency)
 	{
 		layer_transparency = new_transparency;
@@ -105,86 +471,357 @@ namespace plf
 	
 	
 	
-	void layer::draw(const unsigned int delta_time, const int display_x, const int display_y)
+	bool layer::covers_viewport(const int display_x, const int display_y)
+	{
+		if (layer_transparency != 255 || backgrounds.empty())
+		{
+			return false;
+		}
+	
+		int screen_width, screen_height, width, height, x, y;
+		renderer->get_dimensions(screen_width, screen_height);
+		const int adjusted_x = static_cast<int>(static_cast<double>(display_x) * move_relative_xy);
+		const int adjusted_y = static_cast<int>(static_cast<double>(display_y) * move_relative_xy);
+	
+		for(plf::colony<background>::iterator background_iterator = backgrounds.begin(); background_iterator != backgrounds.end(); ++background_iterator)
+		{
+			x = background_iterator->x - adjusted_x;
+			y = background_iterator->y - adjusted_y;
+	
+			if (x > 0 || y > 0)
+			{
+				continue;
+			}
+	
+			background_iterator->sprite->get_base_dimensions(width, height);
+	
+			if (x + static_cast<int>(static_cast<double>(width) * background_iterator->resize) >= screen_width && y + static_cast<int>(static_cast<double>(height) * background_iterator->resize) >= screen_height && background_iterator->sprite->is_opaque())
+			{
+				return true;
+			}
+		}
+	
+		return false;
+	}
+	
+	
+	
+	void layer::set_caching(const bool cache_layer_backgrounds, const bool composite_layer)
+	{
+		cache_backgrounds = cache_layer_backgrounds && renderer->has_render_targets();
+		background_cache_valid = false;
+	
+		if (!cache_backgrounds)
+		{
+			renderer->destroy_target_texture(background_cache);
+			background_cache = NULL;
+		}
+	
+		if (composite_layer && composite_target == NULL)
+		{
+			int width, height;
+			renderer->get_dimensions(width, height);
+			composite_target = renderer->create_target_texture(width, height); // Remains NULL if unsupported
+		}
+		else if (!composite_layer)
+		{
+			renderer->destroy_target_texture(composite_target);
+			composite_target = NULL;
+		}
+	}
+	
+	
+	
+	bool layer::update_background_cache()
+	{
+		if (background_cache_valid)
+		{
+			return background_cache != NULL;
+		}
+	
+		background_cache_valid = true;
+	
+		if (backgrounds.empty())
+		{
+			renderer->destroy_target_texture(background_cache);
+			background_cache = NULL;
+			return false;
+		}
+	
+		// Find the area covered by all backgrounds:
+		int left = 0, top = 0, right = 0, bottom = 0, width, height;
+	
+		for(plf::colony<background>::iterator background_iterator = backgrounds.begin(); background_iterator != backgrounds.end(); ++background_iterator)
+		{
+			if (background_iterator->sprite->is_animated())
+			{
+				std::clog << "plf::layer update_background_cache: layer '" << id << "' has an animated background, background caching disabled." << std::endl;
+				set_caching(false, composite_target != NULL);
+				return false;
+			}
+	
+			background_iterator->sprite->get_base_dimensions(width, height);
+			width = static_cast<int>(static_cast<double>(width) * background_iterator->resize);
+			height = static_cast<int>(static_cast<double>(height) * background_iterator->resize);
+	
+			if (background_iterator == backgrounds.begin())
+			{
+				left = background_iterator->x;
+				top = background_iterator->y;
+				right = left + width;
+				bottom = top + height;
+			}
+			else
+			{
+				if (background_iterator->x < left) left = background_iterator->x;
+				if (background_iterator->y < top) top = background_iterator->y;
+				if (background_iterator->x + width > right) right = background_iterator->x + width;
+				if (background_iterator->y + height > bottom) bottom = background_iterator->y + height;
+			}
+		}
+	
+		const SDL_RendererInfo info = renderer->get_info();
+	
+		if ((info.max_texture_width != 0 && right - left > info.max_texture_width) || (info.max_texture_height != 0 && bottom - top > info.max_texture_height))
+		{
+			std::clog << "plf::layer update_background_cache: backgrounds of layer '" << id << "' cover " << right - left << "x" << bottom - top << ", larger than the maximum texture size - background caching disabled." << std::endl;
+			set_caching(false, composite_target != NULL);
+			return false;
+		}
+	
+		if (background_cache != NULL && (background_cache_area.w != right - left || background_cache_area.h != bottom - top))
+		{
+			renderer->destroy_target_texture(background_cache);
+			background_cache = NULL;
+		}
+	
+		background_cache_area.x = left;
+		background_cache_area.y = top;
+		background_cache_area.w = right - left;
+		background_cache_area.h = bottom - top;
+	
+		if (background_cache == NULL)
+		{
+			background_cache = renderer->create_target_texture(background_cache_area.w, background_cache_area.h);
+	
+			if (background_cache == NULL)
+			{
+				set_caching(false, composite_target != NULL);
+				return false;
+			}
+		}
+	
+		// Render backgrounds into the cache, without layer transparency/color modulation (these are applied when the cache is drawn):
+		renderer->set_target(background_cache);
+		renderer->clear(0, 0, 0, 0);
+		renderer->begin_draw_list();
+		Uint64 sort_key = 0;
+	
+		for(plf::colony<background>::iterator background_iterator = backgrounds.begin(); background_iterator != backgrounds.end(); ++background_iterator)
+		{
+			renderer->set_sort_key(sort_key++);
+			background_iterator->sprite->draw(background_iterator->sprite_time, 0, background_iterator->x - left, background_iterator->y - top, background_iterator->resize);
+		}
+	
+		renderer->end_draw_list();
+		renderer->set_target(NULL);
+		return true;
+	}
+	
+	
+	
+	void layer::draw_cache(SDL_Texture *cache_texture, const SDL_Rect &cache_area, const int x, const int y, const Uint8 transparency, const rgb *colormod)
+	{
+		// Only draw the part of the cache which is on screen:
+		int screen_width, screen_height;
+		renderer->get_dimensions(screen_width, screen_height);
+	
+		const int left = (x < 0) ? 0 : x, top = (y < 0) ? 0 : y;
+		const int right = (x + cache_area.w > screen_width) ? screen_width : x + cache_area.w;
+		const int bottom = (y + cache_area.h > screen_height) ? screen_height : y + cache_area.h;
+	
+		if (right <= left || bottom <= top)
+		{
+			return;
+		}
+	
+		draw_command command;
+		command.type = DRAW_TEXTURE;
+		command.texture = cache_texture;
+		command.source.x = left - x;
+		command.source.y = top - y;
+		command.source.w = command.destination.w = right - left;
+		command.source.h = command.destination.h = bottom - top;
+		command.destination.x = left;
+		command.destination.y = top;
+		command.angle = 0;
+		command.flip = SDL_FLIP_NONE;
+		command.has_center = false;
+		command.opaque = false; // Not known for cache content
+		command.alpha = transparency;
+	
+		// Cache content has premultiplied alpha, so color must be scaled along with transparency:
+		const unsigned int r = (colormod != NULL) ? colormod->r : 255, g = (colormod != NULL) ? colormod->g : 255, b = (colormod != NULL) ? colormod->b : 255;
+		command.colormod.r = static_cast<Uint8>((r * transparency) / 255);
+		command.colormod.g = static_cast<Uint8>((g * transparency) / 255);
+		command.colormod.b = static_cast<Uint8>((b * transparency) / 255);
+	
+		renderer->submit(command);
+	}
+	
+	
+	
+	void layer::draw(const double delta_time, const int display_x, const int display_y)
 	{
 		// Display background images:
 		double adjusted_x = (static_cast<double>(display_x) * move_relative_xy);
 		double adjusted_y = (static_cast<double>(display_y) * move_relative_xy);
 	
-		if (!(backgrounds.empty()))
+		if (lod_enabled) // Record the view for the next update's level-of-detail bands
+		{
+			renderer->get_dimensions(lod_view.w, lod_view.h);
+			lod_view.x = static_cast<int>(adjusted_x);
+			lod_view.y = static_cast<int>(adjusted_y);
+			lod_view_valid = true;
+		}
+	
+		const bool backgrounds_cached = cache_backgrounds && update_background_cache();
+	
+		// When compositing, everything is drawn unmodulated into the composite target, and layer transparency/color modulation is applied once when it is drawn to the window:
+		const Uint8 draw_transparency = (composite_target != NULL) ? 255 : layer_transparency;
+		rgb *draw_colormod = (composite_target != NULL) ? NULL : layer_colormod;
+	
+		if (composite_target != NULL)
+		{
+			renderer->set_target(composite_target);
+			renderer->clear(0, 0, 0, 0);
+		}
+	
+		// Draws within the layer are sorted by texture where their sort keys allow:
+		renderer->begin_draw_list();
+		Uint64 sort_key = 0;
+	
+		if (backgrounds_cached)
+		{
+			renderer->set_sort_key(sort_key++);
+			draw_cache(background_cache, background_cache_area, background_cache_area.x - static_cast<int>(adjusted_x), background_cache_area.y - static_cast<int>(adjusted_y), draw_transparency, draw_colormod);
+		}
+		else if (!(backgrounds.empty()))
 		{
 			for(plf::colony<background>::iterator background_iterator = backgrounds.begin(); background_iterator != backgrounds.end(); ++background_iterator)
 			{
-				background_iterator->sprite->draw(background_iterator->sprite_time, delta_time, background_iterator->x - static_cast<int>(adjusted_x), background_iterator->y - static_cast<int>(adjusted_y), background_iterator->resize, false, false, 0, layer_transparency, layer_colormod);
+				renderer->set_sort_key(sort_key++); // Backgrounds may overlap, so each keeps its own place beneath the entities
+				background_iterator->sprite->draw(background_iterator->sprite_time, delta_time, background_iterator->x - static_cast<int>(adjusted_x), background_iterator->y - static_cast<int>(adjusted_y), background_iterator->resize, false, false, 0, draw_transparency, draw_colormod);
 			}
 		}
 	
-		for (unsigned int z_index = 0; z_index != 10; ++z_index)
+		if (tilemap != NULL)
+		{
+			renderer->set_sort_key(sort_key++);
+			tilemap->draw(adjusted_x, adjusted_y, draw_transparency, draw_colormod);
+		}
+	
+		// Bring entities into depth (and y) order - usually only a few have changed place since last frame:
+		entity_draw_order.sort(y_sort);
+		const unsigned int number_of_entities = entity_draw_order.size();
+		Uint64 previous_key = 0;
+	
+		for (unsigned int index = 0; index != number_of_entities; ++index)
 		{
-			if (!(entities[z_index].empty()))
+			// Each distinct key gets the next renderer sort key. Entities sharing a key have no defined order, so are free to be grouped by texture:
+			if (index == 0 || entity_draw_order.get_key(index) != previous_key)
 			{
-				for(plf::colony<entity>::iterator entity_iterator = entities[z_index].begin(); entity_iterator != entities[z_index].end(); ++entity_iterator)	
-				{
-					// Display background:
-					entity_iterator->draw(adjusted_x, adjusted_y, layer_transparency, layer_colormod);
-				}
+				previous_key = entity_draw_order.get_key(index);
+				renderer->set_sort_key(sort_key++);
+			}
+	
+			entity_draw_order.get_entity(index)->draw(adjusted_x, adjusted_y, draw_transparency, draw_colormod);
+		}
+	
+		if (!(particle_emitters.empty()))
+		{
+			renderer->set_sort_key(sort_key++);
+	
+			for (plf::colony<particle_emitter>::iterator emitter_iterator = particle_emitters.begin(); emitter_iterator != particle_emitters.end(); ++emitter_iterator)
+			{
+				emitter_iterator->draw(adjusted_x, adjusted_y, draw_transparency, draw_colormod);
 			}
 		}
+	
+		renderer->end_draw_list();
+	
+		if (composite_target != NULL)
+		{
+			renderer->set_target(NULL);
+	
+			int screen_width, screen_height;
+			renderer->get_dimensions(screen_width, screen_height);
+			const SDL_Rect screen_area = {0, 0, screen_width, screen_height};
+			draw_cache(composite_target, screen_area, 0, 0, layer_transparency, layer_colormod);
+		}
 	}
 	
 	
 		
-	int layer::update(const unsigned int delta_time)
+	int layer::update(const double delta_time)
 	{
-		int return_state;
-		unsigned int vector_position;
-		unsigned int vector_size;
-		unsigned int empty_entity_z_indexes = 0;
-		plf::colony<entity>::iterator entity_iterator;
-		
-		
-		for (unsigned int z_index = 0; z_index != 10; ++z_index)
+		for (plf::colony<particle_emitter>::iterator emitter_iterator = particle_emitters.begin(); emitter_iterator != particle_emitters.end();)
 		{
-			vector_position = 0;
-			vector_size = static_cast<unsigned int>(entities[z_index].size());
-			
-			if (vector_size != 0)
+			if (emitter_iterator->update(delta_time) != 20)
 			{
-				entity_iterator = entities[z_index].begin(); 
+				++emitter_iterator;
+			}
+			else // Expired one-off burst
+			{
+				emitter_iterator = particle_emitters.erase(emitter_iterator);
+			}
+		}
+	
+		if (entities.empty())
+		{
+			return (particle_emitters.empty()) ? 20 : 0; // 20 indicates layer can be removed, no entities left
+		}
+	
+		const bool use_lod = lod_enabled && lod_view_valid;
+		const int view_right = lod_view.x + lod_view.w, view_bottom = lod_view.y + lod_view.h;
+		double x, y;
+		int width, height, distance, return_state;
 	
-				do
+		for (plf::colony<entity>::iterator entity_iterator = entities.begin(); entity_iterator != entities.end();) // Iteration occurs in loop, since iterator position may be removed
+		{
+			if (!use_lod)
+			{
+				return_state = entity_iterator->update(delta_time);
+			}
+			else
+			{
+				// Distance between the entity's area and the view - 0 if they overlap, otherwise the larger of the horizontal and vertical gaps:
+				entity_iterator->get_location(x, y);
+				entity_iterator->get_dimensions(width, height);
+				distance = std::max(std::max(lod_view.x - (static_cast<int>(x) + width), static_cast<int>(x) - view_right), std::max(lod_view.y - (static_cast<int>(y) + height), static_cast<int>(y) - view_bottom));
+	
+				if (distance <= static_cast<int>(lod_visible_margin))
 				{
 					return_state = entity_iterator->update(delta_time);
-					
-					if (return_state != 20)
-					{
-						++entity_iterator;
-						++vector_position;
-					}
-					else // ie. Update function indicates that entity has moved outside of world boundaries or similar 'end state'/self-destruct scenario
-					{
-						entity_iterator = entities[z_index].erase(entity_iterator);
-						--vector_size;
-						
-						if (vector_size == 0)
-						{
-							++empty_entity_z_indexes;
-							vector_position = vector_size;
-						}
-						else if (entity_iterator == entities[z_index].end())
-						{
-							vector_position = vector_size;
-						}
-					}
-				} while (vector_position < vector_size);
+				}
+				else
+				{
+					return_state = entity_iterator->update_offscreen(delta_time, (distance <= static_cast<int>(lod_far_distance)) ? lod_near_movement_interval : lod_far_movement_interval);
+				}
 			}
-			else
+	
+			if (return_state != 20)
+			{
+				++entity_iterator;
+			}
+			else // ie. Update function indicates that entity has moved outside of world boundaries or similar 'end state'/self-destruct scenario
 			{
-				++empty_entity_z_indexes;
+				entity_draw_order.remove(&*entity_iterator);
+				entity_iterator = entities.erase(entity_iterator);
 			}
 		}
 		
-		if (empty_entity_z_indexes == 10)
+		if (entities.empty())
 		{
 			return 20; // Indicates layer can be removed, no entities left
 		}
@@ -198,17 +835,11 @@ namespace plf
 	{
 		std::vector<entity *> id_matched_entities;
 		
-		for (unsigned int z_index = 0; z_index != 10; ++z_index)
+		for(plf::colony<entity>::iterator entity_iterator = entities.begin(); entity_iterator != entities.end(); ++entity_iterator)
 		{
-			if(!entities[z_index].empty())
+			if (entity_iterator->get_id() == id)
 			{
-				for(plf::colony<entity>::iterator entity_iterator = entities[z_index].begin(); entity_iterator != entities[z_index].end(); ++entity_iterator)
-				{
-					if (entity_iterator->get_id() == id)
-					{
-						id_matched_entities.push_back(&*entity_iterator);
-					}
-				}
+				id_matched_entities.push_back(&*entity_iterator);
 			}
 		}
 		
@@ -221,18 +852,17 @@ namespace plf
 	{
 		int number_of_erased_entities = 0;
 		
-		for (unsigned int z_index = 0; z_index != 10; ++z_index)
+		for(plf::colony<entity>::iterator entity_iterator = entities.begin(); entity_iterator != entities.end();)
 		{
-			if(!entities[z_index].empty())
+			if (entity_iterator->get_id() == id)
 			{
-				for(plf::colony<entity>::iterator entity_iterator = entities[z_index].begin(); entity_iterator != entities[z_index].end(); ++entity_iterator)
-				{
-					if (entity_iterator->get_id() == id)
-					{
-						entity_iterator = entities[z_index].erase(entity_iterator);
-						++number_of_erased_entities;
-					}
-				}
+				entity_draw_order.remove(&*entity_iterator);
+				entity_iterator = entities.erase(entity_iterator);
+				++number_of_erased_entities;
+			}
+			else
+			{
+				++entity_iterator;
 			}
 		}
 		
@@ -241,15 +871,35 @@ namespace plf
 	
 	
 	
+	void layer::clear_depth(const int depth)
+	{
+		for(plf::colony<entity>::iterator entity_iterator = entities.begin(); entity_iterator != entities.end();)
+		{
+			if (entity_iterator->get_depth() == depth)
+			{
+				entity_draw_order.remove(&*entity_iterator);
+				entity_iterator = entities.erase(entity_iterator);
+			}
+			else
+			{
+				++entity_iterator;
+			}
+		}
+	}
+	
+	
+	
 	
 	void layer::show_quadtree(plf::renderer *renderer, const int display_x, const int display_y, Uint8 r, Uint8 g, Uint8 b)
 	{
-		quadtree->display(renderer->get(), static_cast<int>(display_x * move_relative_xy), static_cast<int>(display_y * move_relative_xy), r, g, b);
+		quadtree->display(renderer, static_cast<int>(display_x * move_relative_xy), static_cast<int>(display_y * move_relative_xy), r, g, b);
 	}
 	
 	
-	layer_manager::layer_manager()
+	layer_manager::layer_manager(plf::renderer *_renderer):
+		renderer(_renderer)
 	{
+		assert(renderer != NULL);
 	}
 	
 	
@@ -270,7 +920,9 @@ namespace plf
 		plf_assert(get_layer(z_index) == NULL, "plf::engine new_layer error: layer with z_index '" << z_index << "' already exists.");
 		plf_assert(get_layer(id) == NULL, "plf::engine new_layer error: layer with id '" << id << "' already exists.");
 		
-		layer *new_layer = new layer(id, relative_movement, x, y, width, height);
+		layer *new_layer = new layer(renderer, id, relative_movement, x, y, width, height);
+		new_layer->set_animation_clock(&animation_clock);
+		new_layer->set_streamer(&streamer);
 		layer_reference new_reference;
 		new_reference.z_index = z_index;
 		new_reference.layer = new_layer;
@@ -295,6 +947,8 @@ namespace plf
 		assert(layer_to_add != NULL);
 		assert(get_layer(z_index) == NULL);
 		plf_assert(get_layer(layer_to_add->get_id()) == NULL, "plf::engine assign_layer error: layer with id '" << layer_to_add->get_id() << "' already exists.");
+		layer_to_add->set_animation_clock(&animation_clock);
+		layer_to_add->set_streamer(&streamer);
 	
 		layer_reference new_reference;
 		new_reference.z_index = z_index;
@@ -385,20 +1039,49 @@ namespace plf
 	
 	
 	
-	void layer_manager::update_layers(const unsigned int delta_time)
+	void layer_manager::stream_layers(const int display_x, const int display_y)
 	{
 		for (std::vector<layer_reference>::iterator layer_iterator = layers.begin(); layer_iterator != layers.end(); ++layer_iterator)
 		{
-			layer_iterator->layer->update(delta_time);
+			layer_iterator->layer->stream(display_x, display_y); // Returns immediately if the layer isn't streamed
 		}
 	}
 	
 	
-	void layer_manager::draw_layers(const unsigned int delta_time, const int display_x, const int display_y)
+	
+	void layer_manager::update_layers(const double delta_time)
 	{
+		animation_clock.tick(delta_time);
+		double due_delta;
+	
 		for (std::vector<layer_reference>::iterator layer_iterator = layers.begin(); layer_iterator != layers.end(); ++layer_iterator)
 		{
-			layer_iterator->layer->draw(delta_time, display_x, display_y);
+			// Frozen, draw-only and not-yet-due layers are skipped without touching their entities:
+			if (layer_iterator->layer->update_due(delta_time, due_delta))
+			{
+				layer_iterator->layer->update(due_delta);
+			}
+		}
+	}
+	
+	
+	void layer_manager::draw_layers(const double delta_time, const int display_x, const int display_y)
+	{
+		std::vector<layer_reference>::iterator lowest_visible_layer = layers.begin();
+	
+		// Skip all layers beneath the topmost layer whose backgrounds completely cover the display:
+		for (std::vector<layer_reference>::reverse_iterator layer_iterator = layers.rbegin(); layer_iterator != layers.rend(); ++layer_iterator)
+		{
+			if (layer_iterator->layer->covers_viewport(display_x, display_y))
+			{
+				lowest_visible_layer = layer_iterator.base() - 1;
+				break;
+			}
+		}
+	
+		for (std::vector<layer_reference>::iterator layer_iterator = lowest_visible_layer; layer_iterator != layers.end(); ++layer_iterator)
+		{
+			layer_iterator->layer->draw((layer_iterator->layer->get_update_mode() == LAYER_FROZEN) ? 0 : delta_time, display_x, display_y);
 		}
 	}
 	
@@ -408,8 +1091,24 @@ namespace plf
 	{
 		for (std::vector<layer_reference>::iterator layer_iterator = layers.begin(); layer_iterator != layers.end(); ++layer_iterator)
 		{
-			layer_iterator->layer->get_collisions(collision_pairs); // Adds to vector
+			if (layer_iterator->layer->get_update_mode() == LAYER_ACTIVE) // Entities on frozen/draw-only layers don't move, and aren't interacted with
+			{
+				layer_iterator->layer->get_collisions(collision_pairs); // Adds to vector
+			}
 		}	
 	}
+	
+	
+	
+	void layer_manager::get_all_tile_collisions(std::vector<entity *> &colliding_entities)
+	{
+		for (std::vector<layer_reference>::iterator layer_iterator = layers.begin(); layer_iterator != layers.end(); ++layer_iterator)
+		{
+			if (layer_iterator->layer->get_update_mode() == LAYER_ACTIVE)
+			{
+				layer_iterator->layer->get_tile_collisions(colliding_entities); // Adds to vector
+			}
+		}
+	}
 
 }
\ No newline at end of file
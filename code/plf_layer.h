@@ -3,18 +3,34 @@
 
 #include <vector>
 #include <string>
+#include <set>
+#include <map>
 
 #include <SDL2/SDL.h>
 
 #include "plf_entity.h"
 #include "plf_quadtree.h"
 #include "plf_colony.h"
+#include "plf_draw_order.h"
+#include "plf_animation_clock.h"
+#include "plf_particles.h"
+#include "plf_tilemap.h"
+#include "plf_streaming.h"
 
 
 
 namespace plf
 {
 
+	enum LAYER_UPDATE_MODE
+	{
+		LAYER_ACTIVE,		// Updated every update_divisor'th frame, and tested for collisions (default)
+		LAYER_FROZEN,		// Paused - not updated or tested for collisions, and background animations stop. Resumes exactly where it left off
+		LAYER_DRAW_ONLY		// Scenery - not updated or tested for collisions, but background animations keep running
+	};
+	
+	
+	
 	class layer
 	{
 	private:
@@ -22,16 +38,27 @@ namespace plf
 		{
 			plf::sprite *sprite;
 			double resize;
-			unsigned int sprite_time;
+			double sprite_time;
 			int x, y;
 		};
 	
 		plf::colony <background> backgrounds;
-		plf::colony <entity> entities[10];
+		plf::colony <entity> entities;
+		plf::colony <particle_emitter> particle_emitters; // Drawn above all entities, not part of the quadtree
+		plf::draw_order entity_draw_order;
+		plf::renderer *renderer;
 		std::string id;
 		plf::quadtree *quadtree;
+		plf::tilemap *tilemap; // Optional, drawn between backgrounds and entities
+		plf::animation_clock *animation_clock; // Shared by all layers of a layer_manager - NULL if this layer isn't assigned to one
 		SDL_Rect boundaries;
 	
+		// Render-target caches:
+		SDL_Texture *background_cache; // All backgrounds, pre-rendered without layer transparency/color modulation
+		SDL_Texture *composite_target; // Screen-sized - the whole layer is drawn into this, then drawn to the window with layer transparency/color modulation in one draw
+		SDL_Rect background_cache_area; // Area, in layer coordinates, covered by background_cache
+		bool cache_backgrounds, background_cache_valid;
+	
 		rgb *layer_colormod;
 		double move_relative_xy; // Variable for parallax layer movement (both horizontal and vertical movement),
 								// 0 = layer does not move
@@ -40,23 +67,108 @@ namespace plf
 								// 1.5 = moves at 150% rate of of normal rate
 								// -1 = moves at the same rate, but backwards
 		unsigned int total_number_of_entities;
+	
+		// Update scheduling - read by layer_manager without touching the entity colony:
+		LAYER_UPDATE_MODE update_mode;
+		unsigned int update_divisor, frames_since_update;
+		double accumulated_delta; // Delta of frames since the last update, applied in full at the next one
+	
+		// Level-of-detail bands, measured from the edges of the view (in layer coordinates) at the last draw:
+		SDL_Rect lod_view;
+		unsigned int lod_visible_margin; // Entities within this distance of the view are updated fully
+		unsigned int lod_far_distance; // Beyond the margin, but within this distance of the view, entities are 'near' - further away they're 'far'
+		unsigned int lod_near_movement_interval, lod_far_movement_interval; // Off-screen entities move every Nth update, with the accumulated delta
+		bool lod_enabled, lod_view_valid;
+	
+		// World streaming, in chunks of stream_chunk_width * stream_chunk_height:
+		plf::chunk_streamer *streamer; // Owned by layer_manager - NULL if this layer isn't assigned to one
+		std::string stream_directory;
+		std::set< std::pair<int, int> > evicted_chunks; // (column, row) of chunks whose entities are on disk
+		std::set< std::pair<int, int> > loading_chunks; // Chunks being read back in by the streamer
+		std::map<std::string, entity *> stream_prototypes; // Prototypes of evicted entities, by id
+		SDL_Rect quadtree_area; // Area covered by the quadtree's root node
+		int stream_chunk_width, stream_chunk_height, view_chunk_column, view_chunk_row;
+		unsigned int stream_load_distance, stream_evict_distance;
+		bool streaming, view_chunk_valid;
+	
 		Uint8 layer_transparency;
+		bool y_sort; // Entities of equal depth are drawn in order of y coordinate, for top-down views
+	
+		bool update_background_cache(); // (Re)render background_cache if invalid, returns false if backgrounds can't be cached
+		void draw_cache(SDL_Texture *cache_texture, const SDL_Rect &cache_area, const int x, const int y, const Uint8 transparency, const rgb *colormod);
+		void evict_chunks(); // Write out and remove entities further than stream_evict_distance chunks from the view's chunk
+		void respawn_chunk(const chunk_load &load);
+		inline plf::animation_clock * get_entity_animation_clock() { return (update_mode == LAYER_FROZEN) ? NULL : animation_clock; }; // Entities on a frozen layer keep their own sprite time instead of following the clock, so that they resume where they left off
+		void recenter_quadtree(); // Rebuild the quadtree around the resident chunks, if they've moved outside it
+		std::string get_chunk_filename(const int column, const int row);
 	public:
-		layer(const std::string &layer_id, const double relative_movement_rate, const int x, const int y, const unsigned int width, const unsigned int height);
+		layer(plf::renderer *_renderer, const std::string &layer_id, const double relative_movement_rate, const int x, const int y, const unsigned int width, const unsigned int height);
 		~layer();
 	
 		void add_background(sprite *sprite, const int x, const int y, double size);
-		entity * spawn_entity(const std::string &new_id, entity *entity, const int entity_x, const int entity_y, const unsigned int sprite_time_displacement = 0, const unsigned int movement_time_displacement = 0, const double size = 1, const unsigned int z_index = 0);
+		entity * spawn_entity(const std::string &new_id, entity *entity, const int entity_x, const int entity_y, const unsigned int sprite_time_displacement = 0, const unsigned int movement_time_displacement = 0, const double size = 1, const int depth = 0);
 		int remove_entities(const std::string &id);
+		particle_emitter * add_particle_emitter(sprite *sprite, const double x, const double y);
+		int remove_particle_emitter(particle_emitter *emitter);
+		inline void clear_particle_emitters() { particle_emitters.clear(); };
+		plf::tilemap * create_tilemap(sprite *tileset, const unsigned int tile_width, const unsigned int tile_height, const unsigned int columns, const unsigned int rows, const int x = 0, const int y = 0); // Replaces any existing tilemap on this layer
+		inline plf::tilemap * get_tilemap() { return tilemap; };
 		std::vector <entity *> get_entities(const std::string &id);
-		void draw(const unsigned int delta_time, const int display_x, const int display_y); // Display_xy are the upper-left coordinates of the games current view.
-		int update(const unsigned int delta_time);
-		inline void clear_z_layer(int z_index) {entities[z_index].clear();};
-		inline void clear_backgrounds() {backgrounds.clear();};
+		void draw(const double delta_time, const int display_x, const int display_y); // Display_xy are the upper-left coordinates of the games current view. delta_time is in (fractional) milliseconds.
+		int update(const double delta_time);
+	
+		// Called once per frame by layer_manager. Accumulates delta_time, and returns true with the accumulated delta on every update_divisor'th frame, if the layer is active:
+		inline bool update_due(const double delta_time, double &due_delta)
+		{
+			if (update_mode != LAYER_ACTIVE)
+			{
+				return false;
+			}
+	
+			accumulated_delta += delta_time;
+	
+			if (++frames_since_update < update_divisor)
+			{
+				return false;
+			}
+	
+			due_delta = accumulated_delta;
+			accumulated_delta = 0;
+			frames_since_update = 0;
+			return true;
+		};
+	
+		void set_update_divisor(const unsigned int divisor); // Update every Nth frame, eg. for slow parallax layers
+		void set_update_mode(const LAYER_UPDATE_MODE mode);
+		inline LAYER_UPDATE_MODE get_update_mode() { return update_mode; };
+		void clear_depth(const int depth); // Remove all entities at this depth
+		inline void clear_entities() { entity_draw_order.clear(); entities.clear(); };
+		inline void clear_backgrounds() { backgrounds.clear(); background_cache_valid = false; };
 		void set_transparency(const Uint8 new_transparency); // Of all backgrounds and entities on layer
 		void set_color_modulation(const Uint8 r, const Uint8 g, const Uint8 b); // ditto
+		bool covers_viewport(const int display_x, const int display_y); // True if a single opaque background covers the whole display, ie. nothing beneath this layer is visible
+		inline void set_y_sort(const bool sort_by_y) { y_sort = sort_by_y; };
+	
+		// Optional level-of-detail updates. Entities further than visible_margin from the view skip animation (catching up in one step when they're next updated fully) and move every near/far_movement_interval updates, depending on whether they're within far_distance of the view.
+		// The view is taken from the previous draw(), so until the layer has been drawn once all entities are updated fully:
+		void set_lod(const bool enabled, const unsigned int visible_margin = 64, const unsigned int far_distance = 1024, const unsigned int near_movement_interval = 2, const unsigned int far_movement_interval = 8);
+		void set_animation_clock(plf::animation_clock *clock); // Entities spawned on this layer with looping sprites are grouped by this clock - set by layer_manager
+	
+		// Optional world streaming. The layer is divided into chunks - entities in chunks more than evict_distance chunks from the view's chunk are written to a file per chunk in directory and removed, and evicted chunks within load_distance are read back in on the layer_manager's streaming thread and respawned.
+		// Memory use then depends on the area around the view rather than the size of the world, and the quadtree is rebuilt around the view whenever it moves outside it. Chunks are only checked when the view enters a new chunk, or a chunk finishes loading.
+		// Evicted entities are respawned from their entity_manager prototypes, which must not be removed while streaming. load_distance should be less than evict_distance, so that chunks at the boundary aren't repeatedly evicted and reloaded:
+		void enable_streaming(const std::string &directory, const unsigned int chunk_width = 1024, const unsigned int chunk_height = 1024, const unsigned int load_distance = 1, const unsigned int evict_distance = 2);
+		void stream(const int display_x, const int display_y); // Called by layer_manager::stream_layers
+		inline void set_streamer(plf::chunk_streamer *new_streamer) { streamer = new_streamer; }; // Set by layer_manager
+		inline unsigned int get_number_of_evicted_chunks() { return static_cast<unsigned int>(evicted_chunks.size() + loading_chunks.size()); };
+	
+		// Optional render-target caching. Cached backgrounds are rendered once (and again only if backgrounds are added or removed), then drawn as a single texture offset by the parallax position - animated backgrounds can't be cached.
+		// Compositing draws the whole layer into a screen-sized target each frame, then applies layer transparency and color modulation once, rather than per sprite. Both are ignored if the renderer doesn't support render targets:
+		void set_caching(const bool cache_layer_backgrounds, const bool composite_layer);
+		inline void invalidate_background_cache() { background_cache_valid = false; }; // Call if a background sprite's frame is changed
 		inline std::string get_id() { return id; };
 		inline void get_collisions(std::vector< std::pair<entity *, entity *> > &collision_pairs) { quadtree->get_collisions(collision_pairs); };
+		void get_tile_collisions(std::vector<entity *> &colliding_entities); // Entities whose collision blocks overlap solid tiles of the layer's tilemap
 	
 		// This is primarily for developer bugshooting:
 	   void show_quadtree(plf::renderer *plf_renderer, const int display_x, const int display_y, Uint8 r = 0, Uint8 g = 0, Uint8 b = 0);
@@ -76,9 +188,12 @@ namespace plf
 	
 		// All layers used in game:
 		std::vector<layer_reference> layers;
+		plf::renderer *renderer;
+		plf::animation_clock animation_clock; // Ticked once per update_layers, before any layer is updated
+		plf::chunk_streamer streamer; // Shared by all streaming layers - destroyed after the layers, so that their final evictions are written
 	
 	public:
-		layer_manager();
+		layer_manager(plf::renderer *_renderer);
 		~layer_manager();
 		layer * new_layer(const std::string &id, const int z_index, const double relative_movement, const int x, const int y, const unsigned int width, const unsigned int height);
 		layer * get_layer(const std::string &id);
@@ -86,9 +201,12 @@ namespace plf
 		int assign_layer(layer *layer_to_add, const int z_index);
 		int remove_layer(const std::string &id);
 		int remove_layer(const int z_index);
-		void update_layers(const unsigned int delta_time);
-		void draw_layers(const unsigned int delta_time, const int display_x, const int display_y);
+		void stream_layers(const int display_x, const int display_y); // Call once per frame before update_layers, with the same display coordinates as draw_layers, if any layers are streamed
+		void update_layers(const double delta_time);
+		void draw_layers(const double delta_time, const int display_x, const int display_y);
 		void get_all_collisions(std::vector< std::pair<entity *, entity *> > &collision_pairs);
+		void get_all_tile_collisions(std::vector<entity *> &colliding_entities);
+		inline plf::animation_clock * get_animation_clock() { return &animation_clock; };
 	};
 	
 
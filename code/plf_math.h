@@ -3,6 +3,8 @@
 
 // Additional math functions in use by various libraries:
 
+#include <cmath>
+
 
 namespace plf
 {
@@ -34,6 +36,12 @@ namespace plf
 	}
 	
 	
+	inline double fast_mod(const double input, const double ceiling) // floating-point equivalent of above, for fractional-millisecond timings
+	{
+	    return (input >= ceiling) ? std::fmod(input, ceiling) : input;
+	}
+	
+	
 	inline unsigned int rand_within(const unsigned int range)
 	{
 		return fast_mod(xor_rand(), range);
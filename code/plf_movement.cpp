@@ -28,7 +28,7 @@ namespace plf
 	
 	
 	
-	void movement::default_update(double &current_x, double &current_y, const unsigned int delta_time, const unsigned int movement_time, const double resize_movement)
+	void movement::default_update(double &current_x, double &current_y, const double delta_time, const double movement_time, const double resize_movement)
 	{
 		// Apply friction:
 	
@@ -77,16 +77,16 @@ namespace plf
 		}
 	
 	
-		int milliseconds_left;
-		int milliseconds_to_apply;
+		double milliseconds_left;
+		double milliseconds_to_apply;
 	
 		// Apply current acceleration impulses:
 		if (!(acceleration_impulses.empty()))
 		{
 			for (std::vector<impulse>::iterator impulse_iterator = acceleration_impulses.begin(); impulse_iterator != acceleration_impulses.end();)  // Iteration occurs in loop, since iterator position may be removed (which counts as an iteration)
 			{
-				milliseconds_left = static_cast<int>((*impulse_iterator).milliseconds) - static_cast<int>(delta_time);
-				milliseconds_to_apply = static_cast<int>(delta_time);
+				milliseconds_left = (*impulse_iterator).milliseconds - delta_time;
+				milliseconds_to_apply = delta_time;
 	
 				if (milliseconds_left <= 0) // Impulse is finished after update
 				{
@@ -109,8 +109,8 @@ namespace plf
 	
 	
 		// Apply accelerations:
-		current_velocity.x += (current_acceleration.x + constant_acceleration.x) * static_cast<double>(delta_time);
-		current_velocity.y += (current_acceleration.y + constant_acceleration.y) * static_cast<double>(delta_time);
+		current_velocity.x += (current_acceleration.x + constant_acceleration.x) * delta_time;
+		current_velocity.y += (current_acceleration.y + constant_acceleration.y) * delta_time;
 	
 		current_x += current_velocity.x;
 		current_y += current_velocity.y;
@@ -129,8 +129,8 @@ namespace plf
 					milliseconds_to_apply += milliseconds_left;
 				}
 				
-				current_x += (*impulse_iterator).x * static_cast<double>(milliseconds_to_apply);
-				current_y += (*impulse_iterator).y * static_cast<double>(milliseconds_to_apply);
+				current_x += (*impulse_iterator).x * milliseconds_to_apply;
+				current_y += (*impulse_iterator).y * milliseconds_to_apply;
 	
 				if (milliseconds_left > 0)
 				{
@@ -148,7 +148,7 @@ namespace plf
 	
 	
 	// To be (potentially) overwritten by derived functions:
-	void movement::update(double &current_x, double &current_y, const unsigned int delta_time, const unsigned int movement_time, const double resize_movement, const bool flip_horizontal, const bool flip_vertical)
+	void movement::update(double &current_x, double &current_y, const double delta_time, const double movement_time, const double resize_movement, const bool flip_horizontal, const bool flip_vertical)
 	{
 		if (delta_time == 0)
 		{
@@ -16,7 +16,7 @@ namespace plf
 		struct impulse // apply this x_y movement per millisecond, for each millisecond specified in the 'milliseconds' field
 		{
 			double x, y;
-			unsigned int milliseconds;
+			double milliseconds;
 	
 			inline void clear()
 			{
@@ -42,9 +42,10 @@ namespace plf
 	   void load_values(const double_xy &acceleration, const double_xy &velocity, const double_xy &environment_friction, const double_xy &environment_constant_acceleration);
 	
 	   // This processes current velocity, acceleration etc, as well as any impulses that've been added to the object:
-		void default_update(double &current_x, double &current_y, const unsigned int delta_time, const unsigned int movement_time, const double resize_movement = 1);
+		// delta_time and movement_time are in (fractional) milliseconds:
+		void default_update(double &current_x, double &current_y, const double delta_time, const double movement_time, const double resize_movement = 1);
 	
-		virtual void update(double &current_x, double &current_y, const unsigned int delta_time, const unsigned int movement_time, const double resize_movement = 1, const bool flip_horizontal = false, const bool flip_vertical = false);
+		virtual void update(double &current_x, double &current_y, const double delta_time, const double movement_time, const double resize_movement = 1, const bool flip_horizontal = false, const bool flip_vertical = false);
 	
 		void add_velocity(const double movement_per_millisecond_x, const double movement_per_millisecond_y);
 		void add_acceleration(const double movement_change_per_millisecond_x, const double movement_change_per_millisecond_y);
@@ -76,7 +77,7 @@ namespace plf
 		default_movement() {};
 		default_movement * clone() { return new default_movement(); };
 	
-		void update(double &current_x, double &current_y, const unsigned int delta_time, const unsigned int movement_time, const double resize_movement = 1, const bool horizontal_flip = false, const bool vertical_flip = false)
+		void update(double &current_x, double &current_y, const double delta_time, const double movement_time, const double resize_movement = 1, const bool horizontal_flip = false, const bool vertical_flip = false)
 		{
 			default_update(current_x, current_y, delta_time, movement_time, resize_movement);
 		}
@@ -0,0 +1,463 @@
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm> // std::find, std::min, std::max
+#include <cmath> // sin, cos, floor
+
+#include <SDL2/SDL.h>
+
+#include "plf_particles.h"
+#include "plf_renderer.h"
+#include "plf_sprite.h"
+#include "plf_math.h"
+#include "plf_utility.h"
+
+
+namespace plf
+{
+
+	static inline float random_between(const float minimum, const float maximum)
+	{
+		return minimum + ((maximum - minimum) * (static_cast<float>(xor_rand() & 0xFFFF) / 65535.0f));
+	}
+
+
+
+	static inline Uint8 interpolate(const Uint8 start, const Uint8 end, const float position)
+	{
+		return static_cast<Uint8>(static_cast<float>(start) + ((static_cast<float>(end) - static_cast<float>(start)) * position));
+	}
+
+
+
+	particle_emitter::particle_emitter(plf::renderer *_renderer, plf::sprite *_sprite, const double x, const double y):
+		renderer(_renderer),
+		sprite(_sprite),
+		emitter_x(x),
+		emitter_y(y),
+		emission_rate(0),
+		emission_accumulator(0),
+		minimum_speed(0.05f),
+		maximum_speed(0.1f),
+		minimum_angle(0),
+		maximum_angle(6.2831853f),
+		minimum_lifetime(1000),
+		maximum_lifetime(1000),
+		gravity_x(0),
+		gravity_y(0),
+		size(1),
+		maximum_particles(100000),
+		single_texture(true),
+		expire_when_empty(false)
+	{
+		plf_assert(renderer != NULL, "plf::particle_emitter constructor error: renderer is NULL.");
+		plf_assert(sprite != NULL, "plf::particle_emitter constructor error: sprite is NULL.");
+		plf_fail_if(!sprite->has_frames(), "plf::particle_emitter constructor error: sprite has no frames.");
+
+		start_color.r = start_color.g = start_color.b = start_color.a = 255;
+		end_color = start_color;
+
+		sprite->set_evictable(false); // Frame atlas locations are kept below
+		build_frame_regions();
+	}
+
+
+
+	void particle_emitter::build_frame_regions()
+	{
+		// Texture coordinates are normalised, so need the size of each atlas texture:
+		const unsigned int number_of_frames = sprite->get_number_of_frames();
+		frame_regions.resize(number_of_frames);
+		textures.clear();
+		single_texture = true;
+		SDL_Rect region, frame_area;
+		int texture_width, texture_height;
+
+		renderer->lock();
+
+		for (unsigned int frame_number = 0; frame_number != number_of_frames; ++frame_number)
+		{
+			frame_region &current_region = frame_regions[frame_number];
+
+			if (!sprite->get_frame_region(frame_number, current_region.texture, region, &frame_area) || SDL_QueryTexture(current_region.texture, NULL, NULL, &texture_width, &texture_height) != 0)
+			{
+				std::clog << "plf::particle_emitter build_frame_regions: frame " << frame_number << " of sprite is too large to be drawn as a particle, and will be skipped." << std::endl;
+				current_region.texture = NULL;
+				single_texture = false;
+				continue;
+			}
+
+			current_region.u1 = static_cast<float>(region.x) / static_cast<float>(texture_width);
+			current_region.v1 = static_cast<float>(region.y) / static_cast<float>(texture_height);
+			current_region.u2 = static_cast<float>(region.x + region.w) / static_cast<float>(texture_width);
+			current_region.v2 = static_cast<float>(region.y + region.h) / static_cast<float>(texture_height);
+			current_region.half_width = static_cast<float>(region.w) * 0.5f;
+			current_region.half_height = static_cast<float>(region.h) * 0.5f;
+			current_region.center_x = (static_cast<float>(-frame_area.x) + current_region.half_width) - (static_cast<float>(frame_area.w) * 0.5f);
+			current_region.center_y = (static_cast<float>(-frame_area.y) + current_region.half_height) - (static_cast<float>(frame_area.h) * 0.5f);
+
+			if (std::find(textures.begin(), textures.end(), current_region.texture) == textures.end())
+			{
+				textures.push_back(current_region.texture);
+			}
+		}
+
+		renderer->unlock();
+
+		if (textures.size() != 1)
+		{
+			single_texture = false;
+		}
+
+		regions_compaction = sprite->get_atlas_manager()->get_number_of_compactions();
+	}
+
+
+
+	void particle_emitter::set_rate(const double particles_per_second)
+	{
+		emission_rate = (particles_per_second > 0) ? particles_per_second / 1000.0 : 0;
+	}
+
+
+
+	void particle_emitter::burst(const unsigned int number_of_particles)
+	{
+		emit(number_of_particles);
+	}
+
+
+
+	void particle_emitter::set_velocity(const float minimum_pixels_per_second, const float maximum_pixels_per_second, const float minimum_degrees, const float maximum_degrees)
+	{
+		minimum_speed = minimum_pixels_per_second / 1000.0f;
+		maximum_speed = maximum_pixels_per_second / 1000.0f;
+		minimum_angle = minimum_degrees * 0.017453292f;
+		maximum_angle = maximum_degrees * 0.017453292f;
+	}
+
+
+
+	void particle_emitter::set_lifetime(const unsigned int minimum_milliseconds, const unsigned int maximum_milliseconds)
+	{
+		plf_assert(minimum_milliseconds != 0 && minimum_milliseconds <= maximum_milliseconds, "plf::particle_emitter set_lifetime error: lifetime range " << minimum_milliseconds << " - " << maximum_milliseconds << " is invalid.");
+		minimum_lifetime = static_cast<float>(minimum_milliseconds);
+		maximum_lifetime = static_cast<float>(maximum_milliseconds);
+	}
+
+
+
+	void particle_emitter::set_gravity(const float x_pixels_per_second_squared, const float y_pixels_per_second_squared)
+	{
+		gravity_x = x_pixels_per_second_squared / 1000000.0f;
+		gravity_y = y_pixels_per_second_squared / 1000000.0f;
+	}
+
+
+
+	void particle_emitter::set_colors(const Uint8 start_r, const Uint8 start_g, const Uint8 start_b, const Uint8 start_alpha, const Uint8 end_r, const Uint8 end_g, const Uint8 end_b, const Uint8 end_alpha)
+	{
+		start_color.r = start_r;
+		start_color.g = start_g;
+		start_color.b = start_b;
+		start_color.a = start_alpha;
+		end_color.r = end_r;
+		end_color.g = end_g;
+		end_color.b = end_b;
+		end_color.a = end_alpha;
+	}
+
+
+
+	void particle_emitter::emit(unsigned int number_of_particles)
+	{
+		const unsigned int current_size = static_cast<unsigned int>(x.size());
+
+		if (current_size + number_of_particles > maximum_particles)
+		{
+			number_of_particles = (current_size < maximum_particles) ? maximum_particles - current_size : 0;
+		}
+
+		float speed, angle;
+
+		for (unsigned int counter = 0; counter != number_of_particles; ++counter)
+		{
+			speed = random_between(minimum_speed, maximum_speed);
+			angle = random_between(minimum_angle, maximum_angle);
+
+			x.push_back(static_cast<float>(emitter_x));
+			y.push_back(static_cast<float>(emitter_y));
+			velocity_x.push_back(std::cos(angle) * speed);
+			velocity_y.push_back(std::sin(angle) * speed);
+			age.push_back(0);
+			lifetime.push_back(random_between(minimum_lifetime, maximum_lifetime));
+			frame.push_back(0);
+			color.push_back(start_color);
+		}
+	}
+
+
+
+	void particle_emitter::remove_particle(const unsigned int index)
+	{
+		x[index] = x.back();
+		x.pop_back();
+		y[index] = y.back();
+		y.pop_back();
+		velocity_x[index] = velocity_x.back();
+		velocity_x.pop_back();
+		velocity_y[index] = velocity_y.back();
+		velocity_y.pop_back();
+		age[index] = age.back();
+		age.pop_back();
+		lifetime[index] = lifetime.back();
+		lifetime.pop_back();
+		frame[index] = frame.back();
+		frame.pop_back();
+		color[index] = color.back();
+		color.pop_back();
+	}
+
+
+
+	int particle_emitter::update(const double delta_time)
+	{
+		const float delta = static_cast<float>(delta_time);
+		unsigned int number_of_particles = static_cast<unsigned int>(x.size());
+
+		if (number_of_particles != 0)
+		{
+			// Integrate - separate flat loops over each array, with no branches, so that they vectorise:
+			float * const x_data = &(x[0]), * const y_data = &(y[0]), * const velocity_x_data = &(velocity_x[0]), * const velocity_y_data = &(velocity_y[0]), * const age_data = &(age[0]);
+			const float delta_gravity_x = gravity_x * delta, delta_gravity_y = gravity_y * delta;
+
+			for (unsigned int index = 0; index != number_of_particles; ++index)
+			{
+				velocity_x_data[index] += delta_gravity_x;
+				x_data[index] += velocity_x_data[index] * delta;
+			}
+
+			for (unsigned int index = 0; index != number_of_particles; ++index)
+			{
+				velocity_y_data[index] += delta_gravity_y;
+				y_data[index] += velocity_y_data[index] * delta;
+			}
+
+			for (unsigned int index = 0; index != number_of_particles; ++index)
+			{
+				age_data[index] += delta;
+			}
+
+			// Retire dead particles:
+			for (unsigned int index = 0; index < static_cast<unsigned int>(x.size());)
+			{
+				if (age[index] >= lifetime[index])
+				{
+					remove_particle(index);
+				}
+				else
+				{
+					++index;
+				}
+			}
+		}
+
+		if (emission_rate != 0)
+		{
+			emission_accumulator += emission_rate * delta_time;
+			const double number_to_emit = std::floor(emission_accumulator);
+			emission_accumulator -= number_to_emit;
+			emit(static_cast<unsigned int>(number_to_emit));
+		}
+
+		number_of_particles = static_cast<unsigned int>(x.size());
+
+		if (number_of_particles == 0)
+		{
+			return (expire_when_empty && emission_rate == 0) ? 20 : 0;
+		}
+
+		// Frames and colors, by age:
+		if (sprite->is_animated())
+		{
+			double remainder;
+
+			for (unsigned int index = 0; index != number_of_particles; ++index)
+			{
+				sprite->find_frame(age[index], frame[index], remainder);
+			}
+		}
+
+		if (start_color.r != end_color.r || start_color.g != end_color.g || start_color.b != end_color.b || start_color.a != end_color.a)
+		{
+			float position;
+
+			for (unsigned int index = 0; index != number_of_particles; ++index)
+			{
+				position = age[index] / lifetime[index];
+				color[index].r = interpolate(start_color.r, end_color.r, position);
+				color[index].g = interpolate(start_color.g, end_color.g, position);
+				color[index].b = interpolate(start_color.b, end_color.b, position);
+				color[index].a = interpolate(start_color.a, end_color.a, position);
+			}
+		}
+
+		return 0;
+	}
+
+
+
+	void particle_emitter::draw(const double display_x, const double display_y, const Uint8 transparency, const rgb *colormod)
+	{
+		const unsigned int number_of_particles = static_cast<unsigned int>(x.size());
+
+		if (number_of_particles == 0 || transparency == 0)
+		{
+			return;
+		}
+
+		if (regions_compaction != sprite->get_atlas_manager()->get_number_of_compactions()) // Frames have moved
+		{
+			build_frame_regions();
+		}
+
+		const float offset_x = static_cast<float>(display_x), offset_y = static_cast<float>(display_y);
+
+		draw_command command;
+		command.angle = 0;
+		command.flip = SDL_FLIP_NONE;
+		command.colormod.r = command.colormod.g = command.colormod.b = 255;
+		command.alpha = 255;
+		command.has_center = false;
+		command.opaque = false;
+		SDL_Color particle_color;
+
+	#ifdef PLF_SPRITE_BATCHING
+		const bool modulate = (transparency != 255 || colormod != NULL);
+
+		// One geometry command per atlas texture:
+		for (std::vector<SDL_Texture *>::iterator texture_iterator = textures.begin(); texture_iterator != textures.end(); ++texture_iterator)
+		{
+			SDL_Texture * const current_texture = *texture_iterator;
+			unsigned int number_of_quads = number_of_particles;
+
+			if (!single_texture)
+			{
+				number_of_quads = 0;
+
+				for (unsigned int index = 0; index != number_of_particles; ++index)
+				{
+					number_of_quads += (frame_regions[frame[index]].texture == current_texture);
+				}
+
+				if (number_of_quads == 0)
+				{
+					continue;
+				}
+			}
+
+			int first_vertex;
+			SDL_Vertex *vertex = renderer->add_quads(number_of_quads, first_vertex);
+			float left, top, right, bottom, minimum_x = 2147483647.0f, minimum_y = 2147483647.0f, maximum_x = -2147483647.0f, maximum_y = -2147483647.0f;
+
+			for (unsigned int index = 0; index != number_of_particles; ++index)
+			{
+				const frame_region &region = frame_regions[frame[index]];
+
+				if (region.texture != current_texture)
+				{
+					continue;
+				}
+
+				left = x[index] - offset_x + ((region.center_x - region.half_width) * size);
+				right = x[index] - offset_x + ((region.center_x + region.half_width) * size);
+				top = y[index] - offset_y + ((region.center_y - region.half_height) * size);
+				bottom = y[index] - offset_y + ((region.center_y + region.half_height) * size);
+				minimum_x = std::min(minimum_x, left);
+				minimum_y = std::min(minimum_y, top);
+				maximum_x = std::max(maximum_x, right);
+				maximum_y = std::max(maximum_y, bottom);
+
+				particle_color = color[index];
+
+				if (modulate)
+				{
+					particle_color.a = static_cast<Uint8>((particle_color.a * transparency) / 255);
+
+					if (colormod != NULL)
+					{
+						particle_color.r = static_cast<Uint8>((particle_color.r * colormod->r) / 255);
+						particle_color.g = static_cast<Uint8>((particle_color.g * colormod->g) / 255);
+						particle_color.b = static_cast<Uint8>((particle_color.b * colormod->b) / 255);
+					}
+				}
+
+				vertex[0].position.x = left;
+				vertex[0].position.y = top;
+				vertex[0].tex_coord.x = region.u1;
+				vertex[0].tex_coord.y = region.v1;
+				vertex[1].position.x = right;
+				vertex[1].position.y = top;
+				vertex[1].tex_coord.x = region.u2;
+				vertex[1].tex_coord.y = region.v1;
+				vertex[2].position.x = right;
+				vertex[2].position.y = bottom;
+				vertex[2].tex_coord.x = region.u2;
+				vertex[2].tex_coord.y = region.v2;
+				vertex[3].position.x = left;
+				vertex[3].position.y = bottom;
+				vertex[3].tex_coord.x = region.u1;
+				vertex[3].tex_coord.y = region.v2;
+				vertex[0].color = vertex[1].color = vertex[2].color = vertex[3].color = particle_color;
+				vertex += 4;
+			}
+
+			command.type = DRAW_GEOMETRY;
+			command.texture = current_texture;
+			command.source.x = first_vertex;
+			command.source.y = 0;
+			command.source.w = static_cast<int>(number_of_quads * 4);
+			command.source.h = 0;
+			command.destination.x = static_cast<int>(minimum_x);
+			command.destination.y = static_cast<int>(minimum_y);
+			command.destination.w = static_cast<int>(maximum_x - minimum_x) + 1;
+			command.destination.h = static_cast<int>(maximum_y - minimum_y) + 1;
+			renderer->submit(command);
+		}
+	#else
+		// No SDL_RenderGeometry - one textured draw per particle, which the renderer's draw list still groups by texture:
+		SDL_Rect region;
+		int renderer_width, renderer_height;
+		renderer->get_dimensions(renderer_width, renderer_height);
+		command.type = DRAW_TEXTURE;
+
+		for (unsigned int index = 0; index != number_of_particles; ++index)
+		{
+			if (frame_regions[frame[index]].texture == NULL)
+			{
+				continue;
+			}
+
+			sprite->get_frame_region(frame[index], command.texture, region);
+			command.source = region;
+			command.destination.w = static_cast<int>(static_cast<float>(region.w) * size);
+			command.destination.h = static_cast<int>(static_cast<float>(region.h) * size);
+			command.destination.x = static_cast<int>(x[index] - offset_x + (frame_regions[frame[index]].center_x * size)) - (command.destination.w >> 1);
+			command.destination.y = static_cast<int>(y[index] - offset_y + (frame_regions[frame[index]].center_y * size)) - (command.destination.h >> 1);
+
+			if (command.destination.x >= renderer_width || command.destination.y >= renderer_height || command.destination.x + command.destination.w <= 0 || command.destination.y + command.destination.h <= 0)
+			{
+				continue;
+			}
+
+			particle_color = color[index];
+			command.alpha = static_cast<Uint8>((particle_color.a * transparency) / 255);
+			command.colormod.r = (colormod != NULL) ? static_cast<Uint8>((particle_color.r * colormod->r) / 255) : particle_color.r;
+			command.colormod.g = (colormod != NULL) ? static_cast<Uint8>((particle_color.g * colormod->g) / 255) : particle_color.g;
+			command.colormod.b = (colormod != NULL) ? static_cast<Uint8>((particle_color.b * colormod->b) / 255) : particle_color.b;
+			renderer->submit(command);
+		}
+	#endif
+	}
+
+}
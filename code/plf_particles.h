@@ -0,0 +1,76 @@
+#ifndef PLF_PARTICLES_H
+#define PLF_PARTICLES_H
+
+#include <vector>
+
+#include <SDL2/SDL.h>
+
+#include "plf_renderer.h"
+#include "plf_sprite.h"
+#include "plf_draw_command.h"
+
+
+namespace plf
+{
+
+	// A lightweight alternative to entities for short-lived visual effects - sparks, smoke, debris. Particles have no states, sounds or collision blocks, and take no part in the layer's quadtree.
+	// Particle data is held as structure-of-arrays, so the update loops are simple enough for the compiler to vectorise, and all particles on an atlas page are drawn with a single SDL_RenderGeometry call:
+	class particle_emitter
+	{
+	private:
+		struct frame_region
+		{
+			SDL_Texture *texture; // NULL if the frame can't be drawn as a single quad (multitexture)
+			float u1, v1, u2, v2;
+			float half_width, half_height; // Unscaled
+			float center_x, center_y; // Unscaled offset of the image's centre from the frame's centre - non-zero if the frame's transparent borders were trimmed
+		};
+
+		// Per-particle data. Positions in layer coordinates, velocities in pixels per millisecond, times in milliseconds:
+		std::vector<float> x, y, velocity_x, velocity_y, age, lifetime;
+		std::vector<unsigned int> frame;
+		std::vector<SDL_Color> color;
+
+		std::vector<frame_region> frame_regions; // One per sprite frame
+		std::vector<SDL_Texture *> textures; // Distinct atlas textures among the sprite's frames - usually only one
+		plf::renderer *renderer;
+		plf::sprite *sprite;
+		double emitter_x, emitter_y;
+		double emission_rate; // Particles per millisecond
+		double emission_accumulator; // Fractional particles carried over between updates
+		float minimum_speed, maximum_speed; // Pixels per millisecond
+		float minimum_angle, maximum_angle; // Radians clockwise from the positive x axis
+		float minimum_lifetime, maximum_lifetime;
+		float gravity_x, gravity_y; // Pixels per millisecond per millisecond
+		float size;
+		SDL_Color start_color, end_color; // Interpolated across each particle's lifetime
+		unsigned int maximum_particles;
+		bool single_texture; // Every frame is on the same atlas texture, so particles needn't be counted per texture before drawing
+		bool expire_when_empty;
+		unsigned int regions_compaction; // atlas_manager compaction count when frame_regions were built
+
+		void build_frame_regions(); // Re-read frame atlas locations from the sprite
+		void emit(unsigned int number_of_particles);
+		void remove_particle(const unsigned int index); // Swaps the last particle into index
+	public:
+		particle_emitter(plf::renderer *_renderer, plf::sprite *_sprite, const double x, const double y);
+
+		inline void set_location(const double x, const double y) { emitter_x = x; emitter_y = y; };
+		void set_rate(const double particles_per_second); // Continuous emission, 0 = none
+		void burst(const unsigned int number_of_particles); // Emit a number of particles immediately
+		void set_velocity(const float minimum_pixels_per_second, const float maximum_pixels_per_second, const float minimum_degrees = 0, const float maximum_degrees = 360); // Degrees are clockwise from the right
+		void set_lifetime(const unsigned int minimum_milliseconds, const unsigned int maximum_milliseconds);
+		void set_gravity(const float x_pixels_per_second_squared, const float y_pixels_per_second_squared);
+		void set_colors(const Uint8 start_r, const Uint8 start_g, const Uint8 start_b, const Uint8 start_alpha, const Uint8 end_r, const Uint8 end_g, const Uint8 end_b, const Uint8 end_alpha);
+		inline void set_size(const float new_size) { size = new_size; };
+		inline void set_maximum_particles(const unsigned int maximum) { maximum_particles = maximum; };
+		inline void set_expire_when_empty(const bool expire) { expire_when_empty = expire; }; // For one-off bursts - the layer removes the emitter once it's not emitting and all its particles have died
+		inline unsigned int get_number_of_particles() { return static_cast<unsigned int>(x.size()); };
+
+		int update(const double delta_time); // Returns 20 if the emitter has expired. delta_time is in (fractional) milliseconds
+		void draw(const double display_x, const double display_y, const Uint8 transparency = 255, const rgb *colormod = NULL); // Re-reads frame atlas locations first if the atlases have been compacted since
+	};
+
+}
+
+#endif // PLF_PARTICLES_H
@@ -533,21 +533,31 @@ namespace plf
 	
 	
 	
-	void quadtree::display(SDL_Renderer *renderer, const int displacement_x, const int displacement_y, Uint8 r, Uint8 g, Uint8 b)
+	// A 0/0/0 colour leaves the renderer's current draw colour alone, as SDL_RenderDrawRect did before the draw list:
+	static void draw_rectangle(plf::renderer *renderer, const SDL_Rect &rect, const Uint8 r, const Uint8 g, const Uint8 b)
 	{
-		SDL_Rect rect;
-	
 		if (r != 0 || g != 0 || b != 0)
 		{
-			SDL_SetRenderDrawColor(renderer, r, g, b, 255);
+			renderer->draw_rectangle(rect, r, g, b);
+		}
+		else
+		{
+			renderer->draw_rectangle(rect);
 		}
+	}
+	
+	
+	
+	void quadtree::display(plf::renderer *renderer, const int displacement_x, const int displacement_y, Uint8 r, Uint8 g, Uint8 b)
+	{
+		SDL_Rect rect;
 	
 		for (plf::colony<entity_block *>::iterator current_block = blocks.begin(); current_block != blocks.end(); ++current_block)
 		{
 			rect = (*current_block)->rect;
 			rect.x -= displacement_x;
 			rect.y -= displacement_y;
-			SDL_RenderDrawRect(renderer, &rect);
+			draw_rectangle(renderer, rect, r, g, b);
 		}
 	
 		for (plf::colony<entity_block *>::iterator current_block = large_blocks.begin(); current_block != large_blocks.end(); ++current_block)
@@ -555,7 +565,7 @@ namespace plf
 			rect = (*current_block)->rect;
 			rect.x -= displacement_x;
 			rect.y -= displacement_y;
-			SDL_RenderDrawRect(renderer, &((*current_block)->rect));
+			draw_rectangle(renderer, rect, r, g, b);
 		}
 	
 		if (split_status == SPLIT)
@@ -570,7 +580,7 @@ namespace plf
 		rect.y = top - displacement_y;
 		rect.w = right - left;
 		rect.h = bottom - top;
-		SDL_RenderDrawRect(renderer, &rect);
+		draw_rectangle(renderer, rect, r, g, b);
 	}
 
 }
@@ -91,8 +91,8 @@ namespace plf
 	
 		void get_collisions(std::vector< std::pair<entity *, entity *> > &collision_pairs);
 	
-	  	// For developer tests: displays the quadtree onscreen, given an appropriate SDL_Renderer pointer, with the rgb color assigned (black by default). Have not stored the plf_renderer point in the quadtree as that would be a waste of resources for non-debug builds.
-		void display(SDL_Renderer *renderer, const int display_x, const int display_y, Uint8 r = 0, Uint8 g = 0, Uint8 b = 0);
+	  	// For developer tests: displays the quadtree onscreen, given an appropriate plf::renderer pointer, with the rgb color assigned (the renderer's current draw colour by default, or if 0/0/0). Have not stored the plf_renderer point in the quadtree as that would be a waste of resources for non-debug builds.
+		void display(plf::renderer *renderer, const int display_x, const int display_y, Uint8 r = 0, Uint8 g = 0, Uint8 b = 0);
 	
 		// For internal testing purposes only, do not document:
 		void get_blocks_at(const int x, const int y, plf::colony<entity_block *> &block_collection); // Returns all blocks at given coordinates
@@ -0,0 +1,223 @@
+#include <vector>
+#include <algorithm> // std::min, std::max
+#include <climits> // INT_MAX
+#include <cassert>
+
+#include <SDL2/SDL.h>
+
+#include "plf_rectangle_packer.h"
+
+
+namespace plf
+{
+
+	rectangle_packer::rectangle_packer(const unsigned int packer_width, const unsigned int packer_height):
+		width(static_cast<int>(packer_width)),
+		height(static_cast<int>(packer_height)),
+		number_of_rectangles(0)
+	{
+		assert(width != 0 && height != 0);
+		clear();
+	}
+
+
+
+	void rectangle_packer::clear()
+	{
+		free_rectangles.clear();
+		SDL_Rect whole_area = {0, 0, width, height};
+		free_rectangles.push_back(whole_area);
+		number_of_rectangles = 0;
+	}
+
+
+
+	bool rectangle_packer::insert(const unsigned int rectangle_width, const unsigned int rectangle_height, SDL_Rect &placed)
+	{
+		const int placed_width = static_cast<int>(rectangle_width), placed_height = static_cast<int>(rectangle_height);
+		std::vector<SDL_Rect>::iterator best_rectangle = free_rectangles.end();
+		int best_short_side = INT_MAX, best_long_side = INT_MAX, short_side, long_side;
+
+		// Best short side fit - the free rectangle which leaves the least space along one side of the new one:
+		for (std::vector<SDL_Rect>::iterator rectangle_iterator = free_rectangles.begin(); rectangle_iterator != free_rectangles.end(); ++rectangle_iterator)
+		{
+			if (placed_width > rectangle_iterator->w || placed_height > rectangle_iterator->h)
+			{
+				continue;
+			}
+
+			short_side = std::min(rectangle_iterator->w - placed_width, rectangle_iterator->h - placed_height);
+			long_side = std::max(rectangle_iterator->w - placed_width, rectangle_iterator->h - placed_height);
+
+			if (short_side < best_short_side || (short_side == best_short_side && long_side < best_long_side))
+			{
+				best_rectangle = rectangle_iterator;
+				best_short_side = short_side;
+				best_long_side = long_side;
+			}
+		}
+
+		if (best_rectangle == free_rectangles.end())
+		{
+			return false;
+		}
+
+		placed.x = best_rectangle->x;
+		placed.y = best_rectangle->y;
+		placed.w = placed_width;
+		placed.h = placed_height;
+		reserve(placed);
+		return true;
+	}
+
+
+
+	void rectangle_packer::reserve(const SDL_Rect &area)
+	{
+		std::vector<SDL_Rect> split_rectangles;
+		SDL_Rect free_rectangle, split_rectangle;
+
+		// Replace every free rectangle the area overlaps with the (up to four) maximal rectangles left around it:
+		for (std::vector<SDL_Rect>::iterator rectangle_iterator = free_rectangles.begin(); rectangle_iterator != free_rectangles.end();)
+		{
+			if (!SDL_HasIntersection(&*rectangle_iterator, &area))
+			{
+				++rectangle_iterator;
+				continue;
+			}
+
+			free_rectangle = *rectangle_iterator;
+
+			if (area.x > free_rectangle.x) // Left
+			{
+				split_rectangle = free_rectangle;
+				split_rectangle.w = area.x - free_rectangle.x;
+				split_rectangles.push_back(split_rectangle);
+			}
+
+			if (area.x + area.w < free_rectangle.x + free_rectangle.w) // Right
+			{
+				split_rectangle = free_rectangle;
+				split_rectangle.x = area.x + area.w;
+				split_rectangle.w = (free_rectangle.x + free_rectangle.w) - split_rectangle.x;
+				split_rectangles.push_back(split_rectangle);
+			}
+
+			if (area.y > free_rectangle.y) // Above
+			{
+				split_rectangle = free_rectangle;
+				split_rectangle.h = area.y - free_rectangle.y;
+				split_rectangles.push_back(split_rectangle);
+			}
+
+			if (area.y + area.h < free_rectangle.y + free_rectangle.h) // Below
+			{
+				split_rectangle = free_rectangle;
+				split_rectangle.y = area.y + area.h;
+				split_rectangle.h = (free_rectangle.y + free_rectangle.h) - split_rectangle.y;
+				split_rectangles.push_back(split_rectangle);
+			}
+
+			rectangle_iterator = free_rectangles.erase(rectangle_iterator);
+		}
+
+		free_rectangles.insert(free_rectangles.end(), split_rectangles.begin(), split_rectangles.end());
+		prune();
+		++number_of_rectangles;
+	}
+
+
+
+	void rectangle_packer::release(const SDL_Rect &area)
+	{
+		assert(number_of_rectangles != 0);
+
+		if (--number_of_rectangles == 0)
+		{
+			clear();
+			return;
+		}
+
+		free_rectangles.push_back(area);
+
+		// Merge free rectangles which share a whole edge, until no more can be merged. The result isn't necessarily maximal, but is always valid:
+		bool merged = true;
+
+		while (merged)
+		{
+			merged = false;
+
+			for (unsigned int first = 0; first != free_rectangles.size() && !merged; ++first)
+			{
+				for (unsigned int second = first + 1; second != free_rectangles.size(); ++second)
+				{
+					SDL_Rect &a = free_rectangles[first], &b = free_rectangles[second];
+
+					if (a.x == b.x && a.w == b.w && (a.y + a.h == b.y || b.y + b.h == a.y)) // Vertically adjacent
+					{
+						a.y = std::min(a.y, b.y);
+						a.h += b.h;
+					}
+					else if (a.y == b.y && a.h == b.h && (a.x + a.w == b.x || b.x + b.w == a.x)) // Horizontally adjacent
+					{
+						a.x = std::min(a.x, b.x);
+						a.w += b.w;
+					}
+					else
+					{
+						continue;
+					}
+
+					free_rectangles.erase(free_rectangles.begin() + second);
+					merged = true;
+					break;
+				}
+			}
+		}
+
+		prune();
+	}
+
+
+
+	void rectangle_packer::prune()
+	{
+		for (unsigned int first = 0; first < free_rectangles.size(); ++first)
+		{
+			for (unsigned int second = first + 1; second < free_rectangles.size(); ++second)
+			{
+				const SDL_Rect &a = free_rectangles[first], &b = free_rectangles[second];
+
+				if (a.x >= b.x && a.y >= b.y && a.x + a.w <= b.x + b.w && a.y + a.h <= b.y + b.h) // a within b
+				{
+					free_rectangles.erase(free_rectangles.begin() + first);
+					--first;
+					break;
+				}
+
+				if (b.x >= a.x && b.y >= a.y && b.x + b.w <= a.x + a.w && b.y + b.h <= a.y + a.h) // b within a
+				{
+					free_rectangles.erase(free_rectangles.begin() + second);
+					--second;
+				}
+			}
+		}
+	}
+
+
+
+	void rectangle_packer::get_largest_free_rectangle(unsigned int &largest_width, unsigned int &largest_height)
+	{
+		largest_width = largest_height = 0;
+
+		for (std::vector<SDL_Rect>::iterator rectangle_iterator = free_rectangles.begin(); rectangle_iterator != free_rectangles.end(); ++rectangle_iterator)
+		{
+			if (static_cast<unsigned int>(rectangle_iterator->w * rectangle_iterator->h) > largest_width * largest_height)
+			{
+				largest_width = static_cast<unsigned int>(rectangle_iterator->w);
+				largest_height = static_cast<unsigned int>(rectangle_iterator->h);
+			}
+		}
+	}
+
+}
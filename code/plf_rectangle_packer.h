@@ -0,0 +1,35 @@
+#ifndef PLF_RECTANGLE_PACKER_H
+#define PLF_RECTANGLE_PACKER_H
+
+#include <vector>
+
+#include <SDL2/SDL.h>
+
+
+namespace plf
+{
+
+	// MaxRects packing of rectangles into a fixed area. Tracks every maximal free rectangle, and places each new rectangle where it leaves the shortest leftover side (best short side fit).
+	// Holds no pixel data, so is shared by atlas pages at run time and the offline atlas baker:
+	class rectangle_packer
+	{
+	private:
+		std::vector<SDL_Rect> free_rectangles; // May overlap
+		int width, height;
+		unsigned int number_of_rectangles;
+
+		void prune(); // Remove free rectangles contained within others
+	public:
+		rectangle_packer(const unsigned int packer_width, const unsigned int packer_height);
+
+		bool insert(const unsigned int rectangle_width, const unsigned int rectangle_height, SDL_Rect &placed); // false if there's no space
+		void reserve(const SDL_Rect &area); // Mark a specific area as used, eg. a pre-packed image
+		void release(const SDL_Rect &area); // Area must have been returned by insert, or passed to reserve
+		void get_largest_free_rectangle(unsigned int &largest_width, unsigned int &largest_height);
+		void clear();
+		inline unsigned int get_number_of_rectangles() { return number_of_rectangles; };
+	};
+
+}
+
+#endif // PLF_RECTANGLE_PACKER_H
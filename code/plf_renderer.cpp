@@ -1,3 +1,9 @@
+#include <vector>
+#include <map>
+#include <cassert>
+#include <algorithm> // std::swap, std::stable_sort
+#include <cstring> // memset
+
 #include <SDL2/SDL.h>
 
 #include "plf_window.h"
@@ -8,12 +14,46 @@
 namespace plf
 {
 
+	// Draw list ordering - sort key first, then group by texture and modulation state to minimise texture switches and state changes:
+	static bool draw_order(const draw_command &command1, const draw_command &command2)
+	{
+		if (command1.sort_key != command2.sort_key)
+		{
+			return command1.sort_key < command2.sort_key;
+		}
+	
+		if (command1.texture != command2.texture)
+		{
+			return command1.texture < command2.texture;
+		}
+	
+		if (command1.alpha != command2.alpha)
+		{
+			return command1.alpha < command2.alpha;
+		}
+	
+		return ((command1.colormod.r << 16) | (command1.colormod.g << 8) | command1.colormod.b) < ((command2.colormod.r << 16) | (command2.colormod.g << 8) | command2.colormod.b);
+	}
+	
+
 
 	renderer::renderer(SDL_Window *window, const int logical_width, const int logical_height, const VSYNC_MODE vsync_mode):
 		s_renderer(NULL),
 		width(logical_width),
-		height(logical_height)
+		height(logical_height),
+		vsync_enabled(false),
+		render_targets_supported(false),
+		target_blend_mode(SDL_BLENDMODE_BLEND),
+		current_sort_key(0),
+		render_mode(RENDER_IMMEDIATE),
+		collecting_draw_list(false),
+		recording_target(NULL),
+		last_texture(NULL),
+		renderer_mutex(NULL)
 	{
+		std::memset(&current_statistics, 0, sizeof(render_statistics));
+		std::memset(&frame_statistics, 0, sizeof(render_statistics));
+	
 		// Try for hardware acceleration with supplied vsync setting, rendering to textures, fallback to software rendering and/or with inverse vsync setting if unavailable:
 		s_renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED|((vsync_mode == VSYNC_ON) ? SDL_RENDERER_PRESENTVSYNC : 0)|SDL_RENDERER_TARGETTEXTURE);
 	
@@ -57,6 +97,11 @@ namespace plf
 	
 		std::clog << "plf::renderer created, using " << s_renderer_info.name << ", max texture width/height = " << s_renderer_info.max_texture_width << "/" << s_renderer_info.max_texture_height << "." << std::endl;
 	
+		vsync_enabled = (s_renderer_info.flags & SDL_RENDERER_PRESENTVSYNC) != 0;
+		std::clog << "plf::renderer: vsync " << ((vsync_enabled) ? "enabled." : "disabled.") << std::endl;
+	
+		render_targets_supported = (s_renderer_info.flags & SDL_RENDERER_TARGETTEXTURE) != 0;
+	
 	
 		// *Determine pixelformats*:
 	
@@ -99,12 +144,41 @@ namespace plf
 		
 		SDL_DestroyTexture(test_texture);
 		// * end determining pixelformats *
+	
+		if (render_targets_supported)
+		{
+		#if SDL_VERSION_ATLEAST(2, 0, 6)
+			// Test premultiplied-alpha blending, which is not supported by all backends (eg. software):
+			const SDL_BlendMode premultiplied_blend_mode = SDL_ComposeCustomBlendMode(SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD, SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD);
+			test_texture = SDL_CreateTexture(s_renderer, default_texture_pixel_format, SDL_TEXTUREACCESS_TARGET, 1, 1);
+	
+			if (test_texture != NULL && SDL_SetTextureBlendMode(test_texture, premultiplied_blend_mode) == 0)
+			{
+				target_blend_mode = premultiplied_blend_mode;
+			}
+			else
+			{
+				std::clog << "plf::renderer Constructor possible issue: premultiplied alpha blending not supported, semi-transparent edges of cached layers may be darkened." << std::endl;
+			}
+	
+			SDL_DestroyTexture(test_texture);
+		#endif
+		}
+		else
+		{
+			std::clog << "plf::renderer Constructor possible issue: render targets not supported, layer caching disabled." << std::endl;
+		}
+	
+		renderer_mutex = SDL_CreateMutex();
+		plf_fail_if (renderer_mutex == NULL, "plf::renderer Constructor: Could not create renderer mutex! ");
 	}
 	
 	
 	
 	renderer::~renderer()
 	{
+		SDL_DestroyMutex(renderer_mutex);
+	
 		// Destroy renderer
 		SDL_DestroyRenderer(s_renderer);
 	}
@@ -113,6 +187,11 @@ namespace plf
 	
 	SDL_Renderer* renderer::get()
 	{
+		if (render_mode == RENDER_IMMEDIATE) // In recorded mode the batch and texture states belong to display_frame's replay
+		{
+			finish_commands();
+		}
+	
 		return s_renderer;
 	}
 	
@@ -129,14 +208,121 @@ namespace plf
 	
 	void renderer::display_frame()
 	{
-		SDL_RenderPresent(s_renderer);
+		switch (render_mode)
+		{
+			case RENDER_IMMEDIATE:
+				lock();
+				SDL_RenderPresent(s_renderer);
+				unlock();
+			#ifdef PLF_SPRITE_BATCHING
+				geometry_vertices.clear();
+			#endif
+				end_frame_statistics();
+				break;
+			case RENDER_RECORDED:
+				lock();
+				execute_commands(recorded_commands);
+				SDL_RenderPresent(s_renderer);
+				unlock();
+				recorded_commands.clear();
+			#ifdef PLF_SPRITE_BATCHING
+				geometry_vertices.clear();
+			#endif
+				end_frame_statistics();
+				break;
+		}
+	}
+	
+	
+	
+#ifdef PLF_SPRITE_BATCHING
+	SDL_Vertex * renderer::add_quads(const unsigned int number_of_quads, int &first_vertex)
+	{
+		first_vertex = static_cast<int>(geometry_vertices.size());
+		geometry_vertices.resize(geometry_vertices.size() + (number_of_quads * 4));
+		return &(geometry_vertices[first_vertex]);
 	}
+#endif
 	
 	
 	
 	void renderer::clear_renderer()
 	{
-		SDL_RenderClear(s_renderer);
+		if (render_mode == RENDER_IMMEDIATE)
+		{
+			lock();
+			SDL_RenderClear(s_renderer);
+			unlock();
+			return;
+		}
+	
+		clear(0, 0, 0, 255);
+	}
+	
+	
+	
+	void renderer::clear(const Uint8 r, const Uint8 g, const Uint8 b, const Uint8 a)
+	{
+		draw_command command;
+		command.type = DRAW_CLEAR;
+		command.texture = NULL;
+		command.opaque = false;
+		command.colormod.r = r;
+		command.colormod.g = g;
+		command.colormod.b = b;
+		command.alpha = a;
+		submit(command);
+	}
+	
+	
+	
+	SDL_Texture * renderer::create_target_texture(const int target_width, const int target_height)
+	{
+		if (!render_targets_supported)
+		{
+			return NULL;
+		}
+	
+		lock();
+		SDL_Texture *target = SDL_CreateTexture(s_renderer, default_texture_pixel_format, SDL_TEXTUREACCESS_TARGET, target_width, target_height);
+	
+		if (target != NULL)
+		{
+			SDL_SetTextureBlendMode(target, target_blend_mode);
+		}
+		else
+		{
+			std::clog << "plf::renderer create_target_texture: could not create " << target_width << "x" << target_height << " render target. SDL Error: " << SDL_GetError() << std::endl;
+		}
+	
+		unlock();
+		return target;
+	}
+	
+	
+	
+	void renderer::destroy_target_texture(SDL_Texture *target)
+	{
+		if (target == NULL)
+		{
+			return;
+		}
+	
+		lock();
+		SDL_DestroyTexture(target);
+		unlock();
+	}
+	
+	
+	
+	void renderer::set_target(SDL_Texture *target)
+	{
+		draw_command command;
+		command.type = DRAW_SET_TARGET;
+		command.texture = target;
+		command.opaque = false;
+		submit(command);
+		recording_target = target;
 	}
 	
 	
@@ -154,7 +340,357 @@ namespace plf
 		return_width = width;
 		return_height = height;
 	}
-
+	
+	
+	
+	void renderer::draw_rectangle(const SDL_Rect &rectangle, const Uint8 r, const Uint8 g, const Uint8 b)
+	{
+		draw_command command;
+		command.type = DRAW_RECTANGLE;
+		command.texture = NULL;
+		command.opaque = false;
+		command.destination = rectangle;
+		command.colormod.r = r;
+		command.colormod.g = g;
+		command.colormod.b = b;
+		command.alpha = 255;
+		submit(command);
+	}
+	
+	
+	
+	void renderer::draw_rectangle(const SDL_Rect &rectangle)
+	{
+		draw_command command;
+		command.type = DRAW_RECTANGLE;
+		command.texture = NULL;
+		command.opaque = false;
+		command.destination = rectangle;
+		command.colormod.r = command.colormod.g = command.colormod.b = 0;
+		command.alpha = 0; // Use the current draw colour
+		submit(command);
+	}
+	
+	
+	
+	void renderer::set_texture_state(SDL_Texture *texture, const Uint8 alpha, const rgb &colormod)
+	{
+		std::map<SDL_Texture *, texture_state>::iterator state_iterator = texture_states.find(texture);
+		texture_state current_state;
+	
+		if (state_iterator != texture_states.end())
+		{
+			current_state = state_iterator->second;
+		}
+		else if (alpha == 255 && (colormod.r & colormod.g & colormod.b) == 255)
+		{
+			return; // Texture is already at default
+		}
+		else
+		{
+			current_state.alpha = 255;
+			current_state.colormod.r = current_state.colormod.g = current_state.colormod.b = 255;
+		}
+	
+		if (current_state.alpha != alpha)
+		{
+			SDL_SetTextureAlphaMod(texture, alpha);
+			++current_statistics.mod_changes;
+		}
+	
+		if (current_state.colormod.r != colormod.r || current_state.colormod.g != colormod.g || current_state.colormod.b != colormod.b)
+		{
+			SDL_SetTextureColorMod(texture, colormod.r, colormod.g, colormod.b);
+			++current_statistics.mod_changes;
+		}
+	
+		current_state.alpha = alpha;
+		current_state.colormod = colormod;
+		texture_states[texture] = current_state;
+	}
+	
+	
+	
+	void renderer::reset_texture_states()
+	{
+		const rgb white = {255, 255, 255};
+	
+		while (!(texture_states.empty()))
+		{
+			set_texture_state(texture_states.begin()->first, 255, white);
+			texture_states.erase(texture_states.begin());
+		}
+	}
+	
+	
+	
+	void renderer::finish_commands()
+	{
+		flush_batch();
+		reset_texture_states();
+	}
+	
+	
+	
+	void renderer::end_frame_statistics()
+	{
+		frame_statistics = current_statistics;
+	
+		std::memset(&current_statistics, 0, sizeof(render_statistics));
+		last_texture = NULL;
+	}
+	
+	
+	
+	render_statistics renderer::get_frame_statistics()
+	{
+		return frame_statistics;
+	}
+	
+	
+	
+	void renderer::begin_draw_list()
+	{
+		assert(!collecting_draw_list);
+		collecting_draw_list = true;
+	}
+	
+	
+	
+	void renderer::end_draw_list()
+	{
+		assert(collecting_draw_list);
+		collecting_draw_list = false;
+	
+		// Stable, so that draws with identical keys, texture and state keep their submission order:
+		std::stable_sort(draw_list.begin(), draw_list.end(), draw_order);
+		cull_hidden_commands();
+	
+		if (render_mode == RENDER_IMMEDIATE)
+		{
+			for (std::vector<draw_command>::iterator command_iterator = draw_list.begin(); command_iterator != draw_list.end(); ++command_iterator)
+			{
+				execute(*command_iterator);
+			}
+		}
+		else
+		{
+			recorded_commands.insert(recorded_commands.end(), draw_list.begin(), draw_list.end());
+		}
+	
+		draw_list.clear();
+	}
+	
+	
+	
+	void renderer::cull_hidden_commands()
+	{
+		SDL_Rect viewport = {0, 0, width, height};
+	
+		if (recording_target != NULL)
+		{
+			SDL_QueryTexture(recording_target, NULL, NULL, &(viewport.w), &(viewport.h));
+		}
+	
+		// The largest opaque areas found so far - a small fixed number keeps the containment test cheap, and large areas (backgrounds, tiles) do nearly all of the occluding:
+		const unsigned int maximum_occluders = 8;
+		SDL_Rect occluders[maximum_occluders];
+		unsigned int number_of_occluders = 0, occluder_index;
+		SDL_Rect visible;
+		bool hidden;
+	
+		// Walk from the topmost command downwards, moving surviving commands towards the end of the list so that their order is retained:
+		std::vector<draw_command>::iterator destination = draw_list.end();
+	
+		for (std::vector<draw_command>::iterator command_iterator = draw_list.end(); command_iterator != draw_list.begin();)
+		{
+			--command_iterator;
+	
+			if (command_iterator->type == DRAW_TEXTURE && command_iterator->angle == 0)
+			{
+				hidden = (SDL_IntersectRect(&(command_iterator->destination), &viewport, &visible) == SDL_FALSE);
+	
+				for (occluder_index = 0; !hidden && occluder_index != number_of_occluders; ++occluder_index)
+				{
+					const SDL_Rect &occluder = occluders[occluder_index];
+					hidden = (visible.x >= occluder.x && visible.y >= occluder.y && visible.x + visible.w <= occluder.x + occluder.w && visible.y + visible.h <= occluder.y + occluder.h);
+				}
+	
+				if (hidden)
+				{
+					continue;
+				}
+	
+				if (command_iterator->opaque)
+				{
+					if (number_of_occluders != maximum_occluders)
+					{
+						occluders[number_of_occluders++] = visible;
+					}
+					else
+					{
+						// Replace the smallest occluder, if this one is larger:
+						unsigned int smallest_index = 0;
+	
+						for (occluder_index = 1; occluder_index != maximum_occluders; ++occluder_index)
+						{
+							if (occluders[occluder_index].w * occluders[occluder_index].h < occluders[smallest_index].w * occluders[smallest_index].h)
+							{
+								smallest_index = occluder_index;
+							}
+						}
+	
+						if (visible.w * visible.h > occluders[smallest_index].w * occluders[smallest_index].h)
+						{
+							occluders[smallest_index] = visible;
+						}
+					}
+				}
+			}
+	
+			*(--destination) = *command_iterator;
+		}
+	
+		draw_list.erase(draw_list.begin(), destination);
+	}
+	
+	
+	
+	int renderer::execute(const draw_command &command)
+	{
+		int return_value = 0;
+		++current_statistics.commands;
+	
+		if (command.type == DRAW_TEXTURE)
+		{
+			if (command.texture != last_texture)
+			{
+				flush_batch();
+				last_texture = command.texture;
+				++current_statistics.texture_binds;
+			}
+	
+		#ifdef PLF_SPRITE_BATCHING
+			return batch.add(s_renderer, command); // Modulation goes into vertex colors, so texture state is left alone
+		#endif
+		}
+		else
+		{
+			flush_batch(); // Keep batched quads in order with non-texture commands
+		}
+	
+		switch (command.type)
+		{
+			case DRAW_TEXTURE: // Only reached when SDL_RenderGeometry is unavailable
+			{
+				set_texture_state(command.texture, command.alpha, command.colormod);
+				++current_statistics.draw_calls;
+	
+				// Optimise for most common scenario:
+				if (command.angle == 0 && command.flip == SDL_FLIP_NONE && !command.has_center)
+				{
+					return_value = SDL_RenderCopy(s_renderer, command.texture, &(command.source), &(command.destination));
+				}
+				else
+				{
+					return_value = SDL_RenderCopyEx(s_renderer, command.texture, &(command.source), &(command.destination), command.angle, (command.has_center) ? &(command.center) : NULL, command.flip);
+				}
+	
+				break;
+			}
+			case DRAW_RECTANGLE:
+			{
+				if (command.alpha == 0) // Current draw colour
+				{
+					return_value = SDL_RenderDrawRect(s_renderer, &(command.destination));
+					++current_statistics.draw_calls;
+					break;
+				}
+	
+				Uint8 r, g, b, a;
+				SDL_GetRenderDrawColor(s_renderer, &r, &g, &b, &a);
+				SDL_SetRenderDrawColor(s_renderer, command.colormod.r, command.colormod.g, command.colormod.b, command.alpha);
+				return_value = SDL_RenderDrawRect(s_renderer, &(command.destination));
+				++current_statistics.draw_calls;
+				SDL_SetRenderDrawColor(s_renderer, r, g, b, a);
+				break;
+			}
+			case DRAW_CLEAR:
+			{
+				Uint8 r, g, b, a;
+				SDL_GetRenderDrawColor(s_renderer, &r, &g, &b, &a);
+				SDL_SetRenderDrawColor(s_renderer, command.colormod.r, command.colormod.g, command.colormod.b, command.alpha);
+				return_value = SDL_RenderClear(s_renderer);
+				SDL_SetRenderDrawColor(s_renderer, r, g, b, a);
+				++current_statistics.draw_calls;
+				break;
+			}
+			case DRAW_SET_TARGET:
+				return_value = SDL_SetRenderTarget(s_renderer, command.texture);
+				break;
+			case DRAW_GEOMETRY:
+			{
+			#ifdef PLF_SPRITE_BATCHING
+				const int number_of_indices = (command.source.w >> 2) * 6;
+	
+				for (int quad_vertex = static_cast<int>(quad_indices.size() / 6) * 4; static_cast<int>(quad_indices.size()) < number_of_indices; quad_vertex += 4)
+				{
+					quad_indices.push_back(quad_vertex);
+					quad_indices.push_back(quad_vertex + 1);
+					quad_indices.push_back(quad_vertex + 2);
+					quad_indices.push_back(quad_vertex);
+					quad_indices.push_back(quad_vertex + 2);
+					quad_indices.push_back(quad_vertex + 3);
+				}
+	
+				if (command.texture != last_texture)
+				{
+					last_texture = command.texture;
+					++current_statistics.texture_binds;
+				}
+	
+				return_value = SDL_RenderGeometry(s_renderer, command.texture, &(geometry_vertices[command.source.x]), command.source.w, &(quad_indices[0]), number_of_indices);
+				++current_statistics.draw_calls;
+			#endif
+				break;
+			}
+		}
+	
+		return return_value;
+	}
+	
+	
+	
+	void renderer::execute_commands(std::vector<draw_command> &commands)
+	{
+		for (std::vector<draw_command>::iterator command_iterator = commands.begin(); command_iterator != commands.end(); ++command_iterator)
+		{
+			execute(*command_iterator);
+		}
+	
+		finish_commands();
+	}
+	
+	
+	
+	void renderer::set_render_mode(const RENDER_MODE mode)
+	{
+		if (mode == render_mode)
+		{
+			return;
+		}
+	
+		// Don't lose anything recorded for the current frame - draw it now, it'll be presented by the next display_frame():
+		if (!(recorded_commands.empty()) && mode == RENDER_IMMEDIATE)
+		{
+			lock();
+			execute_commands(recorded_commands);
+			unlock();
+			recorded_commands.clear();
+		}
+	
+		render_mode = mode;
+	}
 
 
 }
\ No newline at end of file
@@ -1,9 +1,14 @@
 #ifndef PLF_RENDERER_H
 #define PLF_RENDERER_H
 
+#include <vector>
+#include <map>
+
 #include <SDL2/SDL.h>
 
 #include "plf_window.h"
+#include "plf_draw_command.h"
+#include "plf_sprite_batch.h"
 
 
 namespace plf
@@ -17,27 +22,154 @@ namespace plf
 	
 	
 	
+	enum RENDER_MODE
+	{
+		RENDER_IMMEDIATE,	// Draws are issued to SDL as they are submitted (default)
+		RENDER_RECORDED		// Draws are recorded, then replayed and presented by display_frame()
+	};
+	
+	
+	
+	// Per-frame counts, for profiling draw order and batching:
+	struct render_statistics
+	{
+		unsigned int commands;			// Draw commands executed
+		unsigned int draw_calls;		// SDL_RenderCopy(Ex)/SDL_RenderGeometry/SDL_RenderDrawRect/SDL_RenderClear calls issued
+		unsigned int texture_binds;		// Changes of texture between consecutive textured draws
+		unsigned int mod_changes;		// SDL_SetTextureAlphaMod/SDL_SetTextureColorMod calls issued
+	};
+	
+	
+	
 	class renderer
 	{
 	private:
 		SDL_Renderer *s_renderer;
 		int width, height; // Logical resolutions of the renderer, as opposed to the screen it is projected onto
 		Uint32 default_texture_pixel_format, default_surface_pixel_format; // These two may be different to each other
+		bool vsync_enabled; // Whether the renderer actually obtained vsync - may differ from the requested mode if fallbacks were used
+		bool render_targets_supported;
+		SDL_BlendMode target_blend_mode; // Render targets hold premultiplied alpha, so are blended with (one, one - source alpha) where the backend allows
+	
+		std::vector<draw_command> recorded_commands; // This frame's draws, in recorded mode
+		Uint64 current_sort_key;
+		RENDER_MODE render_mode;
+	
+		// Draw list for the layer currently being drawn - sorted by sort key, then texture and modulation state, before being executed or recorded:
+		std::vector<draw_command> draw_list;
+		bool collecting_draw_list;
+		SDL_Texture *recording_target; // Render target as of the most recently submitted set_target(), for culling draw lists against the right viewport
+	
+		// Alpha and color modulation currently set on each texture, for those which aren't at the default (255, white). Textures are reset to default at the end of each command list rather than after every draw:
+		struct texture_state
+		{
+			Uint8 alpha;
+			rgb colormod;
+		};
+	
+		std::map<SDL_Texture *, texture_state> texture_states;
+		SDL_Texture *last_texture; // Texture of the last textured draw, for counting binds
+		render_statistics current_statistics, frame_statistics;
+	
+		SDL_mutex *renderer_mutex; // Held by whichever thread is currently issuing calls to the SDL_Renderer
+	
+	#ifdef PLF_SPRITE_BATCHING
+		sprite_batch batch; // Consecutive textured draws on the same atlas page are accumulated here and drawn together
+	
+		std::vector<SDL_Vertex> geometry_vertices; // Vertices for this frame's DRAW_GEOMETRY commands
+		std::vector<int> quad_indices; // 0, 1, 2, 0, 2, 3, 4, 5, 6, 4, 6, 7... shared by all geometry draws
+	#endif
+	
+		inline int flush_batch()
+		{
+		#ifdef PLF_SPRITE_BATCHING
+			if (!batch.empty())
+			{
+				++current_statistics.draw_calls;
+				return batch.flush(s_renderer);
+			}
+		#endif
+	
+			return 0;
+		};
+	
+		void set_texture_state(SDL_Texture *texture, const Uint8 alpha, const rgb &colormod);
+		void reset_texture_states();
+		void finish_commands(); // Draw any batched quads and reset texture modulation
+		void end_frame_statistics();
+		void cull_hidden_commands();
+		int execute(const draw_command &command);
+		void execute_commands(std::vector<draw_command> &commands);
 	public:
 		// Construct an SDL_Renderer using the parameters provided, figure out texture and surface pixel formats, test renderer properties:
 		renderer(SDL_Window *window, int logical_width, int logical_height, const VSYNC_MODE vsync_mode);
 		~renderer();
 	
-		SDL_Renderer* get(); // Get a raw pointer to the SDL_Renderer
+		SDL_Renderer* get(); // Get a raw pointer to the SDL_Renderer. In immediate mode, also draws any batched quads so that direct SDL_Render* calls are ordered correctly
 		SDL_RendererInfo get_info(); // Return SDL-encoded data about the renderer
 	
 		void get_dimensions(int &return_width, int &return_height);
 		inline Uint32 get_surface_pixel_format() { return default_surface_pixel_format; };
 		inline Uint32 get_texture_pixel_format() { return default_texture_pixel_format; };
+		inline bool is_vsync_enabled() { return vsync_enabled; };
 	
 		void display_frame(); // Display renderer content at present point in time
 		void clear_renderer(); // This clears the renderer but does not actually update the screen
 		void clear_screen(); // Calls clear_renderer and updates screen
+		void clear(const Uint8 r, const Uint8 g, const Uint8 b, const Uint8 a); // Clear the current render target to the specified color
+	
+		// Render targets - for caching layer content. Textures drawn into a target contain premultiplied alpha, so when a target is drawn with transparency its color modulation must also be scaled by the transparency:
+		inline bool has_render_targets() { return render_targets_supported; };
+		SDL_Texture * create_target_texture(const int target_width, const int target_height); // Returns NULL if unsupported or creation fails
+		void destroy_target_texture(SDL_Texture *target);
+		void set_target(SDL_Texture *target); // NULL == window
+	
+		// In recorded mode, all drawing must go through submit() (textures, sprites, layers and draw_rectangle all do), not direct SDL_Render* calls.
+		void set_render_mode(const RENDER_MODE mode);
+		inline RENDER_MODE get_render_mode() { return render_mode; };
+	
+		// Draw, or record for later replay, depending on render mode. Stamps the command with the current sort key:
+		inline int submit(draw_command &command)
+		{
+			command.sort_key = current_sort_key;
+	
+			if (collecting_draw_list)
+			{
+				draw_list.push_back(command);
+				return 0;
+			}
+	
+			if (render_mode == RENDER_IMMEDIATE)
+			{
+				return execute(command);
+			}
+	
+			recorded_commands.push_back(command);
+			return 0;
+		};
+	
+	#ifdef PLF_SPRITE_BATCHING
+		// Reserve number_of_quads quads (4 vertices each, clockwise from top-left) in this frame's vertex storage, for a DRAW_GEOMETRY command. The pointer is invalidated by the next call, so fill the vertices in first:
+		SDL_Vertex * add_quads(const unsigned int number_of_quads, int &first_vertex);
+	#endif
+	
+		inline void set_sort_key(const Uint64 sort_key) { current_sort_key = sort_key; };
+		inline Uint64 get_sort_key() { return current_sort_key; };
+		void draw_rectangle(const SDL_Rect &rectangle, const Uint8 r, const Uint8 g, const Uint8 b); // Outline only
+		void draw_rectangle(const SDL_Rect &rectangle); // Outline only, in the renderer's current draw colour
+	
+		// Commands submitted between these two calls are collected, then sorted by (sort key, atlas texture, alpha/color modulation) so that draws with equal sort keys are grouped by texture and state.
+		// Order is only preserved between differing sort keys, so anything which must draw in a particular order needs its own key.
+		// Unrotated textured draws which are entirely off the current target, or entirely beneath opaque draws later in the list, are culled:
+		void begin_draw_list();
+		void end_draw_list();
+	
+		render_statistics get_frame_statistics(); // Counts for the most recently presented frame
+	
+		// Must bracket any direct use of the SDL_Renderer (texture creation, uploads, destruction).
+		// Batched quads are drawn on locking, so an atlas upload can't alter texture content which has already been submitted:
+		inline void lock() { SDL_LockMutex(renderer_mutex); finish_commands(); };
+		inline void unlock() { SDL_UnlockMutex(renderer_mutex); };
 	};
 
 
@@ -4,6 +4,7 @@
 #include <deque>
 #include <map>
 #include <cmath> // sound positioning - sqrt
+#include <climits> // UINT_MAX
 #include <cassert>
 
 #include <SDL2/SDL.h>
@@ -361,6 +362,7 @@ namespace plf
 		delaying(false),
 		fading_out(false),
 		started(false),
+		parked(false),
 		current_volume(127), 
 		current_pan(127) 
 	{
@@ -406,6 +408,7 @@ namespace plf
 		delaying(false),
 		fading_out(false),
 		started(false),
+		parked(false),
 	
 		current_volume(127), 
 		current_pan(127) 
@@ -442,6 +445,11 @@ namespace plf
 	
 		recalculate_volume_and_pan(x, y);
 	
+		if (current_channel == -2) // Out of earshot, and not looped - not played
+		{
+			return;
+		}
+	
 		// set volume and stereo pan of channel:
 		Mix_Volume(current_channel, current_volume);
 		Mix_SetPanning(current_channel, 255 - current_pan, current_pan);
@@ -460,6 +468,11 @@ namespace plf
 		}
 	
 		sound_ref->play(current_channel, loop);
+	
+		if (parked) // Starting playback unpauses the channel
+		{
+			Mix_Pause(current_channel);
+		}
 	}
 	
 	
@@ -477,11 +490,58 @@ namespace plf
 	
 		recalculate_volume_and_pan(x, y);
 	
+		if (current_channel == -2) // Out of earshot, and not looped - not played
+		{
+			return;
+		}
+	
 		// set volume and stereo pan of channel:
 		Mix_Volume(current_channel, current_volume);
 		Mix_SetPanning(current_channel, 255 - current_pan, current_pan);
 	
 		sound_ref->fadein_play(current_channel, loop, milliseconds);
+	
+		if (parked) // Starting playback unpauses the channel
+		{
+			Mix_Pause(current_channel);
+		}
+	}
+	
+	
+	
+	void sound_reference::park()
+	{
+		current_volume = 0;
+		last_distance = UINT_MAX; // Forces volume recalculation once audible again
+	
+		if (type == LOOPED) // Pause the channel once, so that it isn't mixed, then skip recalculation until it's audible again - it carries on from where it was
+		{
+			parked = true;
+			Mix_Volume(current_channel, 0); // In case resume_all_sounds unpauses it
+			Mix_Pause(current_channel);
+			return;
+		}
+	
+		// A one-shot or repeated sound would otherwise hold its channel, and carry on long after it should have finished - stop it, and free the channel:
+		Mix_HaltChannel(current_channel);
+		sound_manager->return_channel(current_channel);
+		current_channel = -2;
+		fading_out = false;
+	
+		if (type == ONE_SHOT)
+		{
+			playing = false;
+			return;
+		}
+	
+		// Repeated - wait for the next repetition without a channel, see update():
+		delaying = true;
+		delay_remaining = between_delay;
+	
+		if (delay_random != 0) // to avoid modulo by zero
+		{
+			delay_remaining += rand_within(delay_random);
+		}
 	}
 	
 	
@@ -498,11 +558,24 @@ namespace plf
 		x2 *= x2;
 		double y2 = static_cast<double>(y - current_sound_center.y);
 		y2 *= y2;
+		const double audibility_radius = static_cast<double>(sound_manager->get_audibility_radius());
+		
+		if (x2 + y2 >= audibility_radius * audibility_radius) // Out of earshot
+		{
+			if (!parked)
+			{
+				park();
+			}
+	
+			return;
+		}
+		
+		const bool unparking = parked;
+		parked = false;
 		unsigned int distance = static_cast<unsigned int>(std::sqrt(x2 + y2));
 		
 		if (distance != last_distance) // Recalculate volume:
 		{
-			double audibility_radius = sound_manager->get_audibility_radius();
 			current_volume = static_cast<Uint8> (((audibility_radius - distance) / audibility_radius) * 128);
 			last_distance = distance;
 	
@@ -533,11 +606,16 @@ namespace plf
 	
 			Mix_SetPanning(current_channel, 255 - current_pan, current_pan);
 		}
+	
+		if (unparking && !paused) // Volume and pan are set - carry on from where it was parked
+		{
+			Mix_Resume(current_channel);
+		}
 	}
 	
 	
 	
-	int sound_reference::update(const unsigned int delta_time, const int x, const int y)
+	int sound_reference::update(const double delta_time, const int x, const int y)
 	{
 		if (!playing || current_channel == -2)
 		{
@@ -547,6 +625,28 @@ namespace plf
 				play (x, y);
 				return 0;
 			}
+	
+			if (playing && delaying && !paused) // Repeated sound which was parked out of earshot - count down to its next repetition without a channel
+			{
+				delay_remaining -= delta_time;
+	
+				if (delay_remaining < 0)
+				{
+					play(x, y); // Parks again, restarting the delay, if it's still out of earshot
+	
+					if (current_channel != -2)
+					{
+						delay_remaining += between_delay;
+	
+						if (delay_random != 0) // to avoid modulo by zero
+						{
+							delay_remaining += rand_within(delay_random);
+						}
+					}
+				}
+	
+				return 0;
+			}
 			
 			return -1;
 		}
@@ -625,7 +725,7 @@ namespace plf
 	
 	void sound_reference::resume()
 	{
-		if (paused && current_channel != -2)
+		if (paused && current_channel != -2 && !parked) // A parked channel is resumed once it's audible again
 		{
 			Mix_Resume(current_channel);
 		}
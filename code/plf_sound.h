@@ -112,7 +112,7 @@ namespace plf
 	
 		int current_channel; // -2 means no channel assigned
 		SOUND_REFERENCE_TYPE type;
-		int delay_remaining;
+		double delay_remaining; // In (fractional) milliseconds
 		unsigned int initial_delay; // Delay before playing in ms
 		unsigned int between_delay; // For repeated sounds, delay between playbacks
 		unsigned int delay_random; // For repeated sounds, random delay between playbacks - or before playbacks - adds a randomised ms of up to this number to the between_delay
@@ -121,11 +121,13 @@ namespace plf
 			 loop, // class instance is looping (optimisation to bool of the SOUND_REFERENCE_TYPE, compares once instead of each time sound is played)
 			 delaying, // class instance is currently delaying before playing the sound
 			 fading_out, // class instance is currently playing, but fading out
-			 started;  // class instance has or has not been played yet (at least once)
+			 started,  // class instance has or has not been played yet (at least once)
+			 parked; // looped class instance is beyond the sound manager's audibility_radius - channel is paused and volume/pan are not recalculated. Non-looped instances are stopped instead
 		Uint8 current_volume, // max volume = 127
 			current_pan; // centre = 127
 	
 		void set_volume_and_pan();
+		void park(); // Out of earshot - pause a looped sound, stop any other and free its channel
 		void recalculate_volume_and_pan(int x, int y);
 	public:
 		sound_reference();
@@ -134,7 +136,7 @@ namespace plf
 		~sound_reference();
 		void play(const int x, const int y);
 		void fadein_play(const int x, const int y, const unsigned int milliseconds);
-		int update(const unsigned int delta_time, const int x, const int y); // Returns 20 when sound finished
+		int update(const double delta_time, const int x, const int y); // Returns 20 when sound finished. delta_time is in (fractional) milliseconds
 		void fadeout(const unsigned int milliseconds);
 		void pause();
 		void resume();
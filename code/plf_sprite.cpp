@@ -1,6 +1,8 @@
 #include <cstdio>
 #include <cassert>
 #include <vector>
+#include <algorithm> // std::lower_bound, std::swap, std::sort
+#include <cmath> // ceil
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
@@ -18,14 +20,18 @@ namespace plf
 
 	sprite::sprite(plf::texture_manager *_texture_manager, bool _loop, HORIZONTAL_ALIGNMENT _horizontal_alignment, VERTICAL_ALIGNMENT _vertical_alignment):
 		texture_manager(_texture_manager),
-		center(NULL),
 		total_sprite_time(0),
+		uniform_frame_time(0),
+		timings_version(0),
 		base_width(0),
 		base_height(0),
 		horizontal_alignment(_horizontal_alignment),
 		vertical_alignment(_vertical_alignment),
+		last_used_frame(0),
 		loop(_loop),
-		has_per_frame_collision_blocks(false)
+		has_per_frame_collision_blocks(false),
+		evictable(true),
+		evicted(false)
 	{
 		assert(texture_manager != NULL);
 	}
@@ -38,19 +44,17 @@ namespace plf
 		{
 			for(std::vector<frame>::iterator frame_iterator = frames.begin(); frame_iterator != frames.end(); ++frame_iterator)	
 			{
-				if (!(frame_iterator->self_added))
+				if (!(frame_iterator->self_added) && !(frame_iterator->shared_texture))
 				{
 					delete frame_iterator->texture;
 				}
 			}
 		}
-		
-		delete center;
 	}
 	
 	
 	
-	int sprite::draw(unsigned int &current_sprite_time, const unsigned int delta_time, int x, int y, const double size, const bool flip_horizontal, bool flip_vertical, double angle, const Uint8 transparency, rgb *colormod)
+	int sprite::draw(double &current_sprite_time, const double delta_time, int x, int y, const double size, const bool flip_horizontal, bool flip_vertical, double angle, const Uint8 transparency, rgb *colormod)
 	{
 		if (transparency == 0)
 		{
@@ -66,6 +70,8 @@ namespace plf
 		{
 			return -1; // quit
 		}
+	
+		mark_used();
 		
 		std::vector<frame>::iterator current_frame = frames.begin();
 		int return_value = 0;
@@ -79,7 +85,7 @@ namespace plf
 			{
 				if (loop)
 				{
-					current_sprite_time = fast_mod(current_sprite_time, total_sprite_time); // removes all full loops of sprite animation
+					current_sprite_time = fast_mod(current_sprite_time, static_cast<double>(total_sprite_time)); // removes all full loops of sprite animation
 				}
 				else
 				{
@@ -92,354 +98,421 @@ namespace plf
 	
 			if (return_value != 20)
 			{
-				unsigned int frame_timing = 0;
-				
-				for(; current_frame != frames.end(); ++current_frame)
-				{
-					frame_timing += current_frame->milliseconds;
-	
-					if (frame_timing >= current_sprite_time)
-					{
-						break;
-					}
-				}
+				double remainder;
+				current_frame += lookup_frame(current_sprite_time, remainder);
 			}
 		}
 	
-		HORIZONTAL_ALIGNMENT temp_horizontal_alignment = horizontal_alignment;
-		VERTICAL_ALIGNMENT temp_vertical_alignment = vertical_alignment;
+		draw_with_descriptor(*current_frame, x, y, size, flip_horizontal, flip_vertical, angle, transparency, colormod);
+		return return_value; // return the current sprite time to the entity
+	}
+	
+	
+	
+	int sprite::draw_frame(const unsigned int frame_number, int x, int y, const double size, const bool flip_horizontal, const bool flip_vertical, const double angle, const Uint8 transparency, rgb *colormod)
+	{
+		assert(frames.size() != 0);
+		assert(frame_number < frames.size());
+		assert(size > 0);
 		
-		SDL_RendererFlip flip = SDL_FLIP_NONE;
+		mark_used();
+		return draw_with_descriptor(frames[frame_number], x, y, size, flip_horizontal, flip_vertical, angle, transparency, colormod);
+	}
+	
+	
+	
+	int sprite::update_frame(unsigned int &current_frame_number, double &current_sprite_time, double delta, double &frame_time_remainder)
+	{
+		const unsigned int number_of_frames = static_cast<unsigned int>(frames.size());
+		assert(number_of_frames != 0); // No frames loaded
 		
-		if (flip_horizontal)
+		if (number_of_frames == 1) // Single-frame animation is inherently non-looping, end of frame
 		{
-			flip = SDL_FLIP_HORIZONTAL;
-	
-			if (temp_horizontal_alignment == ALIGN_LEFT)
-			{
-				temp_horizontal_alignment = ALIGN_RIGHT;
-			}
-			else if (temp_horizontal_alignment == ALIGN_RIGHT)
-			{
-				temp_horizontal_alignment = ALIGN_LEFT;
-			}
+			return 21; // Indicate single-frame animation
 		}
 		
-		if (flip_vertical)
+		if (current_frame_number >= number_of_frames) // This shouldn't happen unless the user removes frames from the sprite in-game
 		{
-			flip = SDL_RendererFlip(flip | SDL_FLIP_VERTICAL);
-	
-			if (temp_vertical_alignment == ALIGN_TOP)
-			{
-				temp_vertical_alignment = ALIGN_BOTTOM;
-			}
-			else if (temp_vertical_alignment == ALIGN_BOTTOM)
-			{
-				temp_vertical_alignment = ALIGN_TOP;
-			}
+			current_frame_number = number_of_frames - 1; // Set equal to final frame
 		}
 		
-	
-		center = NULL;
-		
-		// Adjust positioning and rotation centre to accomodate changed frame size and horizontal_alignment:
-		if (current_frame->adjust_x != 0 || current_frame->adjust_y != 0)
+		if (delta <= frame_time_remainder) // Stay on current frame, reduce remainder
 		{
-			// Adjust (potential) rotation center:
-			center = new SDL_Point;
+			current_sprite_time += delta;
+			frame_time_remainder -= delta;
+			return 0;
+		}
+		
 	
-			if (temp_horizontal_alignment == ALIGN_LEFT)
-			{
-				center->x = base_width / 2;
-			}
-			else if (temp_horizontal_alignment == ALIGN_RIGHT)
-			{
-				x += current_frame->adjust_x;
-				center->x = (base_width / 2) - current_frame->adjust_x;
-			}
-			else if (temp_horizontal_alignment == ALIGN_CENTER)
-			{
-				x += (current_frame->adjust_x / 2);
-				center->x = current_frame->width / 2;
-			}
-			else
-			{
-				center->x = 0;
-			}
+		// ie. If not a static 1-frame sprite, Choose frame based on current time:
+		current_sprite_time += delta;
 	
-			if (temp_vertical_alignment == ALIGN_TOP)
-			{
-				center->y = base_height / 2;
-			}
-			else if (temp_vertical_alignment == ALIGN_BOTTOM)
-			{
-				y += current_frame->adjust_y;
-				center->y = (base_height / 2) - current_frame->adjust_y;
-			}
-			else if (temp_vertical_alignment == ALIGN_MIDDLE)
+		if (current_sprite_time >= total_sprite_time) // time elapsed since last sprite display is greater than total animation loop time
+		{
+			if (loop)
 			{
-				y += (current_frame->adjust_y / 2);
-				center->y = current_frame->height / 2;
+				current_sprite_time = fast_mod(current_sprite_time, static_cast<double>(total_sprite_time)); // removes all full loops of sprite animation
+				current_frame_number = lookup_frame(current_sprite_time, frame_time_remainder);
+				return 2; // Indicates it has looped
 			}
 			else
 			{
-				center->y = 0;
+				current_frame_number = number_of_frames - 1;
+				frame_time_remainder = (frames.begin() + current_frame_number)->milliseconds;
+				current_sprite_time = total_sprite_time - frame_time_remainder; // Current_sprite_time is end_frame
+				return 20; // Indicates end-of-sprite.
 			}
-	
-			center->x += x;
-			center->y += y;
 		}
 	
-		current_frame->texture->draw(x, y, size, angle, center, flip, transparency, colormod);
 	
-		delete center;
-		return return_value; // return the current sprite time to the entity
+		// Progress to subsequent frame(s) - current_sprite_time is within the animation, as established above:
+		current_frame_number = lookup_frame(current_sprite_time, frame_time_remainder);
+		return 0;
 	}
 	
 	
 	
-	int sprite::draw_frame(const unsigned int frame_number, int x, int y, const double size, const bool flip_horizontal, const bool flip_vertical, const double angle, const Uint8 transparency, rgb *colormod)
+	int sprite::find_frame(double current_sprite_time, unsigned int &current_frame_number, double &remainder)
 	{
-		assert(frames.size() != 0);
-		assert(frame_number < frames.size());
-		assert(size > 0);
-		
-		std::vector<frame>::iterator current_frame = frames.begin() + frame_number;
+		if (frames.empty() || total_sprite_time == 0)
+		{
+			return -1; // Could not find frame
+		}
 		
-		SDL_RendererFlip flip = SDL_FLIP_NONE;
+		if (current_sprite_time > total_sprite_time)
+		{
+			current_sprite_time = fast_mod(current_sprite_time, static_cast<double>(total_sprite_time)); // removes all full loops of sprite animation
+		}
 		
-		if (flip_horizontal)
+		current_frame_number = lookup_frame(current_sprite_time, remainder);
+		return 0;
+	}
+	
+	
+	
+	unsigned int sprite::lookup_frame(const double sprite_time, double &remainder)
+	{
+		const unsigned int number_of_frames = static_cast<unsigned int>(frame_end_times.size());
+		unsigned int frame_number;
+	
+		if (uniform_frame_time != 0) // eg. add_frames_from_tile - frame is a direct division
 		{
-			flip = SDL_FLIP_HORIZONTAL;
+			frame_number = (sprite_time <= 0) ? 0 : static_cast<unsigned int>(std::ceil(sprite_time / static_cast<double>(uniform_frame_time))) - 1;
 	
-			if (horizontal_alignment == ALIGN_LEFT)
-			{
-				horizontal_alignment = ALIGN_RIGHT;
-			}
-			else if (horizontal_alignment == ALIGN_RIGHT)
+			if (frame_number >= number_of_frames)
 			{
-				horizontal_alignment = ALIGN_LEFT;
+				frame_number = number_of_frames - 1;
 			}
 		}
-		
-		if (flip_vertical)
+		else // First frame which ends at or after sprite_time:
 		{
-			flip = SDL_RendererFlip(flip | SDL_FLIP_VERTICAL);
+			frame_number = static_cast<unsigned int>(std::lower_bound(frame_end_times.begin(), frame_end_times.end(), sprite_time) - frame_end_times.begin());
 	
-			if (vertical_alignment == ALIGN_TOP)
+			if (frame_number == number_of_frames)
 			{
-				vertical_alignment = ALIGN_BOTTOM;
-			}
-			else if (vertical_alignment == ALIGN_BOTTOM)
-			{
-				vertical_alignment = ALIGN_TOP;
+				frame_number = number_of_frames - 1;
 			}
 		}
-		
 	
-		center = NULL;
-		
-		// Adjust positioning and rotation centre to accomodate changed frame size and horizontal_alignment:
-		if (current_frame->adjust_x != 0 || current_frame->adjust_y != 0)
+		remainder = static_cast<double>(frame_end_times[frame_number]) - sprite_time;
+		return frame_number;
+	}
+	
+	
+	
+	void sprite::update_timings()
+	{
+		frame_end_times.resize(frames.size());
+		total_sprite_time = 0;
+		uniform_frame_time = (frames.empty()) ? 0 : frames.front().milliseconds;
+		++timings_version;
+	
+		std::vector<unsigned int>::iterator end_time = frame_end_times.begin();
+	
+		for (std::vector<frame>::iterator frame_iterator = frames.begin(); frame_iterator != frames.end(); ++frame_iterator, ++end_time)
 		{
-			// Adjust (potential) rotation center:
-			center = new SDL_Point;
+			total_sprite_time += frame_iterator->milliseconds;
+			*end_time = total_sprite_time;
 	
-			if (horizontal_alignment == ALIGN_LEFT)
+			if (frame_iterator->milliseconds != uniform_frame_time)
 			{
-				center->x = base_width / 2;
+				uniform_frame_time = 0;
 			}
-			else if (horizontal_alignment == ALIGN_RIGHT)
+		}
+	}
+	
+	
+	
+	void sprite::set_frame_geometry(frame &new_frame)
+	{
+		last_used_frame = texture_manager->get_atlas_manager()->get_frame_number(); // New or changed frames count as used, so that they aren't the first to be evicted before they've been drawn
+	
+		if (&new_frame == &(frames.front()) && (base_width != static_cast<unsigned int>(new_frame.width) || base_height != static_cast<unsigned int>(new_frame.height))) // If this is the first frame, set the base width and height
+		{
+			base_width = new_frame.width;
+			base_height = new_frame.height;
+	
+			// The other frames' adjustments and descriptors are relative to the base dimensions:
+			for (std::vector<frame>::iterator frame_iterator = frames.begin() + 1; frame_iterator != frames.end(); ++frame_iterator)
 			{
-				x += current_frame->adjust_x;
-				center->x = (base_width / 2) - current_frame->adjust_x;
+				set_frame_geometry(*frame_iterator);
 			}
-			else if (horizontal_alignment == ALIGN_CENTER)
+		}
+	
+		new_frame.adjust_x = base_width - new_frame.width;
+		new_frame.adjust_y = base_height - new_frame.height;
+	
+		if (new_frame.stored_area.w == 0) // Not trimmed
+		{
+			new_frame.stored_area.x = new_frame.stored_area.y = 0;
+			new_frame.stored_area.w = new_frame.width;
+			new_frame.stored_area.h = new_frame.height;
+		}
+	
+		const bool trimmed = (new_frame.stored_area.w != new_frame.width || new_frame.stored_area.h != new_frame.height);
+	
+		for (unsigned int flip = 0; flip != 4; ++flip)
+		{
+			frame_descriptor &descriptor = new_frame.descriptors[flip];
+			descriptor.offset_x = descriptor.offset_y = 0;
+			descriptor.center.x = descriptor.center.y = 0;
+			descriptor.has_center = (new_frame.adjust_x != 0 || new_frame.adjust_y != 0 || trimmed);
+	
+			if (!descriptor.has_center)
 			{
-				x += (current_frame->adjust_x / 2);
-				center->x = current_frame->width / 2;
+				continue;
 			}
-			else
+	
+			// Flipping mirrors the alignment:
+			HORIZONTAL_ALIGNMENT flipped_horizontal_alignment = horizontal_alignment;
+			VERTICAL_ALIGNMENT flipped_vertical_alignment = vertical_alignment;
+	
+			if (flip & SDL_FLIP_HORIZONTAL)
 			{
-				center->x = 0;
+				if (flipped_horizontal_alignment == ALIGN_LEFT)
+				{
+					flipped_horizontal_alignment = ALIGN_RIGHT;
+				}
+				else if (flipped_horizontal_alignment == ALIGN_RIGHT)
+				{
+					flipped_horizontal_alignment = ALIGN_LEFT;
+				}
 			}
 	
-			if (vertical_alignment == ALIGN_TOP)
+			if (flip & SDL_FLIP_VERTICAL)
 			{
-				center->y = base_height / 2;
+				if (flipped_vertical_alignment == ALIGN_TOP)
+				{
+					flipped_vertical_alignment = ALIGN_BOTTOM;
+				}
+				else if (flipped_vertical_alignment == ALIGN_BOTTOM)
+				{
+					flipped_vertical_alignment = ALIGN_TOP;
+				}
 			}
-			else if (vertical_alignment == ALIGN_BOTTOM)
+	
+			// Adjust positioning and rotation centre to accomodate changed frame size and alignment:
+			switch (flipped_horizontal_alignment)
 			{
-				y += current_frame->adjust_y;
-				center->y = (base_height / 2) - current_frame->adjust_y;
+				case ALIGN_LEFT:
+					descriptor.center.x = base_width / 2;
+					break;
+				case ALIGN_RIGHT:
+					descriptor.offset_x = new_frame.adjust_x;
+					descriptor.center.x = (base_width / 2) - new_frame.adjust_x;
+					break;
+				case ALIGN_CENTER:
+					descriptor.offset_x = new_frame.adjust_x / 2;
+					descriptor.center.x = new_frame.width / 2;
+					break;
 			}
-			else if (vertical_alignment == ALIGN_MIDDLE)
+	
+			switch (flipped_vertical_alignment)
 			{
-				y += (current_frame->adjust_y / 2);
-				center->y = current_frame->height / 2;
+				case ALIGN_TOP:
+					descriptor.center.y = base_height / 2;
+					break;
+				case ALIGN_BOTTOM:
+					descriptor.offset_y = new_frame.adjust_y;
+					descriptor.center.y = (base_height / 2) - new_frame.adjust_y;
+					break;
+				case ALIGN_MIDDLE:
+					descriptor.offset_y = new_frame.adjust_y / 2;
+					descriptor.center.y = new_frame.height / 2;
+					break;
 			}
-			else
+	
+			if (trimmed)
 			{
-				center->y = 0;
+				// Only the stored area is drawn - move it to its place within the frame (mirrored by flipping), keeping the rotation centre where it was:
+				const int stored_x = (flip & SDL_FLIP_HORIZONTAL) ? new_frame.width - (new_frame.stored_area.x + new_frame.stored_area.w) : new_frame.stored_area.x;
+				const int stored_y = (flip & SDL_FLIP_VERTICAL) ? new_frame.height - (new_frame.stored_area.y + new_frame.stored_area.h) : new_frame.stored_area.y;
+				descriptor.offset_x += stored_x;
+				descriptor.offset_y += stored_y;
+				descriptor.center.x -= stored_x;
+				descriptor.center.y -= stored_y;
 			}
-	
-			center->x += x;
-			center->y += y;
 		}
+	}
 	
-		current_frame->texture->draw(x, y, size, angle, center, flip, transparency, colormod);
-		
-		delete center;
-		return 0;
+	
+	
+	plf::texture * sprite::add_trimmed_image(frame &new_frame, SDL_Surface *surface, const SDL_Rect &area)
+	{
+		new_frame.width = area.w;
+		new_frame.height = area.h;
+		new_frame.source_area = area;
+		new_frame.stored_area = get_visible_bounds(surface, area);
+		plf::texture *trimmed_texture = texture_manager->add_image(surface, &(new_frame.stored_area));
+		new_frame.stored_area.x -= area.x;
+		new_frame.stored_area.y -= area.y;
+		return trimmed_texture;
 	}
 	
 	
 	
-	int sprite::update_frame(unsigned int &current_frame_number, unsigned int &current_sprite_time, int delta, unsigned int &frame_time_remainder)
+	void sprite::set_frame_sources(const unsigned int first_frame, const std::string &filename)
 	{
-		const unsigned int number_of_frames = static_cast<unsigned int>(frames.size());
-		assert(number_of_frames != 0); // No frames loaded
-		
-		if (number_of_frames == 1) // Single-frame animation is inherently non-looping, end of frame
+		for (std::vector<frame>::iterator frame_iterator = frames.begin() + first_frame; frame_iterator != frames.end(); ++frame_iterator)
 		{
-			return 21; // Indicate single-frame animation
-		}
-		
-		if (current_frame_number >= number_of_frames) // This shouldn't happen unless the user removes frames from the sprite in-game
-		{
-			current_frame_number = number_of_frames - 1; // Set equal to final frame
-		}
-		
-		if (delta <= static_cast<int>(frame_time_remainder)) // Stay on current frame, reduce remainder
-		{
-			current_sprite_time += delta;
-			frame_time_remainder -= delta;
-			return 0;
+			frame_iterator->source_filename = filename;
 		}
-		
-	
-		// ie. If not a static 1-frame sprite, Choose frame based on current time:
-		current_sprite_time += delta;
+	}
 	
-		if (current_sprite_time >= total_sprite_time) // time elapsed since last sprite display is greater than total animation loop time
-		{
-			if (loop)
-			{
-				unsigned int frame_timing = 0;
-				current_sprite_time = fast_mod(current_sprite_time, total_sprite_time);; // removes all full loops of sprite animation
-				current_frame_number = 0; // Reset frame back to beginning frame
-				std::vector<frame>::iterator current_frame = frames.begin();
 	
-				for(; current_frame_number != number_of_frames; ++current_frame_number)
-				{
-					frame_timing += current_frame->milliseconds;
 	
-					if (frame_timing >= current_sprite_time)
-					{
-						frame_time_remainder = frame_timing - current_sprite_time;
-						return 2; // Indicates it has looped
-					}
-					
-					++current_frame;
-				}
-			}
-			else
-			{
-				current_frame_number = number_of_frames - 1;
-				frame_time_remainder = (frames.begin() + current_frame_number)->milliseconds;
-				current_sprite_time = total_sprite_time - frame_time_remainder; // Current_sprite_time is end_frame
-				return 20; // Indicates end-of-sprite.
-			}
+	bool sprite::can_evict()
+	{
+		if (!evictable || evicted || frames.empty())
+		{
+			return false;
 		}
 	
-	
-		// Progress to subsequent frame(s), remove remainder of this frame from delta
-		delta -= frame_time_remainder; 
-		++current_frame_number; // If next frame was already end, current_sprite_time would've been over total_sprite_time as established above.
-		std::vector<frame>::iterator current_frame = frames.begin() + current_frame_number;
-		
-		for(; current_frame_number != number_of_frames; ++current_frame_number)
+		for (std::vector<frame>::iterator frame_iterator = frames.begin(); frame_iterator != frames.end(); ++frame_iterator)
 		{
-			delta -= current_frame->milliseconds;
-	
-			if (delta < 0)
+			if (frame_iterator->source_filename.empty() || frame_iterator->shared_texture)
 			{
-				frame_time_remainder = -delta;
-				return 0;
+				return false;
 			}
-			
-			++current_frame;
 		}
-		
-		std::clog << "plf::sprite update function Warning: Update function reached end without normal terminating conditions - something is wrong in code." << std::endl;
-		return 0; // Not strictly necessary as all cases should be covered in above return statements
+	
+		return true;
 	}
 	
 	
 	
-	int sprite::find_frame(unsigned int current_sprite_time, unsigned int &current_frame_number, unsigned int &remainder)
+	void sprite::evict()
 	{
-		const unsigned int number_of_frames = static_cast<unsigned int>(frames.size());
-		unsigned int frame_timing = 0;
-		
-		if (current_sprite_time > total_sprite_time)
+		assert(can_evict());
+	
+		for (std::vector<frame>::iterator frame_iterator = frames.begin(); frame_iterator != frames.end(); ++frame_iterator)
 		{
-			current_sprite_time = fast_mod(current_sprite_time, total_sprite_time); // removes all full loops of sprite animation
+			delete frame_iterator->texture;
+			frame_iterator->texture = NULL;
 		}
-		
-		current_frame_number = 0; // Reset frame back to beginning frame
 	
-		for(std::vector<frame>::iterator current_frame = frames.begin(); current_frame_number != number_of_frames; ++current_frame_number)
+		evicted = true;
+	}
+	
+	
+	
+	void sprite::reload()
+	{
+		SDL_Surface *image_surface = NULL;
+		const std::string *loaded_filename = NULL;
+		texture_manager->begin_uploads(); // Upload all frames together
+	
+		for (std::vector<frame>::iterator frame_iterator = frames.begin(); frame_iterator != frames.end(); ++frame_iterator)
 		{
-			frame_timing += current_frame->milliseconds;
+			if (frame_iterator->texture != NULL) // Added or changed since eviction - may not have a source file, or may not be owned by this sprite
+			{
+				continue;
+			}
+	
+			plf_fail_if (frame_iterator->source_filename.empty(), "plf::sprite reload Error: evicted frame has no source file. ");
 	
-			if (frame_timing >= current_sprite_time)
+			// Consecutive frames are usually from the same file, eg. a tile sheet:
+			if (loaded_filename == NULL || *loaded_filename != frame_iterator->source_filename)
 			{
-				remainder = frame_timing - current_sprite_time;
-				return 0;
+				SDL_FreeSurface(image_surface);
+				image_surface = IMG_Load(frame_iterator->source_filename.c_str());
+				plf_fail_if (image_surface == NULL, "plf::sprite reload Error: Unable to load image file '" << frame_iterator->source_filename << "' to surface! ");
+	
+				if (SDL_ISPIXELFORMAT_INDEXED(image_surface->format->format))
+				{
+					// Convert once for all the frames in it, as add_frames_from_tile does:
+					SDL_Surface *converted_surface = SDL_ConvertSurfaceFormat(image_surface, texture_manager->get_surface_pixel_format(), 0);
+					plf_fail_if (converted_surface == NULL, "plf::sprite reload Error: Unable to convert palettized surface. ");
+					SDL_FreeSurface(image_surface);
+					image_surface = converted_surface;
+				}
+	
+				loaded_filename = &(frame_iterator->source_filename);
 			}
-			
-			++current_frame;
+	
+			frame_iterator->texture = add_trimmed_image(*frame_iterator, image_surface, frame_iterator->source_area);
+			set_frame_geometry(*frame_iterator);
 		}
-		
-		return -1; // Could not find frame
+	
+		SDL_FreeSurface(image_surface);
+		texture_manager->end_uploads();
+		evicted = false;
+		texture_manager->get_atlas_manager()->count_reload();
 	}
 	
 	
 	
 	int sprite::add_frame(const char *image_filename, const unsigned int milliseconds)
 	{
-		frames.push_back(frame());
-		frame &frame_pointer = frames.back();
-		
 		SDL_Surface *image_surface = IMG_Load(image_filename);
 		
 		plf_fail_if (image_surface == NULL, "plf::sprite add_frame Error: Unable to load image file '" << image_filename << "' to surface! ");
 		
-		frame_pointer.width = image_surface->w;
-		frame_pointer.height = image_surface->h;
-		frame_pointer.texture = texture_manager->add_image(image_surface);
+		const unsigned int first_frame = static_cast<unsigned int>(frames.size());
+		add_frame(image_surface, milliseconds);
+		set_frame_sources(first_frame, image_filename);
+		SDL_FreeSurface(image_surface);
+		return 0;
+	}
 	
-		assert(frame_pointer.texture != NULL);
 	
-		SDL_FreeSurface(image_surface);
+	
+	int sprite::add_frame(SDL_Surface *image_surface, const unsigned int milliseconds)
+	{
+		assert(image_surface != NULL);
+	
+		frames.push_back(frame());
+		frame &frame_pointer = frames.back();
+		
+		const SDL_Rect image_area = {0, 0, image_surface->w, image_surface->h};
+		frame_pointer.texture = add_trimmed_image(frame_pointer, image_surface, image_area);
+	
+		assert(frame_pointer.texture != NULL);
 	
 		frame_pointer.milliseconds = milliseconds;
-		total_sprite_time += milliseconds;
 		
 		
-		if (frames.size() == 1) // If this is the first frame, set the base width and height
-		{
-			base_width = frame_pointer.width;
-			base_height = frame_pointer.height;
-			frame_pointer.adjust_x = 0;
-			frame_pointer.adjust_y = 0;
-		}
-		else
-		{
-			frame_pointer.adjust_x = base_width - frame_pointer.width;
-			frame_pointer.adjust_y = base_height - frame_pointer.height;
-		}
+		set_frame_geometry(frame_pointer);
+		update_timings();
+		
+		return 0;
+	}
+	
+	
+	
+	int sprite::add_frame(plf::texture *frame_texture, const int width, const int height, const unsigned int milliseconds)
+	{
+		assert(frame_texture != NULL);
+	
+		frames.push_back(frame());
+		frame &frame_pointer = frames.back();
+		frame_pointer.texture = frame_texture;
+		frame_pointer.width = width;
+		frame_pointer.height = height;
+		frame_pointer.milliseconds = milliseconds;
+	
+		set_frame_geometry(frame_pointer);
+		update_timings();
 		
 		return 0;
 	}
@@ -461,9 +534,9 @@ namespace plf
 			
 			plf_fail_if (image_surface == NULL, "plf::sprite add_frames Error: Unable to load image file '" << image_filename << "' to surface! ");
 			
-			frame_pointer.texture = texture_manager->add_image(image_surface);
-			frame_pointer.width = image_surface->w;
-			frame_pointer.height = image_surface->h;
+			const SDL_Rect image_area = {0, 0, image_surface->w, image_surface->h};
+			frame_pointer.texture = add_trimmed_image(frame_pointer, image_surface, image_area);
+			frame_pointer.source_filename = image_filename;
 	
 			SDL_FreeSurface(image_surface);
 			image_surface = NULL;
@@ -471,23 +544,12 @@ namespace plf
 			assert(frame_pointer.texture != NULL);
 	
 			frame_pointer.milliseconds = milliseconds_per_frame;
-			total_sprite_time += milliseconds_per_frame;
 	
-			if (frames.size() == 1) // If this is the first frame, set the base width and height
-			{
-				base_width = frame_pointer.width;
-				base_height = frame_pointer.height;
-				frame_pointer.adjust_x = 0;
-				frame_pointer.adjust_y = 0;
-			}
-			else
-			{
-				frame_pointer.adjust_x = base_width - frame_pointer.width;
-				frame_pointer.adjust_y = base_height - frame_pointer.height;
-			}
+			set_frame_geometry(frame_pointer);
 	
 		}
 		
+		update_timings();
 		return 0;
 	}
 	
@@ -498,53 +560,57 @@ namespace plf
 		SDL_Surface *tiles_surface = IMG_Load(image_filename);
 		plf_fail_if (tiles_surface == NULL, "plf::sprite add_frames_from_tile Error: Unable to load image file '" << image_filename << "' to surface. ");
 	
+		const unsigned int first_frame = static_cast<unsigned int>(frames.size());
+		add_frames_from_tile(tiles_surface, number_of_frames, frame_width, milliseconds);
+		set_frame_sources(first_frame, image_filename);
+		SDL_FreeSurface(tiles_surface);
+		return 0;
+	}
+	
+	
+	
+	int sprite::add_frames_from_tile(SDL_Surface *tiles_surface, const unsigned int number_of_frames, const unsigned int frame_width, const unsigned int milliseconds)
+	{
+		assert(tiles_surface != NULL);
+	
 		const int total_width = static_cast<int>(number_of_frames * frame_width);
 		plf_assert(tiles_surface->w == total_width, "Width of image not equal to specified number of frames * specified frame width.");
 	
-	    // Create a frame surface for copying the individual frames to:
-		SDL_Surface *frame_surface = create_surface(frame_width, tiles_surface->h);
+		SDL_Surface *sheet_surface = tiles_surface;
 	
-	    plf_fail_if (frame_surface == NULL, "plf::sprite add_frames_from_tile Error: could not create temporary frame_surface.");
+		if (SDL_ISPIXELFORMAT_INDEXED(tiles_surface->format->format))
+		{
+			// Palettized pixels can't be copied straight into the atlas - convert the whole sheet once, rather than once per frame:
+			sheet_surface = SDL_ConvertSurfaceFormat(tiles_surface, texture_manager->get_surface_pixel_format(), 0);
+			plf_fail_if (sheet_surface == NULL, "plf::sprite add_frames_from_tile Error: Unable to convert palettized surface. ");
+		}
 	
-		SDL_SetSurfaceBlendMode(tiles_surface, SDL_BLENDMODE_NONE);
-		SDL_SetSurfaceBlendMode(frame_surface, SDL_BLENDMODE_NONE);
-		
 		SDL_Rect source_rectangle = {0, 0, static_cast<int>(frame_width), tiles_surface->h};
+		texture_manager->begin_uploads(); // Upload all frames together
 	
 		for (; source_rectangle.x != total_width; source_rectangle.x += frame_width)
 		{
-			// Copy frame tile to it's own surface:
-			SDL_FillRect(frame_surface, NULL, 0x000000);
-			plf_fail_if (SDL_BlitSurface(tiles_surface, &source_rectangle, frame_surface, NULL) < 0, "plf::sprite add_frames_from_tile Error: Unable to blit surface to surface. x = " << source_rectangle.x << ". ");
-	
 			frames.push_back(frame());
 			frame &frame_pointer = frames.back();
 	
-			frame_pointer.texture = texture_manager->add_image(frame_surface);
+			// Each frame is copied straight from the sheet into the atlas:
+			frame_pointer.texture = add_trimmed_image(frame_pointer, sheet_surface, source_rectangle);
 	
 			plf_fail_if (frame_pointer.texture == NULL, "plf::sprite add_frames_from_tile Error: Unable to create texture from framed surface. ");
 	
-			frame_pointer.width = frame_width;
-			frame_pointer.height = source_rectangle.h;
 			frame_pointer.milliseconds = milliseconds;
-			total_sprite_time += milliseconds;
 	
-			if (frames.size() == 1) // If this is the first frame, set the base width and height
-			{
-				base_width = frame_pointer.width;
-				base_height = frame_pointer.height;
-				frame_pointer.adjust_x = 0;
-				frame_pointer.adjust_y = 0;
-			}
-			else
-			{
-				frame_pointer.adjust_x = base_width - frame_pointer.width;
-				frame_pointer.adjust_y = base_height - frame_pointer.height;
-			}
+			set_frame_geometry(frame_pointer);
 		}
 		
-		SDL_FreeSurface(tiles_surface);
-		SDL_FreeSurface(frame_surface);
+		texture_manager->end_uploads();
+	
+		if (sheet_surface != tiles_surface)
+		{
+			SDL_FreeSurface(sheet_surface);
+		}
+	
+		update_timings();
 		return 0;
 	}
 	
@@ -555,6 +621,7 @@ namespace plf
 		assert(frame_number <= frames.size()); // ie. frame number is not higher than size of number of frames in sprite
 	
 		(frames.begin() + frame_number - 1)->milliseconds = milliseconds;
+		update_timings();
 		return 0;
 	}
 	
@@ -574,20 +641,22 @@ namespace plf
 		SDL_Surface *image_surface = IMG_Load(image_filename);
 		plf_fail_if (image_surface == NULL, "plf::sprite change_frame_texture Error: Unable to load image file '" << image_filename << "' to surface! ");
 	
-		frame_pointer.texture = texture_manager->add_image(image_surface);
+		const SDL_Rect image_area = {0, 0, image_surface->w, image_surface->h};
+		frame_pointer.texture = add_trimmed_image(frame_pointer, image_surface, image_area);
 		plf_fail_if (frame_pointer.texture == NULL, "plf::sprite change_frame_texture Error: Unable to copy surface from '" << image_filename << "' to texture atlas! ");
+		frame_pointer.source_filename = image_filename;
 	
-		frame_pointer.width = image_surface->w;
-		frame_pointer.height = image_surface->h;
 		SDL_FreeSurface(image_surface);
+		set_frame_geometry(frame_pointer);
 	
 		// Success - Remove prior texture:
-		if (frame_pointer.self_added)
+		if (frame_pointer.self_added && !frame_pointer.shared_texture)
 		{
 			delete old_texture;
 		}
 	
 		frame_pointer.self_added = true;
+		frame_pointer.shared_texture = false;
 		return 0;
 	}
 	
@@ -600,18 +669,83 @@ namespace plf
 	
 		std::vector<frame>::iterator selected_frame = frames.begin() + frame_number - 1;
 	
-		if (selected_frame->self_added)
+		if (selected_frame->self_added && !selected_frame->shared_texture)
 		{
 			delete selected_frame->texture;
 		}
 	
 		frames.erase(selected_frame);
+	
+		if (frame_number == 1 && !frames.empty()) // The next frame becomes the base
+		{
+			set_frame_geometry(frames.front());
+		}
+	
+		update_timings();
 		
 		return 0;
 	}
 	
 	
 	
+	void sprite::set_placeholder(plf::texture *placeholder)
+	{
+		assert(placeholder != NULL);
+		assert(frames.empty());
+	
+		SDL_Texture *region_texture;
+		SDL_Rect region;
+		plf_fail_if (!placeholder->get_atlas_region(region_texture, region), "plf::sprite set_placeholder Error: placeholder must be a single atlas texture. ");
+	
+		frames.push_back(frame());
+		frame &frame_pointer = frames.back();
+		frame_pointer.texture = placeholder;
+		frame_pointer.width = region.w;
+		frame_pointer.height = region.h;
+		frame_pointer.milliseconds = 0;
+		frame_pointer.shared_texture = true;
+	
+		set_frame_geometry(frame_pointer);
+		update_timings();
+	}
+	
+	
+	
+	void sprite::append_frames(sprite &source)
+	{
+		assert(&source != this);
+	
+		// Remove the loading placeholder, which isn't owned by this sprite:
+		plf::texture *placeholder = texture_manager->get_placeholder();
+	
+		for (std::vector<frame>::iterator frame_iterator = frames.begin(); frame_iterator != frames.end(); )
+		{
+			if (frame_iterator->shared_texture && frame_iterator->texture == placeholder)
+			{
+				frame_iterator = frames.erase(frame_iterator);
+			}
+			else
+			{
+				++frame_iterator;
+			}
+		}
+	
+		frames.insert(frames.end(), source.frames.begin(), source.frames.end());
+		source.frames.clear(); // Textures are now owned by this sprite
+		source.update_timings();
+		has_per_frame_collision_blocks = has_per_frame_collision_blocks || source.has_per_frame_collision_blocks;
+	
+		// Descriptors depend on this sprite's alignment and base frame, which may have been the placeholder:
+		for (std::vector<frame>::iterator frame_iterator = frames.begin(); frame_iterator != frames.end(); ++frame_iterator)
+		{
+			set_frame_geometry(*frame_iterator);
+		}
+	
+		update_timings();
+	}
+	
+	
+	
 	int sprite::add_collision_block_to_frame(const unsigned int frame_number, const int x, const int y, const int w, const int h)
 	{
 		assert(frame_number <= frames.size()); // ie. frame number is not higher than size of number of frames in sprite
@@ -641,6 +775,23 @@ namespace plf
 	
 	
 	
+	bool sprite::is_opaque()
+	{
+		mark_used();
+	
+		for (std::vector<frame>::iterator frame_iterator = frames.begin(); frame_iterator != frames.end(); ++frame_iterator)
+		{
+			if (frame_iterator->stored_area.w != frame_iterator->width || frame_iterator->stored_area.h != frame_iterator->height || !(frame_iterator->texture->is_opaque())) // Trimmed frames had transparent borders
+			{
+				return false;
+			}
+		}
+	
+		return !(frames.empty());
+	}
+	
+	
+	
 	unsigned int sprite::get_frame_timing(const unsigned int frame_number)
 	{
 		assert(frame_number <= frames.size());
@@ -649,8 +800,28 @@ namespace plf
 	
 	
 	
+	bool sprite::get_frame_region(const unsigned int frame_number, SDL_Texture *&region_texture, SDL_Rect &region, SDL_Rect *frame_area)
+	{
+		assert(frame_number < frames.size());
+		mark_used();
+		const frame &selected_frame = *(frames.begin() + frame_number);
+	
+		if (frame_area != NULL)
+		{
+			frame_area->x = -(selected_frame.stored_area.x);
+			frame_area->y = -(selected_frame.stored_area.y);
+			frame_area->w = selected_frame.width;
+			frame_area->h = selected_frame.height;
+		}
+	
+		return selected_frame.texture->get_atlas_region(region_texture, region);
+	}
+	
+	
+	
 	sprite_manager::sprite_manager(plf::texture_manager *_texture_manager):
-		texture_manager(_texture_manager)
+		texture_manager(_texture_manager),
+		next_async_handle(0)
 	{
 		assert(texture_manager != NULL);
 	}
@@ -659,6 +830,20 @@ namespace plf
 	
 	sprite_manager::~sprite_manager()
 	{
+		// Discard unfinished loads:
+		for (std::deque<async_batch>::iterator batch_iterator = async_batches.begin(); batch_iterator != async_batches.end(); ++batch_iterator)
+		{
+			for (std::vector<batch_entry>::iterator entry_iterator = batch_iterator->entries.begin() + batch_iterator->next_entry; entry_iterator != batch_iterator->entries.end(); ++entry_iterator)
+			{
+				texture_manager->get_decoder()->cancel(entry_iterator->ticket);
+			}
+	
+			for (std::map<plf::sprite *, plf::sprite *>::iterator staging_iterator = batch_iterator->staging_sprites.begin(); staging_iterator != batch_iterator->staging_sprites.end(); ++staging_iterator)
+			{
+				delete staging_iterator->second;
+			}
+		}
+	
 		// Destroy Sprites:
 		for (std::map<std::string, sprite *>::iterator sprite_iterator = sprites.begin(); sprite_iterator != sprites.end(); ++sprite_iterator)
 		{
@@ -668,6 +853,246 @@ namespace plf
 	
 	
 	
+	void sprite_manager::queue_batch_entry(plf::sprite *sprite, const std::string &filename, const unsigned int number_of_frames, const unsigned int frame_width, const unsigned int milliseconds)
+	{
+		assert(sprite != NULL);
+	
+		batch.push_back(batch_entry());
+		batch_entry &new_entry = batch.back();
+		new_entry.sprite = sprite;
+		new_entry.filename = filename;
+		new_entry.ticket = texture_manager->get_decoder()->decode(filename);
+		new_entry.number_of_frames = number_of_frames;
+		new_entry.frame_width = frame_width;
+		new_entry.milliseconds = milliseconds;
+		new_entry.last_for_sprite = false;
+	}
+	
+	
+	
+	void sprite_manager::batch_add_frame(plf::sprite *sprite, const char *image_filename, const unsigned int milliseconds)
+	{
+		queue_batch_entry(sprite, image_filename, 0, 0, milliseconds);
+	}
+	
+	
+	
+	void sprite_manager::batch_add_frames(plf::sprite *sprite, const char *image_filename_fragment, const unsigned int number_of_frames, const unsigned int milliseconds_per_frame)
+	{
+		char image_filename [1024];
+	
+		for (unsigned int frame_number = 1; frame_number != number_of_frames + 1; ++frame_number)
+		{
+			sprintf(image_filename, "%s%u.png", image_filename_fragment, frame_number); // Same naming as sprite::add_frames
+			queue_batch_entry(sprite, image_filename, 0, 0, milliseconds_per_frame);
+		}
+	}
+	
+	
+	
+	void sprite_manager::batch_add_frames_from_tile(plf::sprite *sprite, const char *image_filename, const unsigned int number_of_frames, const unsigned int frame_width, const unsigned int milliseconds)
+	{
+		assert(number_of_frames != 0);
+		queue_batch_entry(sprite, image_filename, number_of_frames, frame_width, milliseconds);
+	}
+	
+	
+	
+	int sprite_manager::load_batch()
+	{
+		SDL_Surface *image_surface;
+		texture_manager->begin_uploads(); // Upload the whole batch together
+	
+		for (std::vector<batch_entry>::iterator entry_iterator = batch.begin(); entry_iterator != batch.end(); ++entry_iterator)
+		{
+			image_surface = texture_manager->get_decoder()->wait(entry_iterator->ticket);
+	
+			plf_fail_if (image_surface == NULL, "plf::sprite_manager load_batch Error: Unable to load image file '" << entry_iterator->filename << "' to surface! ");
+	
+			const unsigned int first_frame = entry_iterator->sprite->get_number_of_frames();
+	
+			if (entry_iterator->number_of_frames == 0)
+			{
+				entry_iterator->sprite->add_frame(image_surface, entry_iterator->milliseconds);
+			}
+			else
+			{
+				entry_iterator->sprite->add_frames_from_tile(image_surface, entry_iterator->number_of_frames, entry_iterator->frame_width, entry_iterator->milliseconds);
+			}
+	
+			entry_iterator->sprite->set_frame_sources(first_frame, entry_iterator->filename);
+			SDL_FreeSurface(image_surface);
+		}
+	
+		texture_manager->end_uploads();
+		batch.clear();
+		return 0;
+	}
+	
+	
+	
+	unsigned int sprite_manager::load_batch_async(load_callback callback, void *user_data)
+	{
+		async_batches.push_back(async_batch());
+		async_batch &new_batch = async_batches.back();
+		new_batch.entries.swap(batch);
+		new_batch.next_entry = 0;
+		new_batch.handle = next_async_handle++;
+		new_batch.callback = callback;
+		new_batch.user_data = user_data;
+	
+		// Mark the last entry for each sprite, working backwards, and create its staging sprite:
+		for (std::vector<batch_entry>::reverse_iterator entry_iterator = new_batch.entries.rbegin(); entry_iterator != new_batch.entries.rend(); ++entry_iterator)
+		{
+			plf::sprite *&staging_sprite = new_batch.staging_sprites[entry_iterator->sprite];
+	
+			if (staging_sprite == NULL)
+			{
+				staging_sprite = new plf::sprite(texture_manager, entry_iterator->sprite->is_looping(), entry_iterator->sprite->get_horizontal_alignment(), entry_iterator->sprite->get_vertical_alignment());
+				entry_iterator->last_for_sprite = true;
+	
+				if (!entry_iterator->sprite->has_frames())
+				{
+					entry_iterator->sprite->set_placeholder(texture_manager->get_placeholder());
+				}
+			}
+		}
+	
+		return new_batch.handle;
+	}
+	
+	
+	
+	void sprite_manager::update_async_loads(const unsigned int upload_bytes_budget, const double upload_milliseconds_budget)
+	{
+		const Uint64 start_time = SDL_GetPerformanceCounter();
+		const double counts_per_millisecond = static_cast<double>(SDL_GetPerformanceFrequency()) / 1000.0;
+		unsigned int uploaded_bytes = 0;
+		bool uploaded = false;
+		SDL_Surface *image_surface;
+		texture_manager->begin_uploads(); // Images uploaded this frame are staged, then uploaded together
+	
+		while (!async_batches.empty())
+		{
+			async_batch &current_batch = async_batches.front();
+	
+			for (; current_batch.next_entry != current_batch.entries.size(); ++current_batch.next_entry)
+			{
+				if (uploaded && (uploaded_bytes >= upload_bytes_budget || static_cast<double>(SDL_GetPerformanceCounter() - start_time) >= upload_milliseconds_budget * counts_per_millisecond))
+				{
+					texture_manager->end_uploads();
+					return; // Budget used up - carry on next frame
+				}
+	
+				batch_entry &entry = current_batch.entries[current_batch.next_entry];
+	
+				if (!texture_manager->get_decoder()->poll(entry.ticket, image_surface))
+				{
+					texture_manager->end_uploads();
+					return; // Not decoded yet - frames are uploaded in submission order
+				}
+	
+				plf::sprite *staging_sprite = current_batch.staging_sprites[entry.sprite];
+	
+				if (image_surface == NULL)
+				{
+					std::clog << "plf::sprite_manager update_async_loads error: unable to load image file '" << entry.filename << "' - frame skipped." << std::endl;
+				}
+				else
+				{
+					const unsigned int first_frame = staging_sprite->get_number_of_frames();
+	
+					if (entry.number_of_frames == 0)
+					{
+						staging_sprite->add_frame(image_surface, entry.milliseconds);
+					}
+					else
+					{
+						staging_sprite->add_frames_from_tile(image_surface, entry.number_of_frames, entry.frame_width, entry.milliseconds);
+					}
+	
+					staging_sprite->set_frame_sources(first_frame, entry.filename);
+					uploaded_bytes += static_cast<unsigned int>(image_surface->w * image_surface->h * 4);
+					uploaded = true;
+					SDL_FreeSurface(image_surface);
+				}
+	
+				if (entry.last_for_sprite)
+				{
+					if (staging_sprite->has_frames())
+					{
+						texture_manager->commit_uploads(); // Frames must be on their atlas textures before they can be drawn
+						entry.sprite->append_frames(*staging_sprite);
+					}
+	
+					delete staging_sprite; // Now empty
+					current_batch.staging_sprites.erase(entry.sprite);
+				}
+			}
+	
+			if (current_batch.callback != NULL)
+			{
+				current_batch.callback(current_batch.handle, current_batch.user_data);
+			}
+	
+			async_batches.pop_front();
+		}
+	
+		texture_manager->end_uploads();
+	}
+	
+	
+	
+	bool sprite_manager::is_loading(const unsigned int handle)
+	{
+		for (std::deque<async_batch>::iterator batch_iterator = async_batches.begin(); batch_iterator != async_batches.end(); ++batch_iterator)
+		{
+			if (batch_iterator->handle == handle)
+			{
+				return true;
+			}
+		}
+	
+		return false;
+	}
+	
+	
+	
+	void sprite_manager::update_residency()
+	{
+		plf::atlas_manager *atlas_manager = texture_manager->get_atlas_manager();
+		const unsigned int current_frame = atlas_manager->get_frame_number();
+		atlas_manager->advance_frame();
+	
+		if (!atlas_manager->is_over_memory_budget())
+		{
+			return;
+		}
+	
+		// Candidates by last drawn frame, oldest first - sprites drawn this frame are kept:
+		std::vector<std::pair<unsigned int, plf::sprite *> > candidates;
+	
+		for (std::map<std::string, sprite *>::iterator sprite_iterator = sprites.begin(); sprite_iterator != sprites.end(); ++sprite_iterator)
+		{
+			if (sprite_iterator->second->get_last_used_frame() != current_frame && sprite_iterator->second->can_evict())
+			{
+				candidates.push_back(std::pair<unsigned int, plf::sprite *>(sprite_iterator->second->get_last_used_frame(), sprite_iterator->second));
+			}
+		}
+	
+		std::sort(candidates.begin(), candidates.end());
+	
+		for (std::vector<std::pair<unsigned int, plf::sprite *> >::iterator candidate_iterator = candidates.begin(); candidate_iterator != candidates.end() && atlas_manager->is_over_memory_budget(); ++candidate_iterator)
+		{
+			candidate_iterator->second->evict();
+			atlas_manager->count_eviction();
+		}
+	
+		atlas_manager->release_empty_pages();
+	}
+	
+	
+	
 	sprite * sprite_manager::new_sprite(const std::string &id, const LOOPING looping, const HORIZONTAL_ALIGNMENT h_align, const VERTICAL_ALIGNMENT v_align)
 	{
 		plf::sprite *sprite = new plf::sprite(texture_manager, (looping == LOOP), h_align, v_align);
@@ -707,10 +1132,62 @@ namespace plf
 			return -1;
 		}
 		
+		cancel_loads(sprite_iterator->second); // Batches mustn't be left pointing at the deleted sprite
 		delete sprite_iterator->second;
 		sprites.erase(sprite_iterator);
 		return 0;
 	}
+	
+	
+	
+	void sprite_manager::cancel_loads(plf::sprite *sprite)
+	{
+		std::vector<batch_entry> kept_entries;
+	
+		for (std::vector<batch_entry>::iterator entry_iterator = batch.begin(); entry_iterator != batch.end(); ++entry_iterator)
+		{
+			if (entry_iterator->sprite == sprite)
+			{
+				texture_manager->get_decoder()->cancel(entry_iterator->ticket);
+			}
+			else
+			{
+				kept_entries.push_back(*entry_iterator);
+			}
+		}
+	
+		batch.swap(kept_entries);
+	
+		for (std::deque<async_batch>::iterator batch_iterator = async_batches.begin(); batch_iterator != async_batches.end(); ++batch_iterator)
+		{
+			std::map<plf::sprite *, plf::sprite *>::iterator staging_iterator = batch_iterator->staging_sprites.find(sprite);
+	
+			if (staging_iterator == batch_iterator->staging_sprites.end()) // Nothing left to load for this sprite in this batch
+			{
+				continue;
+			}
+	
+			delete staging_iterator->second;
+			batch_iterator->staging_sprites.erase(staging_iterator);
+	
+			// Entries before next_entry have already been uploaded, and aren't read again:
+			kept_entries.assign(batch_iterator->entries.begin(), batch_iterator->entries.begin() + batch_iterator->next_entry);
+	
+			for (std::vector<batch_entry>::iterator entry_iterator = batch_iterator->entries.begin() + batch_iterator->next_entry; entry_iterator != batch_iterator->entries.end(); ++entry_iterator)
+			{
+				if (entry_iterator->sprite == sprite)
+				{
+					texture_manager->get_decoder()->cancel(entry_iterator->ticket);
+				}
+				else
+				{
+					kept_entries.push_back(*entry_iterator);
+				}
+			}
+	
+			batch_iterator->entries.swap(kept_entries);
+		}
+	}
 
 
 }
@@ -2,7 +2,9 @@
 #define PLF_SPRITE_H
 
 #include <vector>
+#include <deque>
 #include <map>
+#include <string>
 
 #include <SDL2/SDL.h>
 
@@ -43,6 +45,14 @@ namespace plf
 	class sprite
 	{
 	private:
+		// Placement of a frame for one combination of flips - depends only on frame geometry and sprite alignment, so is computed when the frame is added:
+		struct frame_descriptor
+		{
+			int offset_x, offset_y; // Added to the draw position (scaled by size)
+			SDL_Point center; // Rotation center relative to the offset draw position (scaled by size)
+			bool has_center; // If false, texture's default center is used
+		};
+	
 		struct frame
 		{
 			std::vector<SDL_Rect> collision_blocks; // per-frame collision blocks (optional, not required)
@@ -50,47 +60,119 @@ namespace plf
 			unsigned int milliseconds;
 			int adjust_x, adjust_y; // These adjust the placement of the frame, when dealing with dissimilar frame geometries
 			int width, height;
+			SDL_Rect stored_area; // The part of the frame held in the texture, relative to the frame - fully transparent borders are trimmed off when frames are added. w == 0 means the whole frame (set by set_frame_geometry)
+			std::string source_filename; // Image file the frame was loaded from, for reloading after eviction - empty if it wasn't loaded from a file
+			SDL_Rect source_area; // Area of the image file holding the frame
+			frame_descriptor descriptors[4]; // Indexed by SDL_RendererFlip value: none, horizontal, vertical, both
 			bool self_added;
+			bool shared_texture; // Texture isn't owned by this sprite, eg. the loading placeholder
 		};
 	
 		// Note: frame numbers are from 1 upwards. unfortunately, vectors have array-like syntax (0 is first element)
 		// This affects implementation in the functions below.
 		std::vector <frame> frames;
+		std::vector <unsigned int> frame_end_times; // Prefix sums of frame timings - frame_end_times[n] == sum of milliseconds of frames 0 to n
 		plf::texture_manager *texture_manager;
-		SDL_Point *center;
 		unsigned int total_sprite_time; // The total amount of milliseconds taken by all frames of the sprite
+		unsigned int uniform_frame_time; // If all frames have the same timing, that timing, otherwise 0
+		unsigned int timings_version; // Incremented by update_timings, so that cached frame lookups (eg. animation_clock groups) can tell when they're stale
 		unsigned int base_width, base_height;
 		HORIZONTAL_ALIGNMENT horizontal_alignment;
 		VERTICAL_ALIGNMENT vertical_alignment;
+		unsigned int last_used_frame; // atlas_manager frame number when last drawn
 		bool loop;
 		bool has_per_frame_collision_blocks; // Ie. collision blocks are being stored per-frame rather than in the parent entity
+		bool evictable, evicted;
+	
+		friend class sprite_manager;
+	
+		void set_frame_geometry(frame &new_frame); // Set adjust_x/y relative to the base dimensions, and compute draw descriptors. Also stamps the sprite as used, without reloading it
+		plf::texture * add_trimmed_image(frame &new_frame, SDL_Surface *surface, const SDL_Rect &area); // Add area of surface to the atlas without its transparent borders, setting the frame's size, stored_area and source_area
+		void set_frame_sources(const unsigned int first_frame, const std::string &filename); // Record filename as the source of all frames from first_frame (0-based) onwards
+		void reload(); // Reload evicted frames' textures from their source files - frames added or changed since eviction already have textures, and are left alone
+	
+		inline void mark_used()
+		{
+			last_used_frame = texture_manager->get_atlas_manager()->get_frame_number();
+	
+			if (evicted)
+			{
+				reload();
+			}
+		};
+
+		void update_timings(); // Rebuild frame_end_times, total_sprite_time and uniform_frame_time - must be called whenever frames or frame timings change
+		unsigned int lookup_frame(const double sprite_time, double &remainder); // Index of the frame displayed at sprite_time (0 <= sprite_time <= total_sprite_time), and time left in that frame
+	
+		inline int draw_with_descriptor(frame &current_frame, int x, int y, const double size, const bool flip_horizontal, const bool flip_vertical, const double angle, const Uint8 transparency, rgb *colormod)
+		{
+			const unsigned int flip = (flip_horizontal ? SDL_FLIP_HORIZONTAL : 0) | (flip_vertical ? SDL_FLIP_VERTICAL : 0);
+			const frame_descriptor &descriptor = current_frame.descriptors[flip];
+	
+			if (!descriptor.has_center) // Most common scenario - frame is the same size as the base frame
+			{
+				return current_frame.texture->draw(x, y, size, angle, NULL, static_cast<SDL_RendererFlip>(flip), transparency, colormod);
+			}
+	
+			x += static_cast<int>(static_cast<double>(descriptor.offset_x) * size);
+			y += static_cast<int>(static_cast<double>(descriptor.offset_y) * size);
+			SDL_Point center = {x + static_cast<int>(static_cast<double>(descriptor.center.x) * size), y + static_cast<int>(static_cast<double>(descriptor.center.y) * size)};
+			return current_frame.texture->draw(x, y, size, angle, &center, static_cast<SDL_RendererFlip>(flip), transparency, colormod);
+		};
 	public:
 		sprite(plf::texture_manager *_texture_manager, bool _loop, HORIZONTAL_ALIGNMENT _horizontal_alignment, VERTICAL_ALIGNMENT _vertical_alignment);
 		~sprite();
 	
 		// Note: Returns new current_sprite_time, which is the measurement in milliseconds of how far along the animation is:
-		int draw(unsigned int &current_sprite_time, unsigned int delta_time, int x, int y, const double size = 1, const bool flip_horizontal = false, const bool flip_vertical = false, const double angle = 0, const Uint8 transparency = 255, rgb *colormod = NULL);
+		int draw(double &current_sprite_time, const double delta_time, int x, int y, const double size = 1, const bool flip_horizontal = false, const bool flip_vertical = false, const double angle = 0, const Uint8 transparency = 255, rgb *colormod = NULL);
 		int draw_frame(const unsigned int frame_number, int x, int y, const double size = 1, const bool flip_horizontal = false, const bool flip_vertical = false, const double angle = 0, const Uint8 transparency = 255, rgb *colormod = NULL);
-		int update_frame(unsigned int &current_frame_number, unsigned int &current_sprite_time, const int delta, unsigned int &frame_time_remainder); // Based on delta time that has passed, update the sprite to whatever frame it should currently be on. frame_time_remainder allows the entity which uses the sprite to hold the current 'sprite time', rather than the sprite itself.
-		int find_frame(const unsigned int current_sprite_time, unsigned int &current_frame_number, unsigned int &remainder);
+		int update_frame(unsigned int &current_frame_number, double &current_sprite_time, double delta, double &frame_time_remainder); // Based on delta time that has passed, update the sprite to whatever frame it should currently be on. frame_time_remainder allows the entity which uses the sprite to hold the current 'sprite time', rather than the sprite itself.
+		int find_frame(double current_sprite_time, unsigned int &current_frame_number, double &remainder);
 	
 		int add_frame(const char *image_filename, const unsigned int milliseconds);
 		int add_frames(const char *image_filename_fragment, const unsigned int number_of_frames, const unsigned int milliseconds_per_frame);
 		int add_frames_from_tile(const char *image_filename, const unsigned int number_of_frames, const unsigned int frame_width, const unsigned int milliseconds);
+		int add_frame(SDL_Surface *image_surface, const unsigned int milliseconds); // From an already-decoded image - the surface isn't freed
+		int add_frames_from_tile(SDL_Surface *tiles_surface, const unsigned int number_of_frames, const unsigned int frame_width, const unsigned int milliseconds); // ditto
+		int add_frame(plf::texture *frame_texture, const int width, const int height, const unsigned int milliseconds); // Add an already-created texture, eg. from a baked atlas - the sprite takes ownership of it
 		int add_collision_block_to_frame(const unsigned int frame_number, const int x, const int y, const int w, const int h);
 		void get_collision_blocks(const unsigned int frame_number, std::vector<SDL_Rect> &current_collision_blocks);
 		int change_frame_timing(const unsigned int frame_number, const unsigned int milliseconds);
 		int change_frame_texture(const char *image_filename, const unsigned int frame_number);
 		int remove_frame(const unsigned int frame_number);
 		void get_base_dimensions(int &width, int &height);
+		bool is_opaque(); // All frames have no transparent or semi-transparent pixels
 		unsigned int get_frame_timing(const unsigned int frame_number);
+		bool get_frame_region(const unsigned int frame_number, SDL_Texture *&region_texture, SDL_Rect &region, SDL_Rect *frame_area = NULL); // Atlas texture and location of the frame's image - false if the frame is a multitexture. frame_area receives the whole frame's area relative to region's top-left corner, which differs from {0, 0, region.w, region.h} if transparent borders were trimmed
+		inline plf::atlas_manager * get_atlas_manager() { return texture_manager->get_atlas_manager(); }; // Locations from get_frame_region are invalidated when its get_number_of_compactions() changes
+		unsigned int get_number_of_frames() { return static_cast<unsigned int>(frames.size()); };
 		bool has_collision_blocks() { return has_per_frame_collision_blocks; };
 		bool has_frames() { return !(frames.empty()); };
+		bool is_animated() { return frames.size() > 1; };
 		bool is_looping() { return loop; };
+		unsigned int get_total_time() { return total_sprite_time; };
+		unsigned int get_timings_version() { return timings_version; };
+		HORIZONTAL_ALIGNMENT get_horizontal_alignment() { return horizontal_alignment; };
+		VERTICAL_ALIGNMENT get_vertical_alignment() { return vertical_alignment; };
+	
+		// For asynchronous loading:
+		void set_placeholder(plf::texture *placeholder); // Give a sprite with no frames a single frame showing placeholder, which it doesn't take ownership of
+		void append_frames(sprite &source); // Move all of source's frames onto the end of this sprite's, replacing the loading placeholder if it has one. Source is left with no frames
+	
+		// Texture memory management - see atlas_manager::set_memory_budget. Evicted sprites keep their frame timings, sizes and collision blocks, and reload their textures from their image files the next time they're drawn or queried:
+		bool can_evict(); // All frames were loaded from image files, and eviction hasn't been disabled
+		void evict(); // Free all frames' textures
+		inline void set_evictable(const bool allow) { evictable = allow; }; // Tilemaps and particle emitters disable eviction of their sprites, as they keep atlas locations
+		inline bool is_evicted() { return evicted; };
+		inline unsigned int get_last_used_frame() { return last_used_frame; };
 	};
 	
 	
 	
+	typedef void (*load_callback)(const unsigned int handle, void *user_data); // Called on the main thread once an asynchronous batch has loaded
+	
+	
+	
 	class sprite_manager
 	{
 	private:
@@ -98,12 +180,59 @@ namespace plf
 		std::map<std::string, sprite *> sprites;
 	
 		plf::texture_manager *texture_manager;
+	
+		// Queued batch loads, in submission order:
+		struct batch_entry
+		{
+			plf::sprite *sprite;
+			std::string filename;
+			unsigned int ticket; // image_decoder ticket
+			unsigned int number_of_frames, frame_width; // number_of_frames == 0 for a single frame, otherwise a tile
+			unsigned int milliseconds;
+			bool last_for_sprite; // Asynchronous batches only - no later entry in the batch adds to this sprite
+		};
+	
+		std::vector<batch_entry> batch;
+	
+		// A batch being loaded by update_async_loads. Frames are added to a staging sprite per target, which is swapped in once all its frames are uploaded:
+		struct async_batch
+		{
+			std::vector<batch_entry> entries;
+			std::map<plf::sprite *, plf::sprite *> staging_sprites; // By target sprite
+			unsigned int next_entry, handle;
+			load_callback callback;
+			void *user_data;
+		};
+	
+		std::deque<async_batch> async_batches;
+		unsigned int next_async_handle;
+	
+		void queue_batch_entry(plf::sprite *sprite, const std::string &filename, const unsigned int number_of_frames, const unsigned int frame_width, const unsigned int milliseconds);
+		void cancel_loads(plf::sprite *sprite); // Remove sprite's unloaded entries from the pending batch and asynchronous batches, cancelling their decodes and deleting its staging sprites
 	public:
 		sprite_manager(plf::texture_manager *_texture_manager);
 		~sprite_manager();
+	
+		// Batch loading - the batch_ equivalents of the sprite add_frame functions start decoding their images on the texture_manager's decoder threads straight away. load_batch then adds the frames to their sprites (packing and uploading them to atlases) on this thread,
+		// in the order they were queued, so results are identical to calling the sprite functions directly:
+		void batch_add_frame(plf::sprite *sprite, const char *image_filename, const unsigned int milliseconds);
+		void batch_add_frames(plf::sprite *sprite, const char *image_filename_fragment, const unsigned int number_of_frames, const unsigned int milliseconds_per_frame);
+		void batch_add_frames_from_tile(plf::sprite *sprite, const char *image_filename, const unsigned int number_of_frames, const unsigned int frame_width, const unsigned int milliseconds);
+		int load_batch();
+	
+		// Asynchronous loading - returns immediately with a handle for the queued batch, and its images are decoded in the background. Sprites in the batch which have no frames show the texture_manager's placeholder until their frames are ready.
+		// update_async_loads must be called once per frame - it uploads decoded frames in submission order until either budget is used up (at least one image is uploaded per call), appends each sprite's frames (replacing its placeholder) once all are uploaded, and calls callback (if any) on this thread once the whole batch is loaded.
+		// Entities should be spawned from sprites after they've loaded if they need the sprite's dimensions, eg. for collisions:
+		unsigned int load_batch_async(load_callback callback = NULL, void *user_data = NULL);
+		void update_async_loads(const unsigned int upload_bytes_budget = 4194304, const double upload_milliseconds_budget = 2);
+		bool is_loading(const unsigned int handle);
+	
+		// Must be called once per frame, between frames (eg. after display_frame) - advances the atlas_manager's frame number and, if the atlas memory budget is exceeded, evicts sprites which weren't drawn this frame, least-recently-drawn first, until it isn't.
+		// Only sprites created by new_sprite are considered. Pages left empty are then freed:
+		void update_residency();
 		sprite * new_sprite(const std::string &id, const LOOPING loop = NO_LOOP, const HORIZONTAL_ALIGNMENT horiz_align = ALIGN_LEFT, const VERTICAL_ALIGNMENT vert_align = ALIGN_TOP); // Create a new sprite with the given ID and these settings
 		sprite * get_sprite(const std::string &id); // Return the sprite with this ID.
-		int remove_sprite(const std::string &id);
+		int remove_sprite(const std::string &id); // Also cancels any loads still pending for the sprite
 	};
 
 
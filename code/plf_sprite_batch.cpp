@@ -0,0 +1,145 @@
+#include <vector>
+#include <cmath> // sin, cos
+
+#include <SDL2/SDL.h>
+
+#include "plf_sprite_batch.h"
+#include "plf_draw_command.h"
+
+
+namespace plf
+{
+
+#ifdef PLF_SPRITE_BATCHING
+
+	sprite_batch::sprite_batch():
+		texture(NULL),
+		texture_width(1),
+		texture_height(1)
+	{
+		vertices.reserve(1024);
+		indices.reserve(1536);
+	}
+
+
+
+	int sprite_batch::add(SDL_Renderer *s_renderer, const draw_command &command)
+	{
+		int return_value = 0;
+
+		if (command.texture != texture)
+		{
+			return_value = flush(s_renderer);
+			texture = command.texture;
+
+			int width, height;
+
+			if (SDL_QueryTexture(texture, NULL, NULL, &width, &height) != 0 || width == 0 || height == 0)
+			{
+				texture = NULL;
+				return -1;
+			}
+
+			texture_width = static_cast<float>(width);
+			texture_height = static_cast<float>(height);
+		}
+
+
+		// Texture coordinates - flipping is done by swapping these, rather than by mirroring positions, so that it occurs prior to rotation as per SDL_RenderCopyEx:
+		float u1 = static_cast<float>(command.source.x) / texture_width;
+		float v1 = static_cast<float>(command.source.y) / texture_height;
+		float u2 = static_cast<float>(command.source.x + command.source.w) / texture_width;
+		float v2 = static_cast<float>(command.source.y + command.source.h) / texture_height;
+
+		if (command.flip & SDL_FLIP_HORIZONTAL)
+		{
+			const float temp = u1;
+			u1 = u2;
+			u2 = temp;
+		}
+
+		if (command.flip & SDL_FLIP_VERTICAL)
+		{
+			const float temp = v1;
+			v1 = v2;
+			v2 = temp;
+		}
+
+
+		// Corner positions relative to the rotation center (default center is the middle of the destination, as per SDL_RenderCopyEx):
+		const float center_x = (command.has_center) ? static_cast<float>(command.center.x) : static_cast<float>(command.destination.w) * 0.5f;
+		const float center_y = (command.has_center) ? static_cast<float>(command.center.y) : static_cast<float>(command.destination.h) * 0.5f;
+		const float left = -center_x, top = -center_y;
+		const float right = static_cast<float>(command.destination.w) - center_x, bottom = static_cast<float>(command.destination.h) - center_y;
+		const float origin_x = static_cast<float>(command.destination.x) + center_x, origin_y = static_cast<float>(command.destination.y) + center_y;
+
+		const float corner_x[4] = {left, right, right, left};
+		const float corner_y[4] = {top, top, bottom, bottom};
+		const float corner_u[4] = {u1, u2, u2, u1};
+		const float corner_v[4] = {v1, v1, v2, v2};
+
+		SDL_Vertex vertex;
+		vertex.color.r = command.colormod.r;
+		vertex.color.g = command.colormod.g;
+		vertex.color.b = command.colormod.b;
+		vertex.color.a = command.alpha;
+
+		const int first_index = static_cast<int>(vertices.size());
+
+		if (command.angle == 0)
+		{
+			for (unsigned int corner = 0; corner != 4; ++corner)
+			{
+				vertex.position.x = origin_x + corner_x[corner];
+				vertex.position.y = origin_y + corner_y[corner];
+				vertex.tex_coord.x = corner_u[corner];
+				vertex.tex_coord.y = corner_v[corner];
+				vertices.push_back(vertex);
+			}
+		}
+		else
+		{
+			// Angle is in degrees clockwise - clockwise on screen, since y increases downwards:
+			const double radians = command.angle * 0.017453292519943295;
+			const float sine = static_cast<float>(std::sin(radians)), cosine = static_cast<float>(std::cos(radians));
+
+			for (unsigned int corner = 0; corner != 4; ++corner)
+			{
+				vertex.position.x = origin_x + (corner_x[corner] * cosine) - (corner_y[corner] * sine);
+				vertex.position.y = origin_y + (corner_x[corner] * sine) + (corner_y[corner] * cosine);
+				vertex.tex_coord.x = corner_u[corner];
+				vertex.tex_coord.y = corner_v[corner];
+				vertices.push_back(vertex);
+			}
+		}
+
+		// Two triangles per quad:
+		indices.push_back(first_index);
+		indices.push_back(first_index + 1);
+		indices.push_back(first_index + 2);
+		indices.push_back(first_index);
+		indices.push_back(first_index + 2);
+		indices.push_back(first_index + 3);
+
+		return return_value;
+	}
+
+
+
+	int sprite_batch::flush(SDL_Renderer *s_renderer)
+	{
+		if (indices.empty())
+		{
+			return 0;
+		}
+
+		const int return_value = SDL_RenderGeometry(s_renderer, texture, &(vertices[0]), static_cast<int>(vertices.size()), &(indices[0]), static_cast<int>(indices.size()));
+
+		vertices.clear();
+		indices.clear();
+		return return_value;
+	}
+
+#endif
+
+}
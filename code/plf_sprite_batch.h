@@ -0,0 +1,45 @@
+#ifndef PLF_SPRITE_BATCH_H
+#define PLF_SPRITE_BATCH_H
+
+#include <vector>
+
+#include <SDL2/SDL.h>
+
+#include "plf_draw_command.h"
+
+
+// SDL_RenderGeometry was introduced in SDL 2.0.18 - with earlier versions every quad is drawn individually via SDL_RenderCopy(Ex):
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+	#define PLF_SPRITE_BATCHING
+#endif
+
+
+namespace plf
+{
+
+#ifdef PLF_SPRITE_BATCHING
+
+	// Accumulates textured quads which share an atlas texture, and draws them with a single SDL_RenderGeometry call.
+	// Rotation, flip, transparency and color modulation are baked into the vertices, so differing sprites on the same atlas page never break a batch:
+	class sprite_batch
+	{
+	private:
+		std::vector<SDL_Vertex> vertices;
+		std::vector<int> indices;
+		SDL_Texture *texture; // Atlas texture of the quads currently in the batch
+		float texture_width, texture_height; // Used to normalise source rects into texture coordinates
+
+	public:
+		sprite_batch();
+
+		// Add a DRAW_TEXTURE command's quad to the batch. If the command's texture differs from the batch's, the batch is flushed first:
+		int add(SDL_Renderer *s_renderer, const draw_command &command);
+		int flush(SDL_Renderer *s_renderer); // Draw and empty the batch
+		inline bool empty() { return indices.empty(); };
+	};
+
+#endif
+
+}
+
+#endif // PLF_SPRITE_BATCH_H
@@ -0,0 +1,290 @@
+#include <vector>
+#include <deque>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <cstdio> // std::remove
+
+#include <SDL2/SDL.h>
+
+#include "plf_streaming.h"
+
+
+namespace plf
+{
+
+	chunk_streamer::chunk_streamer():
+		thread(NULL),
+		reading_owner(NULL),
+		quit_thread(false)
+	{
+		mutex = SDL_CreateMutex();
+		condition = SDL_CreateCond();
+	}
+
+
+
+	chunk_streamer::~chunk_streamer()
+	{
+		if (thread != NULL)
+		{
+			SDL_LockMutex(mutex);
+			quit_thread = true;
+			SDL_CondBroadcast(condition);
+			SDL_UnlockMutex(mutex);
+			SDL_WaitThread(thread, NULL);
+		}
+
+		SDL_DestroyCond(condition);
+		SDL_DestroyMutex(mutex);
+	}
+
+
+
+	void chunk_streamer::write_chunk(plf::layer *owner, const std::string &filename, const std::vector<entity_record> &records, const bool append)
+	{
+		// Serialise here rather than on the thread, so the records needn't be copied - one tab-separated line per entity:
+		std::ostringstream data;
+		data.precision(17);
+
+		for (std::vector<entity_record>::const_iterator record = records.begin(); record != records.end(); ++record)
+		{
+			data << record->prototype_id << '\t' << record->id << '\t' << record->type << '\t' << record->state << '\t' << record->x << '\t' << record->y << '\t' << record->size << '\t' << record->angle << '\t'
+				<< record->sprite_time << '\t' << record->movement_time << '\t' << record->depth << '\t' << static_cast<unsigned int>(record->transparency) << '\t' << record->flip_horizontal << '\t' << record->flip_vertical << '\n';
+		}
+
+		job new_job;
+		new_job.owner = owner;
+		new_job.filename = filename;
+		new_job.data = data.str();
+		new_job.column = 0;
+		new_job.row = 0;
+		new_job.write = true;
+		new_job.append = append;
+		queue_job(new_job);
+	}
+
+
+
+	void chunk_streamer::read_chunk(plf::layer *owner, const std::string &filename, const int column, const int row)
+	{
+		job new_job;
+		new_job.owner = owner;
+		new_job.filename = filename;
+		new_job.column = column;
+		new_job.row = row;
+		new_job.write = false;
+		new_job.append = false;
+		queue_job(new_job);
+	}
+
+
+
+	void chunk_streamer::queue_job(const job &new_job)
+	{
+		SDL_LockMutex(mutex);
+		pending_jobs.push_back(new_job);
+		SDL_CondBroadcast(condition);
+
+		if (thread == NULL)
+		{
+			thread = SDL_CreateThread(stream_thread_function, "plf streaming thread", this); // Created under the mutex, so the thread can't see thread == NULL
+
+			if (thread == NULL) // Fall back to doing the work here
+			{
+				std::clog << "plf::chunk_streamer queue_job: could not create streaming thread, streaming on the main thread instead. SDL Error: " << SDL_GetError() << std::endl;
+				SDL_UnlockMutex(mutex);
+				stream_loop();
+				return;
+			}
+		}
+
+		SDL_UnlockMutex(mutex);
+	}
+
+
+
+	void chunk_streamer::collect_loads(plf::layer *owner, std::vector<chunk_load> &loads)
+	{
+		SDL_LockMutex(mutex);
+
+		for (std::vector<chunk_load>::iterator load = completed_loads.begin(); load != completed_loads.end();)
+		{
+			if (load->owner == owner)
+			{
+				loads.push_back(chunk_load());
+				loads.back().owner = owner;
+				loads.back().column = load->column;
+				loads.back().row = load->row;
+				loads.back().records.swap(load->records);
+				load = completed_loads.erase(load);
+			}
+			else
+			{
+				++load;
+			}
+		}
+
+		SDL_UnlockMutex(mutex);
+	}
+
+
+
+	void chunk_streamer::cancel_loads(plf::layer *owner)
+	{
+		SDL_LockMutex(mutex);
+
+		// Reads not yet started are dropped - their files are left in place. Writes still go ahead:
+		for (std::deque<job>::iterator job_iterator = pending_jobs.begin(); job_iterator != pending_jobs.end();)
+		{
+			if (!job_iterator->write && job_iterator->owner == owner)
+			{
+				job_iterator = pending_jobs.erase(job_iterator);
+			}
+			else
+			{
+				++job_iterator;
+			}
+		}
+
+		while (reading_owner == owner)
+		{
+			SDL_CondWait(condition, mutex);
+		}
+
+		for (std::vector<chunk_load>::iterator load = completed_loads.begin(); load != completed_loads.end();)
+		{
+			if (load->owner == owner)
+			{
+				load = completed_loads.erase(load);
+			}
+			else
+			{
+				++load;
+			}
+		}
+
+		SDL_UnlockMutex(mutex);
+	}
+
+
+
+	int chunk_streamer::stream_thread_function(void *this_streamer)
+	{
+		static_cast<chunk_streamer *>(this_streamer)->stream_loop();
+		return 0;
+	}
+
+
+
+	void chunk_streamer::stream_loop()
+	{
+		SDL_LockMutex(mutex);
+
+		while (true)
+		{
+			while (pending_jobs.empty() && !quit_thread && thread != NULL)
+			{
+				SDL_CondWait(condition, mutex);
+			}
+
+			if (pending_jobs.empty()) // ie. quitting, and all writes are done (or running on the main thread, and the queue is empty)
+			{
+				break;
+			}
+
+			job current_job;
+			current_job.owner = pending_jobs.front().owner;
+			current_job.filename.swap(pending_jobs.front().filename);
+			current_job.data.swap(pending_jobs.front().data);
+			current_job.column = pending_jobs.front().column;
+			current_job.row = pending_jobs.front().row;
+			current_job.write = pending_jobs.front().write;
+			current_job.append = pending_jobs.front().append;
+			pending_jobs.pop_front();
+
+			if (!current_job.write)
+			{
+				reading_owner = current_job.owner;
+			}
+
+			SDL_UnlockMutex(mutex);
+			run_job(current_job);
+			SDL_LockMutex(mutex);
+
+			reading_owner = NULL;
+			SDL_CondBroadcast(condition);
+		}
+
+		SDL_UnlockMutex(mutex);
+	}
+
+
+
+	void chunk_streamer::run_job(job &current_job)
+	{
+		if (current_job.write)
+		{
+			std::ofstream file(current_job.filename.c_str(), current_job.append ? (std::ios::out | std::ios::app | std::ios::binary) : (std::ios::out | std::ios::trunc | std::ios::binary));
+			file << current_job.data;
+
+			if (!file)
+			{
+				std::clog << "plf::chunk_streamer run_job: could not write chunk file '" << current_job.filename << "'. Entities in this chunk have been lost." << std::endl;
+			}
+
+			return;
+		}
+
+		chunk_load load;
+		load.owner = current_job.owner;
+		load.column = current_job.column;
+		load.row = current_job.row;
+
+		std::ifstream file(current_job.filename.c_str(), std::ios::in | std::ios::binary);
+
+		if (!file)
+		{
+			std::clog << "plf::chunk_streamer run_job: could not read chunk file '" << current_job.filename << "'." << std::endl;
+		}
+		else
+		{
+			std::string line;
+			unsigned int transparency;
+
+			while (std::getline(file, line))
+			{
+				std::istringstream fields(line);
+				entity_record record;
+
+				std::getline(fields, record.prototype_id, '\t');
+				std::getline(fields, record.id, '\t');
+				std::getline(fields, record.type, '\t');
+				std::getline(fields, record.state, '\t');
+				fields >> record.x >> record.y >> record.size >> record.angle >> record.sprite_time >> record.movement_time >> record.depth >> transparency >> record.flip_horizontal >> record.flip_vertical;
+
+				if (fields.fail())
+				{
+					std::clog << "plf::chunk_streamer run_job: skipping malformed entity record in chunk file '" << current_job.filename << "'." << std::endl;
+					continue;
+				}
+
+				record.transparency = static_cast<Uint8>(transparency);
+				load.records.push_back(record);
+			}
+
+			file.close();
+			std::remove(current_job.filename.c_str());
+		}
+
+		SDL_LockMutex(mutex);
+		completed_loads.push_back(chunk_load());
+		completed_loads.back().owner = load.owner;
+		completed_loads.back().column = load.column;
+		completed_loads.back().row = load.row;
+		completed_loads.back().records.swap(load.records);
+		SDL_UnlockMutex(mutex);
+	}
+
+}
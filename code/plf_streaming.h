@@ -0,0 +1,77 @@
+#ifndef PLF_STREAMING_H
+#define PLF_STREAMING_H
+
+#include <vector>
+#include <deque>
+#include <string>
+
+#include <SDL2/SDL.h>
+
+
+namespace plf
+{
+
+	class layer;
+
+
+	// The state of an evicted entity, enough to respawn it from its prototype:
+	struct entity_record
+	{
+		std::string prototype_id, id, type, state;
+		double x, y, size, angle, sprite_time, movement_time;
+		int depth;
+		Uint8 transparency;
+		bool flip_horizontal, flip_vertical;
+	};
+
+
+
+	// A chunk read back in by the streaming thread, waiting to be respawned by its layer:
+	struct chunk_load
+	{
+		plf::layer *owner;
+		int column, row;
+		std::vector<entity_record> records;
+	};
+
+
+
+	// Background file I/O for streamed layers. Evicted chunks are written to one file per chunk, and read (and parsed) back on a single worker thread, so that neither stalls the frame.
+	// Jobs are processed in the order they're queued, so a chunk that's evicted again while it's still being loaded is always written after the read. The thread is only started once the first job is queued:
+	class chunk_streamer
+	{
+	private:
+		struct job
+		{
+			plf::layer *owner;
+			std::string filename;
+			std::string data; // Serialised records, for writes
+			int column, row;
+			bool write, append;
+		};
+
+		std::deque<job> pending_jobs;
+		std::vector<chunk_load> completed_loads;
+		SDL_Thread *thread;
+		SDL_mutex *mutex; // Protects pending_jobs, completed_loads and quit_thread
+		SDL_cond *condition;
+		plf::layer *reading_owner; // Owner of the read in progress, if any
+		bool quit_thread;
+
+		void queue_job(const job &new_job);
+		void run_job(job &current_job);
+		void stream_loop();
+		static int stream_thread_function(void *this_streamer);
+	public:
+		chunk_streamer();
+		~chunk_streamer(); // Finishes any queued writes before returning
+
+		void write_chunk(plf::layer *owner, const std::string &filename, const std::vector<entity_record> &records, const bool append); // Otherwise any existing file is replaced
+		void read_chunk(plf::layer *owner, const std::string &filename, const int column, const int row); // The file is deleted once read
+		void collect_loads(plf::layer *owner, std::vector<chunk_load> &loads); // Moves the owner's completed reads into loads
+		void cancel_loads(plf::layer *owner); // Discards the owner's completed reads, eg. when the layer's destroyed
+	};
+
+}
+
+#endif // PLF_STREAMING_H
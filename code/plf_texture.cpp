@@ -13,7 +13,7 @@
 namespace plf
 {
 
-	texture::texture(plf::renderer *p_renderer, plf::atlas_manager *atlas_manager, SDL_Surface *surface):
+	texture::texture(plf::renderer *p_renderer, plf::atlas_manager *atlas_manager, SDL_Surface *surface, const SDL_Rect *source_area):
 		atlas_texture(NULL),
 		atlas_coordinates(NULL),
 		node(NULL),
@@ -22,16 +22,17 @@ namespace plf
 		assert(p_renderer != NULL);
 		assert(atlas_manager != NULL);
 	
-		s_renderer = p_renderer->get();
-		p_renderer->get_dimensions(renderer_width, renderer_height);
+		renderer = p_renderer;
+		renderer->get_dimensions(renderer_width, renderer_height);
 	
 		std::pair<plf::atlas *, plf::atlas_node *> atlas_pair;
-		atlas_pair = atlas_manager->add_surface(surface);
+		atlas_pair = atlas_manager->add_surface(surface, source_area);
 	
 		assert(atlas_pair.first != NULL && atlas_pair.second != NULL);
 	
 		atlas = atlas_pair.first;
 		node = atlas_pair.second;
+		node->add_user(this);
 	
 		atlas_texture = atlas->get_texture();
 		atlas_coordinates = node->get_image_coordinates();
@@ -39,83 +40,101 @@ namespace plf
 	
 	
 	
+	texture::texture(plf::renderer *p_renderer, plf::atlas *existing_atlas, plf::atlas_node *existing_node):
+		node(existing_node),
+		atlas(existing_atlas),
+		renderer(p_renderer)
+	{
+		assert(renderer != NULL);
+		assert(atlas != NULL && node != NULL);
+	
+		renderer->get_dimensions(renderer_width, renderer_height);
+		node->add_user(this);
+		atlas_texture = atlas->get_texture();
+		atlas_coordinates = node->get_image_coordinates();
+	}
+	
+	
+	
 	texture::~texture()
 	{
 		if (node != NULL)
 		{
+			node->remove_user(this);
 			atlas->remove_surface(node);
 		}
 	}
 	
 	
 	
-	int texture::draw(int x, int y, const double size, const double angle, SDL_Point *center, const SDL_RendererFlip flip, const Uint8 transparency, const rgb *colormod)
+	void texture::relocate(plf::atlas_node *old_node, plf::atlas *new_atlas, plf::atlas_node *new_node)
 	{
-		SDL_Rect render_destination =
-		{
-			x,
-			y,
-			static_cast<int>(static_cast<double>(atlas_coordinates->w) * size),
-			static_cast<int>(static_cast<double>(atlas_coordinates->h) * size)
-		};
-	
-		int return_value;
+		assert(node == old_node);
 	
-		if (transparency != 255) // 0 is covered in sprite call
-		{
-			SDL_SetTextureAlphaMod(atlas_texture, transparency);
-		}
-	
-		if (colormod != NULL)
-		{
-			SDL_SetTextureColorMod(atlas_texture, colormod->r, colormod->g, colormod->b);
-		}
+		node = new_node;
+		atlas = new_atlas;
+		atlas_texture = atlas->get_texture();
+		atlas_coordinates = node->get_image_coordinates();
+	}
 	
 	
-		if (center == NULL)
-		{
-			// Optimise for most common scenario:
-			if (angle == 0 && flip == SDL_FLIP_NONE && size == 1)
-			{
-				return_value = SDL_RenderCopy(s_renderer, atlas_texture, atlas_coordinates, &render_destination);
-			}
 	
-			return_value = SDL_RenderCopyEx(s_renderer, atlas_texture, atlas_coordinates, &render_destination, angle, NULL, flip);
-		}
-		else
+	int texture::draw(int x, int y, const double size, const double angle, SDL_Point *center, const SDL_RendererFlip flip, const Uint8 transparency, const rgb *colormod)
+	{
+		draw_command command;
+		command.type = DRAW_TEXTURE;
+		command.texture = atlas_texture;
+		command.source = *atlas_coordinates;
+		command.destination.x = x;
+		command.destination.y = y;
+		command.destination.w = static_cast<int>(static_cast<double>(atlas_coordinates->w) * size);
+		command.destination.h = static_cast<int>(static_cast<double>(atlas_coordinates->h) * size);
+		command.angle = angle;
+		command.flip = flip;
+		command.alpha = transparency; // 0 is covered in sprite call
+		command.has_center = (center != NULL);
+		command.opaque = (node->opaque && transparency == 255 && angle == 0);
+	
+		if (center != NULL)
 		{
-			SDL_Point real_center = {center->x - x, center->y - y};
-			return_value = SDL_RenderCopyEx(s_renderer, atlas_texture, atlas_coordinates, &render_destination, angle, &real_center, flip);
+			command.center.x = center->x - x;
+			command.center.y = center->y - y;
 		}
 	
 		if (colormod != NULL)
 		{
-			SDL_SetTextureColorMod(atlas_texture, 255, 255, 255);
+			command.colormod = *colormod;
 		}
-	
-		if (transparency != 255) // Reset texture atlas transparency for next texture
+		else
 		{
-			SDL_SetTextureAlphaMod(atlas_texture, 255);
+			command.colormod.r = command.colormod.g = command.colormod.b = 255;
 		}
 	
-		return return_value;
+		return renderer->submit(command);
 	}
 	
 	
 	
-	multitexture::multitexture(renderer *p_renderer, atlas_manager *atlas_manager, SDL_Surface *surface, const unsigned int maximum_width, const unsigned int maximum_height):
+	multitexture::multitexture(plf::renderer *p_renderer, plf::atlas_manager *atlas_manager, SDL_Surface *surface, const unsigned int maximum_width, const unsigned int maximum_height, const SDL_Rect *source_area):
 		segments(NULL)
 	{
 		assert(p_renderer != NULL);
 	
-		s_renderer = p_renderer->get();
-		p_renderer->get_dimensions(renderer_width, renderer_height);
+		renderer = p_renderer;
+		renderer->get_dimensions(renderer_width, renderer_height);
+	
+		SDL_Rect area = {0, 0, surface->w, surface->h};
+	
+		if (source_area != NULL)
+		{
+			area = *source_area;
+		}
 	
 		// Divide texture into segments (remember, integer division always rounds down in c++):
-		total_width = surface->w;
-		total_height = surface->h;
-		const unsigned int num_cells_x = divide_and_round_up(surface->w, maximum_width);
-		const unsigned int num_cells_y = divide_and_round_up(surface->h, maximum_height);
+		total_width = area.w;
+		total_height = area.h;
+		const unsigned int num_cells_x = divide_and_round_up(area.w, maximum_width);
+		const unsigned int num_cells_y = divide_and_round_up(area.h, maximum_height);
 		const unsigned int total_cells = num_cells_x * num_cells_y;
 		segments = new segment[total_cells];
 		end_segment = &(segments[total_cells]);
@@ -127,59 +146,68 @@ namespace plf
 			current_segment->node = NULL;
 		}
 	
-		SDL_SetSurfaceBlendMode(surface, SDL_BLENDMODE_NONE);
-		SDL_Surface *temp_surface;
-		SDL_Rect source_rect;
+		SDL_Surface *source_surface = surface;
+	
+		if (SDL_ISPIXELFORMAT_INDEXED(surface->format->format))
+		{
+			// Convert once here, rather than once per segment in the atlas:
+			source_surface = SDL_ConvertSurfaceFormat(surface, renderer->get_surface_pixel_format(), 0);
+			plf_fail_if (source_surface == NULL, "plf::multitexture error: Unable to convert palettized surface.");
+		}
+	
+		SDL_Rect source_rect; // Relative to area
 		source_rect.w = maximum_width;
 		source_rect.h = maximum_height;
+		SDL_Rect segment_area;
 		current_segment = &(segments[0]);
 	
 		std::pair<plf::atlas *, plf::atlas_node *> atlas_pair;
+		atlas_manager->begin_uploads(); // Upload all segments together
 	
-		// Break down surface into segments.
+		// Break down surface into segments - each is copied straight from its area of the surface to the atlas.
 		// Note: segments overlap by 1pix vertically and horizontally to remove gaps when rotating. Hence the (maximum_height - 1) and ditto maximum_width in loops:
-		for (source_rect.y = 0; source_rect.y < surface->h; source_rect.y += (maximum_height - 1))
+		for (source_rect.y = 0; source_rect.y < area.h; source_rect.y += (maximum_height - 1))
 		{
 			source_rect.w = maximum_width;
 	
-			if ((surface->h - source_rect.y) < static_cast<int>(maximum_height)) // ie. if this is the final y segmentation and the size is lower than maximum_height
+			if ((area.h - source_rect.y) < static_cast<int>(maximum_height)) // ie. if this is the final y segmentation and the size is lower than maximum_height
 			{
-				// Reduce the size of the created surface:
-				source_rect.h = surface->h - source_rect.y;
+				// Reduce the size of the segment:
+				source_rect.h = area.h - source_rect.y;
 			}
 	
-			temp_surface = create_surface(source_rect.w, source_rect.h);
-	
-			plf_fail_if (temp_surface == NULL, "plf::multitexture error: create_surface with width/height = " << source_rect.w << "/" << source_rect.h << " returned NULL.");
-	
-			for (source_rect.x = 0; source_rect.x < surface->w; source_rect.x += (maximum_width - 1))
+			for (source_rect.x = 0; source_rect.x < area.w; source_rect.x += (maximum_width - 1))
 			{
-				if ((surface->w - source_rect.x) < static_cast<int>(maximum_width)) // ie. if this is the final x segmentation for this y run and the size is lower than maximum_width
+				if ((area.w - source_rect.x) < static_cast<int>(maximum_width)) // ie. if this is the final x segmentation for this y run and the size is lower than maximum_width
 				{
-					// Reduce the size of the created surface:
-					source_rect.w = surface->w - source_rect.x;
-					SDL_FreeSurface(temp_surface);
-					temp_surface = create_surface(source_rect.w, source_rect.h);
-	
-					plf_fail_if (temp_surface == NULL, "plf::multitexture error: create_surface with width/height = " << source_rect.w << "/" << source_rect.h << " returned NULL.");
+					// Reduce the size of the segment:
+					source_rect.w = area.w - source_rect.x;
 				}
 	
-				plf_fail_if (SDL_BlitSurface(surface, &source_rect, temp_surface, NULL) < 0, "plf::multitexture error: Blitsurface failed.");
+				segment_area = source_rect;
+				segment_area.x += area.x;
+				segment_area.y += area.y;
 	
-				atlas_pair = atlas_manager->add_surface(temp_surface);
+				atlas_pair = atlas_manager->add_surface(source_surface, &segment_area);
 	
 				assert(atlas_pair.first != NULL && atlas_pair.second != NULL);
 	
 				current_segment->atlas = atlas_pair.first;
 				current_segment->atlas_texture = current_segment->atlas->get_texture();
 				current_segment->node = atlas_pair.second;
+				current_segment->node->add_user(this);
 				current_segment->atlas_coordinates = current_segment->node->get_image_coordinates();
 				current_segment->segment_x = source_rect.x;
 				current_segment->segment_y = source_rect.y;
 				++current_segment;
 			}
+		}
 	
-			SDL_FreeSurface(temp_surface);
+		atlas_manager->end_uploads();
+	
+		if (source_surface != surface)
+		{
+			SDL_FreeSurface(source_surface);
 		}
 	}
 	
@@ -191,6 +219,7 @@ namespace plf
 		{
 			if (current_segment->node != NULL)
 			{
+				current_segment->node->remove_user(this);
 				current_segment->atlas->remove_surface(current_segment->node);
 			}
 		}
@@ -201,12 +230,85 @@ namespace plf
 	
 	
 	
+	void multitexture::relocate(plf::atlas_node *old_node, plf::atlas *new_atlas, plf::atlas_node *new_node)
+	{
+		for (segment *current_segment = &(segments[0]); current_segment != end_segment; ++current_segment)
+		{
+			if (current_segment->node == old_node)
+			{
+				current_segment->node = new_node;
+				current_segment->atlas = new_atlas;
+				current_segment->atlas_texture = new_atlas->get_texture();
+				current_segment->atlas_coordinates = new_node->get_image_coordinates();
+				return;
+			}
+		}
+	
+		assert(false); // old_node isn't one of this multitexture's segments
+	}
+	
+	
+	
+	bool texture::is_opaque()
+	{
+		return node->opaque;
+	}
+	
+	
+	
+	bool texture::get_atlas_region(SDL_Texture *&region_texture, SDL_Rect &region)
+	{
+		region_texture = atlas_texture;
+		region = *atlas_coordinates;
+		return true;
+	}
+	
+	
+	
+	bool multitexture::get_atlas_region(SDL_Texture *&region_texture, SDL_Rect &/*region*/)
+	{
+		region_texture = NULL;
+		return false;
+	}
+	
+	
+	
+	bool multitexture::is_opaque()
+	{
+		for (segment *current_segment = &(segments[0]); current_segment != end_segment; ++current_segment)
+		{
+			if (!(current_segment->node->opaque))
+			{
+				return false;
+			}
+		}
+	
+		return true;
+	}
+	
+	
+	
 	int multitexture::draw(int x, int y, const double size, const double angle, SDL_Point *center, const SDL_RendererFlip flip, const Uint8 transparency, const rgb *colormod)
 	{
 		int resized_width = static_cast<int>(static_cast<double>(total_width) * size);
 		int resized_height = static_cast<int>(static_cast<double>(total_height) * size);
 		int return_value = 0;
 	
+		draw_command command;
+		command.type = DRAW_TEXTURE;
+		command.angle = angle;
+		command.flip = flip;
+		command.alpha = transparency;
+	
+		if (colormod != NULL)
+		{
+			command.colormod = *colormod;
+		}
+		else
+		{
+			command.colormod.r = command.colormod.g = command.colormod.b = 255;
+		}
+	
 	
 		// If not rotating, rule out entire image not being displayed onscreen):
 		if (angle == 0)
@@ -220,21 +322,24 @@ namespace plf
 			if (flip == SDL_FLIP_NONE && size == 1 && transparency == 255 && colormod == NULL)
 			{
 				// Optimised draw loop:
+				command.has_center = false;
+	
 				for (segment *current_segment = &(segments[0]); current_segment != end_segment; ++current_segment) // initialise nodes to NULL just in case something goes wrong and then the destructor call ruins everything.
 				{
-					SDL_Rect render_destination =
-					{
-						x + current_segment->segment_x,
-						y + current_segment->segment_y,
-						current_segment->atlas_coordinates->w,
-						current_segment->atlas_coordinates->h
-					};
+					SDL_Rect &render_destination = command.destination;
+					render_destination.x = x + current_segment->segment_x;
+					render_destination.y = y + current_segment->segment_y;
+					render_destination.w = current_segment->atlas_coordinates->w;
+					render_destination.h = current_segment->atlas_coordinates->h;
 	
 					// Check whether sprite needs to be displayed at all - saves CPU-time - thoroughly benchmarked.
 					// Self-cropping images to renderer frame that need to be displayed does not save CPU time -  SDL does it faster.
 					if (!(render_destination.x + render_destination.w < 0 || render_destination.x > renderer_width || render_destination.y + render_destination.h < 0 || render_destination.y > renderer_height))
 					{
-						return_value += SDL_RenderCopy(s_renderer, current_segment->atlas_texture, current_segment->atlas_coordinates, &render_destination);
+						command.texture = current_segment->atlas_texture;
+						command.source = *(current_segment->atlas_coordinates);
+						command.opaque = current_segment->node->opaque;
+						return_value += renderer->submit(command);
 					}
 				}
 	
@@ -269,8 +374,10 @@ namespace plf
 			}
 		}
 	
-		SDL_Rect render_destination;
-		SDL_Point half_segment_size = {(segments[0].atlas_coordinates->w - 1) / 2, (segments[0].atlas_coordinates->h - 1) / 2};
+		SDL_Rect &render_destination = command.destination;
+		command.has_center = true;
+		command.center.x = (segments[0].atlas_coordinates->w - 1) / 2; // ie. half segment size
+		command.center.y = (segments[0].atlas_coordinates->h - 1) / 2;
 	
 		for (segment *current_segment = &(segments[0]); current_segment != end_segment; ++current_segment) // initialise nodes to NULL just in case something goes wrong and then the destructor call ruins everything.
 		{
@@ -308,27 +415,10 @@ namespace plf
 			// Self-cropping images to renderer frame that need to be displayed does not save CPU time -  SDL does it faster.
 			if (!(render_destination.x + render_destination.w < 0 || render_destination.x > renderer_width || render_destination.y + render_destination.h < 0 || render_destination.y > renderer_height))
 			{
-				if (transparency != 255)
-				{
-					SDL_SetTextureAlphaMod(current_segment->atlas_texture, transparency);
-				}
-	
-				if (colormod != NULL)
-				{
-					SDL_SetTextureColorMod(current_segment->atlas_texture, colormod->r, colormod->g, colormod->b);
-				}
-	
-				return_value += SDL_RenderCopyEx(s_renderer, current_segment->atlas_texture, current_segment->atlas_coordinates, &render_destination, angle, &(half_segment_size), flip);
-	
-				if (colormod != NULL)
-				{
-					SDL_SetTextureColorMod(current_segment->atlas_texture, 255, 255, 255);
-				}
-	
-				if (transparency != 255)
-				{
-					SDL_SetTextureAlphaMod(current_segment->atlas_texture, 255);
-				}
+				command.texture = current_segment->atlas_texture;
+				command.source = *(current_segment->atlas_coordinates);
+				command.opaque = (current_segment->node->opaque && transparency == 255 && angle == 0);
+				return_value += renderer->submit(command);
 			}
 		}
 	
@@ -344,36 +434,73 @@ namespace plf
 	
 	texture_manager::texture_manager(plf::renderer *p_renderer, plf::atlas_manager *p_atlas_manager):
 		renderer(p_renderer),
-		atlas_manager(p_atlas_manager)
+		atlas_manager(p_atlas_manager),
+		placeholder(NULL)
 	{
 		assert(renderer != NULL);
 		assert(atlas_manager != NULL);
-	
-		atlas_manager->get_maximum_texture_size(maximum_width, maximum_height);
-		assert(maximum_width != 0 && maximum_height != 0); // Should not happen
 	}
 	
 	
 	
 	texture_manager::~texture_manager()
 	{
+		delete placeholder;
 	}
 	
 	
 	
-	texture * texture_manager::add_image(SDL_Surface *new_surface)
+	texture * texture_manager::get_placeholder()
+	{
+		if (placeholder != NULL)
+		{
+			return placeholder;
+		}
+	
+		// 16 * 16, in 4 * 4 grey and magenta squares:
+		SDL_Surface *placeholder_surface = create_surface(16, 16);
+		plf_fail_if (placeholder_surface == NULL, "plf::texture_manager get_placeholder Error: Unable to create surface. ");
+	
+		const Uint32 grey = SDL_MapRGBA(placeholder_surface->format, 128, 128, 128, 255), magenta = SDL_MapRGBA(placeholder_surface->format, 255, 0, 255, 255);
+		SDL_Rect square = {0, 0, 4, 4};
+	
+		for (square.y = 0; square.y != 16; square.y += 4)
+		{
+			for (square.x = 0; square.x != 16; square.x += 4)
+			{
+				SDL_FillRect(placeholder_surface, &square, (((square.x + square.y) / 4) % 2 == 0) ? grey : magenta);
+			}
+		}
+	
+		placeholder = add_image(placeholder_surface);
+		SDL_FreeSurface(placeholder_surface);
+		return placeholder;
+	}
+	
+	
+	
+	texture * texture_manager::add_image(SDL_Surface *new_surface, const SDL_Rect *source_area)
 	{
 		assert(new_surface != NULL);
 		assert(new_surface->w > 0);
 		assert(new_surface->h > 0);
 	
-		if (new_surface->w <= maximum_width && new_surface->h <= maximum_height) // Normal case
+		const int width = (source_area == NULL) ? new_surface->w : source_area->w;
+		const int height = (source_area == NULL) ? new_surface->h : source_area->h;
+		assert(width > 0 && height > 0);
+	
+		// Queried each time, as the atlas page size can be changed before the first image is added:
+		int maximum_width, maximum_height;
+		atlas_manager->get_maximum_texture_size(maximum_width, maximum_height);
+		assert(maximum_width != 0 && maximum_height != 0); // Should not happen
+	
+		if (width <= maximum_width && height <= maximum_height) // Normal case
 		{
-			return new texture(renderer, atlas_manager, new_surface);
+			return new texture(renderer, atlas_manager, new_surface, source_area);
 		}
 		else // surface larger than maximum hardware texture dimensions, have to split up into multitexture:
 		{
-			return new multitexture(renderer, atlas_manager, new_surface, maximum_width, maximum_height);
+			return new multitexture(renderer, atlas_manager, new_surface, maximum_width, maximum_height, source_area);
 		}
 	}
 	
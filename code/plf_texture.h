@@ -5,19 +5,13 @@
 
 
 #include "plf_atlas.h"
+#include "plf_draw_command.h"
+#include "plf_image_decoder.h"
 
 
 namespace plf
 {
 
-	struct rgb
-	{
-		Uint8 r;
-		Uint8 g;
-		Uint8 b;
-	};
-	
-	
 	class texture
 	{
 	private:
@@ -25,15 +19,19 @@ namespace plf
 		SDL_Rect *atlas_coordinates; // Location of texture within atlas
 		plf::atlas_node *node; // The specific node within the atlas - stored in case this texture is deleted and the atlas needs to be updated
 		plf::atlas *atlas; // Pointed to the texture atlas this texture is located within - also preseved in case of deletion
-		SDL_Renderer *s_renderer; // Stored locally for faster renderer access
+		plf::renderer *renderer; // Draws are submitted to the renderer, which either issues or records them depending on render mode
 		int renderer_width, renderer_height; // Stored locally for offscreen texture draw culling, avoid calls to SDL_Renderer
 	public:
 		texture(): node(NULL) {}; // Prevents segfault with derived class multitexture
-		texture(renderer *p_renderer, atlas_manager *atlas_manager, SDL_Surface *surface);
+		texture(plf::renderer *p_renderer, plf::atlas_manager *atlas_manager, SDL_Surface *surface, const SDL_Rect *source_area = NULL); // source_area: only that part of the surface is copied to the atlas
+		texture(plf::renderer *p_renderer, plf::atlas *existing_atlas, plf::atlas_node *existing_node); // An image already in an atlas, eg. a region of a baked page - the node is removed when the texture is deleted
 		virtual ~texture();
 	
 		// center, x & y are not required to be non-const in this draw but they are in the multitexture virtual derivative:
 		virtual int draw(int x, int y, const double size = 1, const double angle = 0, SDL_Point *center = NULL, const SDL_RendererFlip flip = SDL_FLIP_NONE, const Uint8 transparency = 255, const rgb *colormod = NULL);
+		virtual bool is_opaque(); // No transparent or semi-transparent pixels
+		virtual bool get_atlas_region(SDL_Texture *&region_texture, SDL_Rect &region); // Atlas texture and location of the image, for building geometry directly - false for multitextures, which span several
+		virtual void relocate(plf::atlas_node *old_node, plf::atlas *new_atlas, plf::atlas_node *new_node); // Image has been moved to another page by atlas_manager::compact
 	};
 	
 	
@@ -50,17 +48,20 @@ namespace plf
 			int segment_x, segment_y;
 		};
 	
-		SDL_Renderer *s_renderer;
+		plf::renderer *renderer;
 		segment *segments; // to be filled with dynamically-allocated array storing the entirety of the image.
 		segment *end_segment; // to not have to recalculate the value for every loop. It's either that or store the number of segments as a uint
 	
 		int total_width, total_height; // Total size of the entire image, as opposed to it's segments
 		int renderer_width, renderer_height;
 	public:
-		multitexture(renderer *p_renderer, atlas_manager *atlas_manager, SDL_Surface *surface, const unsigned int maximum_width, const unsigned int maximum_height);
+		multitexture(plf::renderer *p_renderer, plf::atlas_manager *atlas_manager, SDL_Surface *surface, const unsigned int maximum_width, const unsigned int maximum_height, const SDL_Rect *source_area = NULL);
 		~multitexture();
 	
 	    int draw(int x, int y, const double size = 1, const double angle = 0, SDL_Point *center = NULL, const SDL_RendererFlip flip = SDL_FLIP_NONE, const Uint8 transparency = 255, const rgb *colormod = NULL);
+		bool is_opaque();
+		bool get_atlas_region(SDL_Texture *&region_texture, SDL_Rect &region);
+		void relocate(plf::atlas_node *old_node, plf::atlas *new_atlas, plf::atlas_node *new_node);
 	};
 	
 	
@@ -71,13 +72,24 @@ namespace plf
 	private:
 		plf::renderer *renderer;
 		plf::atlas_manager *atlas_manager;
-		int maximum_width, maximum_height;
+		plf::image_decoder decoder;
+		texture *placeholder;
 	public:
 		texture_manager(plf::renderer *p_renderer, plf::atlas_manager *p_atlas_manager);
 		~texture_manager();
+		inline plf::image_decoder * get_decoder() { return &decoder; }; // Shared worker threads for decoding image files
+		texture * get_placeholder(); // A small checkerboard, shown by sprites which are still loading - owned by the texture_manager
+	
+		// Group atlas uploads - see atlas_manager::begin_uploads:
+		inline void begin_uploads() { atlas_manager->begin_uploads(); };
+		inline void end_uploads() { atlas_manager->end_uploads(); };
+		inline void commit_uploads() { atlas_manager->commit(); };
+		inline Uint32 get_surface_pixel_format() { return renderer->get_surface_pixel_format(); };
+		inline plf::atlas_manager * get_atlas_manager() { return atlas_manager; };
 		
-		// Automatically determine whether new texture needs to be a texture or multitexture:
-		texture * add_image(SDL_Surface *new_surface);
+		// Automatically determine whether new texture needs to be a texture or multitexture. If source_area is supplied, only that part of the surface is used - it's copied straight into the atlas, without an intermediate surface.
+		// Textures of pixel-identical images (eg. the same file loaded by two sprites, or repeated animation frames) share one atlas region, which is freed when the last of them is deleted:
+		texture * add_image(SDL_Surface *new_surface, const SDL_Rect *source_area = NULL);
 	};
 
 }
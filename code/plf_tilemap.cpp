@@ -0,0 +1,450 @@
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm> // std::find, std::min, std::max
+#include <cassert>
+
+#include <SDL2/SDL.h>
+
+#include "plf_tilemap.h"
+#include "plf_renderer.h"
+#include "plf_sprite.h"
+#include "plf_utility.h"
+
+
+namespace plf
+{
+
+	tilemap::tilemap(plf::renderer *_renderer, plf::sprite *_tileset, const unsigned int _tile_width, const unsigned int _tile_height, const unsigned int _columns, const unsigned int _rows, const int x, const int y):
+		renderer(_renderer),
+		tileset(_tileset),
+		origin_x(x),
+		origin_y(y),
+		tile_width(_tile_width),
+		tile_height(_tile_height),
+		columns(_columns),
+		rows(_rows),
+		chunk_columns((_columns + chunk_tiles - 1) / chunk_tiles),
+		chunk_rows((_rows + chunk_tiles - 1) / chunk_tiles)
+	{
+		assert(renderer != NULL);
+		assert(tileset != NULL);
+		assert(tileset->has_frames());
+		assert(tile_width != 0 && tile_height != 0);
+		assert(columns != 0 && rows != 0);
+
+		chunk empty_chunk;
+		empty_chunk.tiles.resize(chunk_tiles * chunk_tiles, 0);
+		empty_chunk.batches_valid = false;
+		chunks.resize(chunk_columns * chunk_rows, empty_chunk);
+
+		tileset->set_evictable(false); // Tile atlas locations are kept below
+
+		const unsigned int number_of_frames = tileset->get_number_of_frames();
+		plf_fail_if(number_of_frames > 65535, "plf::tilemap constructor: tileset has more frames than can be indexed.");
+		tile_regions.resize(number_of_frames);
+		solid_tiles.resize(number_of_frames + 1, false);
+		build_tile_regions();
+	}
+
+
+
+	void tilemap::build_tile_regions()
+	{
+		// Atlas location of each tile, and normalised texture coordinates for the vertex batches:
+		const unsigned int number_of_frames = static_cast<unsigned int>(tile_regions.size());
+		int texture_width, texture_height;
+		SDL_Rect frame_area;
+
+		renderer->lock();
+
+		for (unsigned int frame_number = 0; frame_number != number_of_frames; ++frame_number)
+		{
+			tile_region &region = tile_regions[frame_number];
+
+			if (!tileset->get_frame_region(frame_number, region.texture, region.source, &frame_area) || SDL_QueryTexture(region.texture, NULL, NULL, &texture_width, &texture_height) != 0)
+			{
+				std::clog << "plf::tilemap build_tile_regions: tileset frame " << frame_number << " is too large to be drawn as a tile, and will be skipped." << std::endl;
+				region.texture = NULL;
+				continue;
+			}
+
+			region.u1 = static_cast<float>(region.source.x) / static_cast<float>(texture_width);
+			region.v1 = static_cast<float>(region.source.y) / static_cast<float>(texture_height);
+			region.u2 = static_cast<float>(region.source.x + region.source.w) / static_cast<float>(texture_width);
+			region.v2 = static_cast<float>(region.source.y + region.source.h) / static_cast<float>(texture_height);
+
+			// The whole frame is stretched to the tile size, so scale the stored part's placement likewise:
+			region.destination.x = (-frame_area.x * static_cast<int>(tile_width)) / frame_area.w;
+			region.destination.y = (-frame_area.y * static_cast<int>(tile_height)) / frame_area.h;
+			region.destination.w = (region.source.w * static_cast<int>(tile_width)) / frame_area.w;
+			region.destination.h = (region.source.h * static_cast<int>(tile_height)) / frame_area.h;
+
+			if (std::find(textures.begin(), textures.end(), region.texture) == textures.end())
+			{
+				textures.push_back(region.texture);
+			}
+		}
+
+		renderer->unlock();
+		regions_compaction = tileset->get_atlas_manager()->get_number_of_compactions();
+	}
+	
+	
+	
+	void tilemap::refresh_tile_regions()
+	{
+		textures.clear();
+		build_tile_regions();
+	
+		for (std::vector<chunk>::iterator chunk_iterator = chunks.begin(); chunk_iterator != chunks.end(); ++chunk_iterator)
+		{
+			chunk_iterator->batches_valid = false;
+		}
+	}
+
+
+
+	void tilemap::set_tile(const unsigned int column, const unsigned int row, const Uint16 tile_index)
+	{
+		assert(column < columns && row < rows);
+		assert(tile_index <= tile_regions.size());
+
+		Uint16 &tile = tile_at(column, row);
+
+		if (tile != tile_index)
+		{
+			tile = tile_index;
+			get_chunk(column, row).batches_valid = false;
+		}
+	}
+
+
+
+	Uint16 tilemap::get_tile(const unsigned int column, const unsigned int row)
+	{
+		assert(column < columns && row < rows);
+		return tile_at(column, row);
+	}
+
+
+
+	void tilemap::fill(const Uint16 tile_index)
+	{
+		assert(tile_index <= tile_regions.size());
+
+		for (unsigned int row = 0; row != rows; ++row)
+		{
+			for (unsigned int column = 0; column != columns; ++column)
+			{
+				tile_at(column, row) = tile_index;
+			}
+		}
+
+		for (std::vector<chunk>::iterator chunk_iterator = chunks.begin(); chunk_iterator != chunks.end(); ++chunk_iterator)
+		{
+			chunk_iterator->batches_valid = false;
+		}
+	}
+
+
+
+	void tilemap::set_solid(const Uint16 tile_index, const bool solid)
+	{
+		assert(tile_index < solid_tiles.size());
+		solid_tiles[tile_index] = solid;
+	}
+
+
+
+	bool tilemap::is_solid_at(const int x, const int y)
+	{
+		if (x < origin_x || y < origin_y)
+		{
+			return false;
+		}
+
+		const unsigned int column = static_cast<unsigned int>(x - origin_x) / tile_width, row = static_cast<unsigned int>(y - origin_y) / tile_height;
+		return (column < columns && row < rows && solid_tiles[tile_at(column, row)]);
+	}
+
+
+
+	bool tilemap::collides(const SDL_Rect &area)
+	{
+		if (area.w <= 0 || area.h <= 0 || area.x + area.w <= origin_x || area.y + area.h <= origin_y)
+		{
+			return false;
+		}
+
+		// Range of tiles covered by area, clipped to the map:
+		const int first_column = std::max(0, (area.x - origin_x) / static_cast<int>(tile_width)), first_row = std::max(0, (area.y - origin_y) / static_cast<int>(tile_height));
+		const int last_column = std::min(static_cast<int>(columns) - 1, (area.x + area.w - 1 - origin_x) / static_cast<int>(tile_width)), last_row = std::min(static_cast<int>(rows) - 1, (area.y + area.h - 1 - origin_y) / static_cast<int>(tile_height));
+
+		for (int row = first_row; row <= last_row; ++row)
+		{
+			for (int column = first_column; column <= last_column; ++column)
+			{
+				if (solid_tiles[tile_at(column, row)])
+				{
+					return true;
+				}
+			}
+		}
+
+		return false;
+	}
+
+
+
+	void tilemap::get_solid_tiles(const SDL_Rect &area, std::vector<SDL_Rect> &solid_areas)
+	{
+		if (area.w <= 0 || area.h <= 0 || area.x + area.w <= origin_x || area.y + area.h <= origin_y)
+		{
+			return;
+		}
+
+		const int first_column = std::max(0, (area.x - origin_x) / static_cast<int>(tile_width)), first_row = std::max(0, (area.y - origin_y) / static_cast<int>(tile_height));
+		const int last_column = std::min(static_cast<int>(columns) - 1, (area.x + area.w - 1 - origin_x) / static_cast<int>(tile_width)), last_row = std::min(static_cast<int>(rows) - 1, (area.y + area.h - 1 - origin_y) / static_cast<int>(tile_height));
+		SDL_Rect tile_area = {0, 0, static_cast<int>(tile_width), static_cast<int>(tile_height)};
+
+		for (int row = first_row; row <= last_row; ++row)
+		{
+			for (int column = first_column; column <= last_column; ++column)
+			{
+				if (solid_tiles[tile_at(column, row)])
+				{
+					tile_area.x = origin_x + (column * static_cast<int>(tile_width));
+					tile_area.y = origin_y + (row * static_cast<int>(tile_height));
+					solid_areas.push_back(tile_area);
+				}
+			}
+		}
+	}
+
+
+
+	void tilemap::rebuild_batches(chunk &current_chunk)
+	{
+	#ifdef PLF_SPRITE_BATCHING
+		current_chunk.batches.clear();
+
+		SDL_Vertex vertex;
+		vertex.color.r = vertex.color.g = vertex.color.b = vertex.color.a = 255;
+		const float width = static_cast<float>(tile_width), height = static_cast<float>(tile_height);
+		float left, top, right, bottom;
+
+		for (unsigned int tile_number = 0; tile_number != chunk_tiles * chunk_tiles; ++tile_number)
+		{
+			const Uint16 tile = current_chunk.tiles[tile_number];
+
+			if (tile == 0 || tile_regions[tile - 1].texture == NULL)
+			{
+				continue;
+			}
+
+			const tile_region &region = tile_regions[tile - 1];
+			std::vector<chunk_batch>::iterator batch_iterator = current_chunk.batches.begin();
+
+			while (batch_iterator != current_chunk.batches.end() && batch_iterator->texture != region.texture)
+			{
+				++batch_iterator;
+			}
+
+			if (batch_iterator == current_chunk.batches.end())
+			{
+				current_chunk.batches.push_back(chunk_batch());
+				batch_iterator = current_chunk.batches.end() - 1;
+				batch_iterator->texture = region.texture;
+			}
+
+			left = (static_cast<float>(tile_number % chunk_tiles) * width) + static_cast<float>(region.destination.x);
+			top = (static_cast<float>(tile_number / chunk_tiles) * height) + static_cast<float>(region.destination.y);
+			right = left + static_cast<float>(region.destination.w);
+			bottom = top + static_cast<float>(region.destination.h);
+
+			vertex.position.x = left;
+			vertex.position.y = top;
+			vertex.tex_coord.x = region.u1;
+			vertex.tex_coord.y = region.v1;
+			batch_iterator->vertices.push_back(vertex);
+			vertex.position.x = right;
+			vertex.tex_coord.x = region.u2;
+			batch_iterator->vertices.push_back(vertex);
+			vertex.position.y = bottom;
+			vertex.tex_coord.y = region.v2;
+			batch_iterator->vertices.push_back(vertex);
+			vertex.position.x = left;
+			vertex.tex_coord.x = region.u1;
+			batch_iterator->vertices.push_back(vertex);
+		}
+	#endif
+
+		current_chunk.batches_valid = true;
+	}
+
+
+
+	void tilemap::draw(const double display_x, const double display_y, const Uint8 transparency, const rgb *colormod)
+	{
+		if (transparency == 0)
+		{
+			return;
+		}
+
+		if (regions_compaction != tileset->get_atlas_manager()->get_number_of_compactions()) // Tiles have moved
+		{
+			refresh_tile_regions();
+		}
+
+		// Chunk-level visibility - only chunks overlapping the view are drawn:
+		int renderer_width, renderer_height;
+		renderer->get_dimensions(renderer_width, renderer_height);
+		const int view_x = static_cast<int>(display_x) - origin_x, view_y = static_cast<int>(display_y) - origin_y;
+		const int chunk_width = static_cast<int>(chunk_tiles * tile_width), chunk_height = static_cast<int>(chunk_tiles * tile_height);
+
+		if (view_x + renderer_width <= 0 || view_y + renderer_height <= 0)
+		{
+			return;
+		}
+
+		const int first_chunk_column = std::max(0, view_x / chunk_width), first_chunk_row = std::max(0, view_y / chunk_height);
+		const int last_chunk_column = std::min(static_cast<int>(chunk_columns) - 1, (view_x + renderer_width - 1) / chunk_width), last_chunk_row = std::min(static_cast<int>(chunk_rows) - 1, (view_y + renderer_height - 1) / chunk_height);
+
+		if (first_chunk_column > last_chunk_column || first_chunk_row > last_chunk_row)
+		{
+			return;
+		}
+
+		int chunk_column, chunk_row;
+
+		for (chunk_row = first_chunk_row; chunk_row <= last_chunk_row; ++chunk_row)
+		{
+			for (chunk_column = first_chunk_column; chunk_column <= last_chunk_column; ++chunk_column)
+			{
+				chunk &current_chunk = chunks[(chunk_row * chunk_columns) + chunk_column];
+
+				if (!current_chunk.batches_valid)
+				{
+					rebuild_batches(current_chunk);
+				}
+			}
+		}
+
+		draw_command command;
+		command.angle = 0;
+		command.flip = SDL_FLIP_NONE;
+		command.has_center = false;
+		command.opaque = false;
+
+	#ifdef PLF_SPRITE_BATCHING
+		SDL_Color color;
+		color.r = (colormod != NULL) ? colormod->r : 255;
+		color.g = (colormod != NULL) ? colormod->g : 255;
+		color.b = (colormod != NULL) ? colormod->b : 255;
+		color.a = transparency;
+
+		command.type = DRAW_GEOMETRY;
+		command.colormod.r = command.colormod.g = command.colormod.b = 255;
+		command.alpha = 255;
+		command.source.y = command.source.h = 0;
+		command.destination.x = (first_chunk_column * chunk_width) - view_x;
+		command.destination.y = (first_chunk_row * chunk_height) - view_y;
+		command.destination.w = (last_chunk_column - first_chunk_column + 1) * chunk_width;
+		command.destination.h = (last_chunk_row - first_chunk_row + 1) * chunk_height;
+
+		// All visible chunks' quads on the same atlas texture go into a single geometry command:
+		for (std::vector<SDL_Texture *>::iterator texture_iterator = textures.begin(); texture_iterator != textures.end(); ++texture_iterator)
+		{
+			unsigned int number_of_vertices = 0;
+
+			for (chunk_row = first_chunk_row; chunk_row <= last_chunk_row; ++chunk_row)
+			{
+				for (chunk_column = first_chunk_column; chunk_column <= last_chunk_column; ++chunk_column)
+				{
+					std::vector<chunk_batch> &batches = chunks[(chunk_row * chunk_columns) + chunk_column].batches;
+
+					for (std::vector<chunk_batch>::iterator batch_iterator = batches.begin(); batch_iterator != batches.end(); ++batch_iterator)
+					{
+						if (batch_iterator->texture == *texture_iterator)
+						{
+							number_of_vertices += static_cast<unsigned int>(batch_iterator->vertices.size());
+						}
+					}
+				}
+			}
+
+			if (number_of_vertices == 0)
+			{
+				continue;
+			}
+
+			int first_vertex;
+			SDL_Vertex *vertex = renderer->add_quads(number_of_vertices / 4, first_vertex);
+
+			for (chunk_row = first_chunk_row; chunk_row <= last_chunk_row; ++chunk_row)
+			{
+				for (chunk_column = first_chunk_column; chunk_column <= last_chunk_column; ++chunk_column)
+				{
+					std::vector<chunk_batch> &batches = chunks[(chunk_row * chunk_columns) + chunk_column].batches;
+					const float chunk_x = static_cast<float>((chunk_column * chunk_width) - view_x), chunk_y = static_cast<float>((chunk_row * chunk_height) - view_y);
+
+					for (std::vector<chunk_batch>::iterator batch_iterator = batches.begin(); batch_iterator != batches.end(); ++batch_iterator)
+					{
+						if (batch_iterator->texture != *texture_iterator)
+						{
+							continue;
+						}
+
+						// Translate the cached chunk vertices into screen position:
+						for (std::vector<SDL_Vertex>::iterator vertex_iterator = batch_iterator->vertices.begin(); vertex_iterator != batch_iterator->vertices.end(); ++vertex_iterator)
+						{
+							vertex->position.x = vertex_iterator->position.x + chunk_x;
+							vertex->position.y = vertex_iterator->position.y + chunk_y;
+							vertex->tex_coord = vertex_iterator->tex_coord;
+							vertex->color = color;
+							++vertex;
+						}
+					}
+				}
+			}
+
+			command.texture = *texture_iterator;
+			command.source.x = first_vertex;
+			command.source.w = static_cast<int>(number_of_vertices);
+			renderer->submit(command);
+		}
+	#else
+		// No SDL_RenderGeometry - one textured draw per visible tile, which the renderer's draw list still groups by texture:
+		command.type = DRAW_TEXTURE;
+		command.alpha = transparency;
+		command.colormod.r = (colormod != NULL) ? colormod->r : 255;
+		command.colormod.g = (colormod != NULL) ? colormod->g : 255;
+		command.colormod.b = (colormod != NULL) ? colormod->b : 255;
+
+		const int first_column = std::max(0, view_x / static_cast<int>(tile_width)), first_row = std::max(0, view_y / static_cast<int>(tile_height));
+		const int last_column = std::min(static_cast<int>(columns) - 1, (view_x + renderer_width - 1) / static_cast<int>(tile_width)), last_row = std::min(static_cast<int>(rows) - 1, (view_y + renderer_height - 1) / static_cast<int>(tile_height));
+
+		for (int row = first_row; row <= last_row; ++row)
+		{
+			for (int column = first_column; column <= last_column; ++column)
+			{
+				const Uint16 tile = tile_at(column, row);
+
+				if (tile == 0 || tile_regions[tile - 1].texture == NULL)
+				{
+					continue;
+				}
+
+				command.texture = tile_regions[tile - 1].texture;
+				command.source = tile_regions[tile - 1].source;
+				command.destination = tile_regions[tile - 1].destination;
+				command.destination.x += (column * static_cast<int>(tile_width)) - view_x;
+				command.destination.y += (row * static_cast<int>(tile_height)) - view_y;
+				renderer->submit(command);
+			}
+		}
+	#endif
+	}
+
+}
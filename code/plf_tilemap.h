@@ -0,0 +1,84 @@
+#ifndef PLF_TILEMAP_H
+#define PLF_TILEMAP_H
+
+#include <vector>
+
+#include <SDL2/SDL.h>
+
+#include "plf_renderer.h"
+#include "plf_sprite.h"
+#include "plf_draw_command.h"
+
+
+namespace plf
+{
+
+	// A grid of tiles drawn from a tileset sprite - tile index n is frame n - 1 of the sprite, 0 is empty. The grid is split into fixed-size chunks: only chunks overlapping the view are drawn,
+	// and each chunk keeps its quads as a cached vertex batch, rebuilt only when one of its tiles changes, so that all visible tiles on an atlas texture are drawn with a single SDL_RenderGeometry call.
+	// Solid tiles aren't added to the layer's quadtree - they're queried directly from the grid instead:
+	class tilemap
+	{
+	private:
+		static const unsigned int chunk_tiles = 16; // Chunks are chunk_tiles * chunk_tiles tiles
+
+		struct tile_region
+		{
+			SDL_Texture *texture; // NULL if the frame can't be drawn as a single quad (multitexture)
+			SDL_Rect source;
+			SDL_Rect destination; // Relative to the tile's top-left corner - smaller than the tile if the frame's transparent borders were trimmed
+			float u1, v1, u2, v2;
+		};
+
+	#ifdef PLF_SPRITE_BATCHING
+		struct chunk_batch
+		{
+			SDL_Texture *texture;
+			std::vector<SDL_Vertex> vertices; // Relative to the chunk's top-left corner
+		};
+	#endif
+
+		struct chunk
+		{
+			std::vector<Uint16> tiles; // Row-major
+		#ifdef PLF_SPRITE_BATCHING
+			std::vector<chunk_batch> batches; // One per atlas texture used by the chunk's tiles
+		#endif
+			bool batches_valid;
+		};
+
+		std::vector<chunk> chunks; // Row-major
+		std::vector<tile_region> tile_regions; // Indexed by tile index - 1
+		std::vector<bool> solid_tiles; // Indexed by tile index
+		std::vector<SDL_Texture *> textures; // Distinct atlas textures among the tileset's frames
+		plf::renderer *renderer;
+		plf::sprite *tileset;
+		int origin_x, origin_y; // Layer coordinates of the top-left corner of the map
+		unsigned int tile_width, tile_height;
+		unsigned int columns, rows, chunk_columns, chunk_rows;
+		unsigned int regions_compaction; // atlas_manager compaction count when tile_regions were built
+
+		void build_tile_regions();
+		void rebuild_batches(chunk &current_chunk);
+		inline chunk & get_chunk(const unsigned int column, const unsigned int row) { return chunks[((row / chunk_tiles) * chunk_columns) + (column / chunk_tiles)]; };
+		inline Uint16 & tile_at(const unsigned int column, const unsigned int row) { return get_chunk(column, row).tiles[((row % chunk_tiles) * chunk_tiles) + (column % chunk_tiles)]; };
+	public:
+		tilemap(plf::renderer *_renderer, plf::sprite *_tileset, const unsigned int _tile_width, const unsigned int _tile_height, const unsigned int _columns, const unsigned int _rows, const int x = 0, const int y = 0);
+
+		void set_tile(const unsigned int column, const unsigned int row, const Uint16 tile_index);
+		Uint16 get_tile(const unsigned int column, const unsigned int row);
+		void fill(const Uint16 tile_index); // Set every tile
+		void set_solid(const Uint16 tile_index, const bool solid); // All tiles with this index block movement
+
+		// Grid collision queries, in layer coordinates - constant time per tile covered, independent of the number of tiles in the map:
+		bool is_solid_at(const int x, const int y);
+		bool collides(const SDL_Rect &area); // Any solid tile overlaps area
+		void get_solid_tiles(const SDL_Rect &area, std::vector<SDL_Rect> &solid_areas); // Areas of all solid tiles overlapping area
+
+		void draw(const double display_x, const double display_y, const Uint8 transparency = 255, const rgb *colormod = NULL); // Refreshes tile atlas locations first if the atlases have been compacted since
+		void refresh_tile_regions(); // Re-read tile atlas locations from the tileset and rebuild all chunk batches
+		inline void get_size(unsigned int &width_in_tiles, unsigned int &height_in_tiles) { width_in_tiles = columns; height_in_tiles = rows; };
+	};
+
+}
+
+#endif // PLF_TILEMAP_H
@@ -0,0 +1,143 @@
+#include <cmath> // sqrt
+#include <cassert>
+
+#include <SDL2/SDL.h>
+
+#include "plf_timer.h"
+
+
+namespace plf
+{
+
+	frame_pacer::frame_pacer(const double target_frames_per_second, const bool vsync_enabled, const int display_refresh_rate):
+		frame_start(SDL_GetPerformanceCounter()),
+		milliseconds_per_count(1000.0 / static_cast<double>(SDL_GetPerformanceFrequency())),
+		target_frame_time(0),
+		refresh_period(0),
+		delta_time(0),
+		maximum_delta_time(250),
+		sleep_mean(1),
+		sleep_m2(0),
+		sleep_estimate(2), // Conservative until we've measured how long the OS actually takes to return from SDL_Delay(1)
+		sleep_samples(0),
+		vsync(false)
+	{
+		set_target_frame_rate(target_frames_per_second);
+		set_vsync(vsync_enabled, display_refresh_rate);
+	}
+
+
+
+	void frame_pacer::set_target_frame_rate(const double frames_per_second)
+	{
+		assert(frames_per_second >= 0);
+		target_frame_time = (frames_per_second == 0) ? 0 : 1000.0 / frames_per_second;
+	}
+
+
+
+	void frame_pacer::set_vsync(const bool vsync_enabled, const int display_refresh_rate)
+	{
+		vsync = vsync_enabled;
+		refresh_period = (display_refresh_rate > 0) ? 1000.0 / static_cast<double>(display_refresh_rate) : 0;
+	}
+
+
+
+	void frame_pacer::sleep_until(const Uint64 target_count)
+	{
+		Uint64 current_count = SDL_GetPerformanceCounter();
+		double observed_sleep, deviation;
+
+		while (current_count < target_count && static_cast<double>(target_count - current_count) * milliseconds_per_count > sleep_estimate)
+		{
+			SDL_Delay(1);
+
+			const Uint64 wake_count = SDL_GetPerformanceCounter();
+			observed_sleep = static_cast<double>(wake_count - current_count) * milliseconds_per_count;
+			current_count = wake_count;
+
+			// Update running mean and variance of sleep duration:
+			++sleep_samples;
+			deviation = observed_sleep - sleep_mean;
+			sleep_mean += deviation / static_cast<double>(sleep_samples);
+			sleep_m2 += deviation * (observed_sleep - sleep_mean);
+
+			if (sleep_samples > 1)
+			{
+				// Mean plus one standard deviation - a sleep will rarely take longer than this:
+				sleep_estimate = sleep_mean + std::sqrt(sleep_m2 / static_cast<double>(sleep_samples - 1));
+			}
+
+			// Restart statistics periodically so the estimate tracks changes in OS scheduler behaviour:
+			if (sleep_samples == 1000)
+			{
+				sleep_samples = 1;
+				sleep_m2 = 0;
+			}
+		}
+	}
+
+
+
+	void frame_pacer::spin_until(const Uint64 target_count)
+	{
+		while (SDL_GetPerformanceCounter() < target_count)
+		{
+		}
+	}
+
+
+
+	double frame_pacer::wait_for_next_frame()
+	{
+		double wait_time = target_frame_time;
+
+		if (vsync)
+		{
+			if (refresh_period == 0 || target_frame_time < refresh_period * 1.5)
+			{
+				wait_time = 0; // SDL_RenderPresent has already paced this frame
+			}
+			else
+			{
+				// Target is a multiple of the refresh period - sleep most of the way, leave the remainder to the next vertical retrace:
+				wait_time = target_frame_time - (refresh_period * 0.5);
+			}
+		}
+
+		if (wait_time > 0)
+		{
+			const Uint64 target_count = frame_start + static_cast<Uint64>(wait_time / milliseconds_per_count);
+			sleep_until(target_count);
+			spin_until(target_count);
+		}
+
+		const Uint64 current_count = SDL_GetPerformanceCounter();
+		delta_time = static_cast<double>(current_count - frame_start) * milliseconds_per_count;
+		frame_start = current_count;
+
+		if (delta_time > maximum_delta_time)
+		{
+			delta_time = maximum_delta_time;
+		}
+
+		return delta_time;
+	}
+
+
+
+	void frame_pacer::reset()
+	{
+		frame_start = SDL_GetPerformanceCounter();
+		delta_time = 0;
+	}
+
+
+
+	double frame_pacer::get_elapsed_time()
+	{
+		return static_cast<double>(SDL_GetPerformanceCounter() - frame_start) * milliseconds_per_count;
+	}
+
+}
@@ -0,0 +1,49 @@
+#ifndef PLF_TIMER_H
+#define PLF_TIMER_H
+
+#include <cassert>
+
+#include <SDL2/SDL.h>
+
+
+namespace plf
+{
+
+	// Measures frame deltas using the high-resolution performance counter, and holds frames to a target frame time.
+	// Waiting is done by sleeping coarsely (SDL_Delay(1) at a time) while there is comfortably more time left than a sleep is expected to take, then spinning for the final fraction of a millisecond.
+	// With vsync enabled, SDL_RenderPresent already blocks until the vertical retrace, so no waiting is done unless the target frame time is longer than the refresh period.
+	class frame_pacer
+	{
+	private:
+		Uint64 frame_start; // Performance counter value at the start of the current frame
+		double milliseconds_per_count;
+		double target_frame_time; // In milliseconds. 0 == uncapped
+		double refresh_period; // In milliseconds, from the display refresh rate. 0 == unknown
+		double delta_time; // Time between the two most recent frame starts, in milliseconds, clamped to maximum_delta_time
+		double maximum_delta_time; // In milliseconds - longer frames (eg. loading, or a debugger break) are reported as this, so simulations don't jump
+		double sleep_mean, sleep_m2; // Running mean and sum of squared deviations of observed SDL_Delay(1) durations (Welford's method)
+		double sleep_estimate; // Stop sleeping and start spinning once less than this much time is left in the frame
+		unsigned int sleep_samples;
+		bool vsync;
+
+		void sleep_until(const Uint64 target_count);
+		void spin_until(const Uint64 target_count);
+	public:
+		frame_pacer(const double target_frames_per_second = 60, const bool vsync_enabled = false, const int display_refresh_rate = 0);
+
+		void set_target_frame_rate(const double frames_per_second); // 0 == uncapped
+		void set_vsync(const bool vsync_enabled, const int display_refresh_rate = 0);
+
+		// Call once per frame, after display_frame(). Waits (if necessary) until the target frame time has elapsed since the previous call, then returns the delta time in fractional milliseconds:
+		double wait_for_next_frame();
+		void reset(); // Start timing the current frame from now - call after loading, before the first frame, so that loading time isn't counted as a frame
+		inline void set_maximum_delta_time(const double milliseconds) { assert(milliseconds > 0); maximum_delta_time = milliseconds; }; // Default 250ms
+
+		inline double get_delta_time() { return delta_time; };
+		inline double get_target_frame_time() { return target_frame_time; };
+		double get_elapsed_time(); // Milliseconds since the start of the current frame
+	};
+
+}
+
+#endif // PLF_TIMER_H
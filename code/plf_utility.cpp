@@ -1,9 +1,167 @@
 #include <sstream>
 #include <ctime>
+#include <cstring> // std::memcpy
+#include <algorithm> // std::min, std::max
+
+#include <SDL2/SDL.h>
+
+#include "plf_utility.h"
 
 namespace plf
 {
 
+	bool surface_is_opaque(SDL_Surface *surface)
+	{
+		if (SDL_MUSTLOCK(surface))
+		{
+			SDL_LockSurface(surface);
+		}
+	
+		const bool opaque = pixels_are_opaque(surface->pixels, surface->w, surface->h, surface->pitch, surface->format);
+	
+		if (SDL_MUSTLOCK(surface))
+		{
+			SDL_UnlockSurface(surface);
+		}
+	
+		return opaque;
+	}
+	
+	
+	
+	bool pixels_are_opaque(const void *pixels, const int width, const int height, const int pitch, const SDL_PixelFormat *format)
+	{
+		const Uint32 alpha_mask = format->Amask;
+	
+		if (alpha_mask == 0) // No alpha channel
+		{
+			return true;
+		}
+	
+		if (format->BytesPerPixel != 4)
+		{
+			return false;
+		}
+	
+		for (int y = 0; y != height; ++y)
+		{
+			const Uint32 *pixel = reinterpret_cast<const Uint32 *>(static_cast<const Uint8 *>(pixels) + (y * pitch));
+			const Uint32 * const row_end = pixel + width;
+	
+			for (; pixel != row_end; ++pixel)
+			{
+				if ((*pixel & alpha_mask) != alpha_mask)
+				{
+					return false;
+				}
+			}
+		}
+	
+		return true;
+	}
+	
+	
+	
+	SDL_Rect get_visible_bounds(SDL_Surface *surface, const SDL_Rect &area)
+	{
+		const Uint32 alpha_mask = surface->format->Amask;
+	
+		if (alpha_mask == 0 || surface->format->BytesPerPixel != 4)
+		{
+			return area;
+		}
+	
+		if (SDL_MUSTLOCK(surface))
+		{
+			SDL_LockSurface(surface);
+		}
+	
+		int left = area.x + area.w, right = area.x - 1, top = area.y + area.h, bottom = area.y - 1;
+	
+		for (int y = area.y; y != area.y + area.h; ++y)
+		{
+			const Uint32 * const row = reinterpret_cast<const Uint32 *>(static_cast<const Uint8 *>(surface->pixels) + (y * surface->pitch));
+			int x = area.x;
+	
+			// Leftmost visible pixel in this row:
+			for (; x != area.x + area.w && (row[x] & alpha_mask) == 0; ++x)
+			{}
+	
+			if (x == area.x + area.w) // Entirely transparent row
+			{
+				continue;
+			}
+	
+			left = std::min(left, x);
+	
+			// Rightmost visible pixel, if right of any found so far:
+			const int row_left = x;
+	
+			for (x = area.x + area.w - 1; x > right && x > row_left && (row[x] & alpha_mask) == 0; --x)
+			{}
+	
+			right = std::max(right, x);
+	
+			if (top > y)
+			{
+				top = y;
+			}
+	
+			bottom = y;
+		}
+	
+		if (SDL_MUSTLOCK(surface))
+		{
+			SDL_UnlockSurface(surface);
+		}
+	
+		if (right < left) // Nothing visible
+		{
+			const SDL_Rect empty_area = {area.x, area.y, 1, 1};
+			return empty_area;
+		}
+	
+		const SDL_Rect bounds = {left, top, (right - left) + 1, (bottom - top) + 1};
+		return bounds;
+	}
+	
+	
+	
+	Uint64 hash_pixels(const void *pixels, const int row_bytes, const int height, const int pitch, const Uint64 seed)
+	{
+		const Uint64 multiplier = 0x9E3779B97F4A7C15ULL;
+		Uint64 hash = seed ^ (static_cast<Uint64>(row_bytes) * multiplier) ^ static_cast<Uint64>(height);
+		Uint64 block;
+	
+		for (int y = 0; y != height; ++y)
+		{
+			const Uint8 *current = static_cast<const Uint8 *>(pixels) + (y * pitch);
+			const Uint8 * const row_end = current + row_bytes;
+	
+			for (; row_end - current >= 8; current += 8)
+			{
+				std::memcpy(&block, current, 8); // Rows needn't be 8-byte aligned
+				hash = (hash ^ (block * multiplier)) * 0xBF58476D1CE4E5B9ULL;
+				hash ^= hash >> 31;
+			}
+	
+			for (; current != row_end; ++current) // Remaining bytes
+			{
+				hash = (hash ^ *current) * multiplier;
+			}
+		}
+	
+		// Final mix, so that every input bit affects every output bit:
+		hash ^= hash >> 33;
+		hash *= 0xFF51AFD7ED558CCDULL;
+		hash ^= hash >> 33;
+		hash *= 0xC4CEB9FE1A85EC53ULL;
+		hash ^= hash >> 33;
+		return hash;
+	}
+	
+	
+
 	std::string get_timedate_string()
 	{
 		time_t rawtime;
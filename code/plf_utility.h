@@ -24,6 +24,19 @@ namespace plf
 	}
 	
 	
+	// Returns true if every pixel in the surface is fully opaque. Conservatively returns false for formats with an alpha channel which aren't 32-bit:
+	bool surface_is_opaque(SDL_Surface *surface);
+	bool pixels_are_opaque(const void *pixels, const int width, const int height, const int pitch, const SDL_PixelFormat *format); // As above, for a region of a surface's pixels
+	
+	
+	// Smallest area within area (of a 32-bit surface) containing every pixel which isn't fully transparent. Returns area unchanged for surfaces without an alpha channel, and a 1 * 1 area at its top-left corner if every pixel is transparent:
+	SDL_Rect get_visible_bounds(SDL_Surface *surface, const SDL_Rect &area);
+	
+	
+	// Fast 64-bit hash of a block of pixels, 8 bytes at a time - row_bytes from each of height rows, pitch bytes apart. Not cryptographic:
+	Uint64 hash_pixels(const void *pixels, const int row_bytes, const int height, const int pitch, const Uint64 seed = 0);
+	
+	
 	// Return a string containing the current date and time: primarily for logging.
 	std::string get_timedate_string();
 	